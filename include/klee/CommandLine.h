@@ -19,6 +19,8 @@ extern llvm::cl::opt<bool> UseCexCache;
 
 extern llvm::cl::opt<bool> UseCache;
 
+extern llvm::cl::opt<std::string> PersistentQueryCache;
+
 extern llvm::cl::opt<bool> UseIndependentSolver; 
 
 extern llvm::cl::opt<bool> DebugValidateSolver;
@@ -29,8 +31,16 @@ extern llvm::cl::opt<double> MaxCoreSolverTime;
 
 extern llvm::cl::opt<bool> UseForkedCoreSolver;
 
+extern llvm::cl::opt<bool> UseForkedZ3Solver;
+
 extern llvm::cl::opt<bool> CoreSolverOptimizeDivides;
 
+extern llvm::cl::opt<unsigned> ConstructCacheSize;
+
+extern llvm::cl::opt<bool> QueryLatencyHistograms;
+
+extern llvm::cl::opt<unsigned> SlowestQueriesToLog;
+
 extern llvm::cl::opt<bool> UseAssignmentValidatingSolver;
 
 ///The different query logging solvers that can switched on/off
@@ -49,10 +59,13 @@ enum CoreSolverType {
   METASMT_SOLVER,
   DUMMY_SOLVER,
   Z3_SOLVER,
+  PORTFOLIO_SOLVER,
   NO_SOLVER
 };
 extern llvm::cl::opt<CoreSolverType> CoreSolverToUse;
 
+extern llvm::cl::list<CoreSolverType> PortfolioSolvers;
+
 extern llvm::cl::opt<CoreSolverType> DebugCrossCheckCoreSolverWith;
 
 #ifdef ENABLE_METASMT
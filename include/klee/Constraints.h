@@ -12,6 +12,9 @@
 
 #include "klee/Expr.h"
 
+#include <map>
+#include <vector>
+
 // FIXME: Currently we use ConstraintManager for two things: to pass
 // sets of constraints around, and to optimize constraints. We should
 // move the first usage into a separate data structure
@@ -19,6 +22,63 @@
 namespace klee {
 
 class ExprVisitor;
+
+/// ConstraintPartition - Groups a constraint set into clusters of
+/// constraints which transitively share symbolic variables (constant index
+/// array elements, or whole arrays for reads at a symbolic index). The
+/// clusters are kept in a union-find over the variables and are updated as
+/// constraints are appended, which is what IndependentSolver otherwise
+/// recomputes for every query.
+class ConstraintPartition {
+public:
+  unsigned refCount;
+
+private:
+  /// An array element, the index ~0U stands for the whole array.
+  typedef std::pair<const Array*, unsigned> Variable;
+
+  std::map<Variable, unsigned> variables;
+  /// The union-find forest, a node is a root if it is its own parent.
+  std::vector<unsigned> parent;
+  std::vector<unsigned> rank;
+  /// The indices of the constraints of the cluster of every root.
+  std::vector< std::vector<unsigned> > members;
+  /// A node of the cluster of every constraint.
+  std::vector<unsigned> constraintNodes;
+
+  unsigned find(unsigned node) const {
+    while (parent[node] != node)
+      node = parent[node];
+    return node;
+  }
+  unsigned createNode();
+  unsigned getVariable(const Variable &v);
+  void merge(unsigned a, unsigned b);
+  /// Add the roots of the clusters the variables read by \a e belong to.
+  void getRoots(ref<Expr> e, std::vector<unsigned> &roots) const;
+
+public:
+  ConstraintPartition() : refCount(0) {}
+  ConstraintPartition(const ConstraintPartition &p)
+    : refCount(0), variables(p.variables), parent(p.parent), rank(p.rank),
+      members(p.members), constraintNodes(p.constraintNodes) {}
+
+  /// The number of constraints in the partition.
+  unsigned size() const { return constraintNodes.size(); }
+
+  /// Add \a e as the next constraint of the set.
+  void addConstraint(ref<Expr> e);
+
+  /// Get the indices of the constraints which transitively share
+  /// variables with \a e, in ascending order.
+  void getRelated(ref<Expr> e, std::vector<unsigned> &indices) const;
+
+  /// Get the cluster of constraint \a index, constraints are in the same
+  /// cluster iff they have the same cluster id.
+  unsigned getCluster(unsigned index) const {
+    return find(constraintNodes[index]);
+  }
+};
   
 class ConstraintManager {
 public:
@@ -33,7 +93,10 @@ public:
   ConstraintManager(const std::vector< ref<Expr> > &_constraints) :
     constraints(_constraints) {}
 
-  ConstraintManager(const ConstraintManager &cs) : constraints(cs.constraints) {}
+  // the independence partition is shared until one of the copies is
+  // modified
+  ConstraintManager(const ConstraintManager &cs)
+    : constraints(cs.constraints), partition(cs.partition) {}
 
   typedef std::vector< ref<Expr> >::const_iterator constraint_iterator;
 
@@ -64,9 +127,25 @@ public:
   bool operator==(const ConstraintManager &other) const {
     return constraints == other.constraints;
   }
+
+  /// Get the constraints which transitively share symbolic variables with
+  /// \a e, in their original order. Returns false if the independence
+  /// partition is not maintained for this set, which is only the case for
+  /// sets that were never added to with addConstraint().
+  bool getIndependentConstraints(ref<Expr> e,
+                                 std::vector< ref<Expr> > &result) const;
+
+  /// Get the constraints grouped into the clusters of the independence
+  /// partition, every cluster in the original order. Returns false if the
+  /// partition is not maintained for this set.
+  bool getIndependentClusters(
+      std::vector< std::vector< ref<Expr> > > &result) const;
   
 private:
   std::vector< ref<Expr> > constraints;
+  /// The independence partition of the constraints, null if it is not
+  /// maintained.
+  ref<ConstraintPartition> partition;
 
   // returns true iff the constraints were modified
   bool rewriteConstraints(ExprVisitor &visitor);
@@ -62,6 +62,25 @@ struct StackFrame {
   ~StackFrame();
 };
 
+/// @brief The choices a state took at the splits since the initial state,
+/// most recent first. States share the common prefix of their histories.
+struct ForkHistory {
+  unsigned refCount;
+  ref<ForkHistory> parent;
+  /// @brief The id of the instruction which split and the number of
+  /// states it split into, used to detect a replay which diverges.
+  unsigned instruction, numChoices;
+  /// @brief The index of the state among the states created by the
+  /// split, the false side of a fork is 0 and the true side 1.
+  unsigned choice;
+
+  ForkHistory(const ref<ForkHistory> &_parent, unsigned _instruction,
+              unsigned _numChoices, unsigned _choice)
+      : refCount(0), parent(_parent), instruction(_instruction),
+        numChoices(_numChoices), choice(_choice) {}
+  ~ForkHistory();
+};
+
 /// @brief ExecutionState representing a path under exploration
 class ExecutionState {
 public:
@@ -134,6 +153,21 @@ public:
   /// @brief Pointer to the process tree of the current state
   PTreeNode *ptreeNode;
 
+  /// @brief Choices taken at splits, only recorded when the exploration
+  /// is checkpointed. Replaying them recreates the state.
+  ref<ForkHistory> forkHistory;
+
+  /// @brief Whether the state was spilled to save memory. Its memory and
+  /// constraints are dropped until it is recreated from its fork history,
+  /// which is stored at spillOffset in the spill file.
+  bool spilled;
+  uint64_t spillOffset;
+
+  /// @brief Whether the state called an external function. Recreating it
+  /// from its fork history would call the function again, so such states
+  /// are not spilled.
+  bool madeExternalCall;
+
   /// @brief Ordered list of symbolics: used to generate test cases.
   //
   // FIXME: Move to a shared list structure (not critical).
@@ -150,7 +184,9 @@ public:
   std::vector<ref<MergeHandler> > openMergeStack;
 
 private:
-  ExecutionState() : ptreeNode(0) {}
+  ExecutionState()
+      : ptreeNode(0), spilled(false), spillOffset(0),
+        madeExternalCall(false) {}
 
 public:
   ExecutionState(KFunction *kf);
@@ -165,6 +201,12 @@ public:
 
   ExecutionState *branch();
 
+  void addForkChoice(unsigned instruction, unsigned numChoices,
+                     unsigned choice) {
+    forkHistory =
+        new ForkHistory(forkHistory, instruction, numChoices, choice);
+  }
+
   void pushFrame(KInstIterator caller, KFunction *kf);
   void popFrame();
 
@@ -12,6 +12,7 @@
 
 #include "klee/util/Bits.h"
 #include "klee/util/Ref.h"
+#include "klee/util/RefCount.h"
 
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/APFloat.h"
@@ -19,6 +20,9 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/raw_ostream.h"
 
+#ifdef KLEE_ATOMIC_REFCOUNT
+#include <atomic>
+#endif
 #include <sstream>
 #include <set>
 #include <vector>
@@ -89,7 +93,11 @@ Todo: Shouldn't bool \c Xor just be written as not equal?
 
 class Expr {
 public:
+#ifdef KLEE_ATOMIC_REFCOUNT
+  static std::atomic<unsigned> count;
+#else
   static unsigned count;
+#endif
   static const unsigned MAGIC_HASH_CONSTANT = 39;
 
   /// The type of an expression is simply its width, in bits. 
@@ -172,7 +180,7 @@ public:
     CmpKindLast=Sge
   };
 
-  unsigned refCount;
+  RefCount refCount;
 
 protected:  
   unsigned hashValue;
@@ -202,8 +210,27 @@ protected:
   virtual int compareContents(const Expr &b) const = 0;
 
 public:
-  Expr() : refCount(0) { Expr::count++; }
-  virtual ~Expr() { Expr::count--; } 
+  Expr() { Expr::count++; }
+  virtual ~Expr();
+
+  /// Expressions and update nodes are allocated from a pool with a free
+  /// list per size class.
+  static void *operator new(size_t size);
+  static void operator delete(void *p, size_t size);
+
+  /// Bytes obtained from the system by the node pool.
+  static size_t getPoolReservedSize();
+  /// Bytes in the pool which hold live expressions and update nodes.
+  static size_t getPoolUsedSize();
+  /// Give the empty slabs of the pool back to the system, returning the
+  /// number of bytes released.
+  static size_t releasePoolMemory();
+  /// Nodes allocated from and returned to the pool so far.
+  static uint64_t getPoolAllocations();
+  static uint64_t getPoolFrees();
+  /// Calls to the system allocator made by the pool, for new slabs and
+  /// for nodes which are too large for a size class.
+  static uint64_t getPoolMallocs();
 
   virtual Kind getKind() const = 0;
   virtual Width getWidth() const = 0;
@@ -278,6 +305,16 @@ public:
   struct CreateArg;
   static ref<Expr> createFromKind(Kind k, std::vector<CreateArg> args);
 
+  /// Return the canonical node that is structurally equal to the newly
+  /// allocated expression \a e when hash-consing is enabled (see
+  /// --hash-cons-exprs), or \a e itself otherwise. Expects the hash of
+  /// \a e to be computed.
+  static ref<Expr> hashCons(const ref<Expr> &e);
+
+  /// Whether structurally equal expressions and update nodes share one
+  /// node.
+  static bool isHashConsing();
+
   static bool isValidKidWidth(unsigned kid, Width w) { return true; }
   static bool needsResultType() { return false; }
 
@@ -415,7 +452,7 @@ public:
   static ref<Expr> alloc(const ref<Expr> &src) {
     ref<Expr> r(new NotOptimizedExpr(src));
     r->computeHash();
-    return r;
+    return hashCons(r);
   }
   
   static ref<Expr> create(ref<Expr> src);
@@ -448,8 +485,9 @@ public:
 /// Class representing a byte update of an array.
 class UpdateNode {
   friend class UpdateList;  
+  template <class T> friend class HashConsTable;
 
-  mutable unsigned refCount;
+  mutable RefCount refCount;
   // cache instead of recalc
   unsigned hashValue;
 
@@ -466,13 +504,17 @@ public:
              const ref<Expr> &_index, 
              const ref<Expr> &_value);
 
+  /// Allocated from the same pool as expressions.
+  static void *operator new(size_t size);
+  static void operator delete(void *p, size_t size);
+
   unsigned getSize() const { return size; }
 
   int compare(const UpdateNode &b) const;  
   unsigned hash() const { return hashValue; }
 
 private:
-  UpdateNode() : refCount(0) {}
+  UpdateNode() {}
   ~UpdateNode();
 
   unsigned computeHash();
@@ -575,7 +617,7 @@ public:
   static ref<Expr> alloc(const UpdateList &updates, const ref<Expr> &index) {
     ref<Expr> r(new ReadExpr(updates, index));
     r->computeHash();
-    return r;
+    return hashCons(r);
   }
   
   static ref<Expr> create(const UpdateList &updates, ref<Expr> i);
@@ -620,7 +662,7 @@ public:
                          const ref<Expr> &f) {
     ref<Expr> r(new SelectExpr(c, t, f));
     r->computeHash();
-    return r;
+    return hashCons(r);
   }
   
   static ref<Expr> create(ref<Expr> c, ref<Expr> t, ref<Expr> f);
@@ -683,7 +725,7 @@ public:
   static ref<Expr> alloc(const ref<Expr> &l, const ref<Expr> &r) {
     ref<Expr> c(new ConcatExpr(l, r));
     c->computeHash();
-    return c;
+    return hashCons(c);
   }
   
   static ref<Expr> create(const ref<Expr> &l, const ref<Expr> &r);
@@ -750,7 +792,7 @@ public:
   static ref<Expr> alloc(const ref<Expr> &e, unsigned o, Width w) {
     ref<Expr> r(new ExtractExpr(e, o, w));
     r->computeHash();
-    return r;
+    return hashCons(r);
   }
   
   /// Creates an ExtractExpr with the given bit offset and width
@@ -801,7 +843,7 @@ public:
   static ref<Expr> alloc(const ref<Expr> &e) {
     ref<Expr> r(new NotExpr(e));
     r->computeHash();
-    return r;
+    return hashCons(r);
   }
   
   static ref<Expr> create(const ref<Expr> &e);
@@ -878,7 +920,7 @@ public:                                                          \
     static ref<Expr> alloc(const ref<Expr> &e, Width w) {        \
       ref<Expr> r(new _class_kind ## Expr(e, w));                \
       r->computeHash();                                          \
-      return r;                                                  \
+      return hashCons(r);                                        \
     }                                                            \
     static ref<Expr> create(const ref<Expr> &e, Width w);        \
     Kind getKind() const { return _class_kind; }                 \
@@ -911,7 +953,7 @@ CAST_EXPR_CLASS(ZExt)
     static ref<Expr> alloc(const ref<Expr> &l, const ref<Expr> &r) {           \
       ref<Expr> res(new _class_kind##Expr(l, r));                              \
       res->computeHash();                                                      \
-      return res;                                                              \
+      return hashCons(res);                                                    \
     }                                                                          \
     static ref<Expr> create(const ref<Expr> &l, const ref<Expr> &r);           \
     Width getWidth() const { return left->getWidth(); }                        \
@@ -960,7 +1002,7 @@ ARITHMETIC_EXPR_CLASS(AShr)
     static ref<Expr> alloc(const ref<Expr> &l, const ref<Expr> &r) {           \
       ref<Expr> res(new _class_kind##Expr(l, r));                              \
       res->computeHash();                                                      \
-      return res;                                                              \
+      return hashCons(res);                                                    \
     }                                                                          \
     static ref<Expr> create(const ref<Expr> &l, const ref<Expr> &r);           \
     Kind getKind() const { return _class_kind; }                               \
@@ -1065,7 +1107,7 @@ public:
   static ref<ConstantExpr> alloc(const llvm::APInt &v) {
     ref<ConstantExpr> r(new ConstantExpr(v));
     r->computeHash();
-    return r;
+    return cast<ConstantExpr>(hashCons(r));
   }
 
   static ref<ConstantExpr> alloc(const llvm::APFloat &f) {
@@ -0,0 +1,592 @@
+//===-- BTreeMap.h ----------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_BTREEMAP_H
+#define KLEE_BTREEMAP_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <utility>
+
+namespace klee {
+
+/// BTreeMap - An ordered map stored as a copy-on-write B+ tree. Copying a
+/// map is O(1), copies share all of their nodes. A node is only copied
+/// when it is about to be modified while shared, so an update copies at
+/// most the path from the root to the leaf, and updates of an unshared
+/// map are done in place. Nodes are split when they overflow and merged
+/// with a sibling when they fall below half full, so the depth stays
+/// logarithmic in the current size of the map.
+///
+/// Compared to ImmutableMap, the values are stored in wide leaves, so
+/// lookups touch a few cache lines per level of a shallow tree instead
+/// of one node per level of a binary tree.
+template <class K, class D, class CMP = std::less<K> > class BTreeMap {
+public:
+  typedef K key_type;
+  typedef D data_type;
+  typedef std::pair<K, D> value_type;
+  class iterator;
+
+private:
+  /// Every node but the root has at least Order / 2 entries, so a map
+  /// which needs a deeper path has more than 8^23 elements.
+  enum { Order = 16, MaxDepth = 24 };
+
+  struct Node {
+    unsigned refCount;
+    unsigned count;
+    bool leaf;
+
+    Node(bool _leaf) : refCount(1), count(0), leaf(_leaf) {}
+  };
+
+  struct Leaf : Node {
+    value_type values[Order];
+
+    Leaf() : Node(true) {}
+  };
+
+  struct Inner : Node {
+    /// The smallest key of every child.
+    K keys[Order];
+    Node *children[Order];
+
+    Inner() : Node(false) {}
+  };
+
+  Node *root;
+  size_t numElements;
+
+  static const Leaf *asLeaf(const Node *n) {
+    return static_cast<const Leaf *>(n);
+  }
+  static const Inner *asInner(const Node *n) {
+    return static_cast<const Inner *>(n);
+  }
+
+  static void release(Node *n) {
+    if (--n->refCount)
+      return;
+    if (n->leaf) {
+      delete static_cast<Leaf *>(n);
+    } else {
+      Inner *in = static_cast<Inner *>(n);
+      for (unsigned i = 0; i < in->count; ++i)
+        release(in->children[i]);
+      delete in;
+    }
+  }
+
+  /// Return the node in \a slot, copying it first if it is shared.
+  static Node *getWriteable(Node *&slot) {
+    Node *n = slot;
+    if (n->refCount == 1)
+      return n;
+    if (n->leaf) {
+      Leaf *l = new Leaf();
+      for (unsigned i = 0; i < n->count; ++i)
+        l->values[i] = asLeaf(n)->values[i];
+      slot = l;
+    } else {
+      Inner *in = new Inner();
+      for (unsigned i = 0; i < n->count; ++i) {
+        in->keys[i] = asInner(n)->keys[i];
+        in->children[i] = asInner(n)->children[i];
+        ++in->children[i]->refCount;
+      }
+      slot = in;
+    }
+    slot->count = n->count;
+    --n->refCount;
+    return slot;
+  }
+
+  static const K &minKey(const Node *n) {
+    while (!n->leaf)
+      n = asInner(n)->children[0];
+    return asLeaf(n)->values[0].first;
+  }
+
+  /// The index of the first key greater than \a k.
+  static unsigned upperBound(const Inner *in, const K &k) {
+    unsigned lo = 0, hi = in->count;
+    while (lo < hi) {
+      unsigned mid = (lo + hi) / 2;
+      if (CMP()(k, in->keys[mid]))
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+    return lo;
+  }
+  static unsigned upperBound(const Leaf *l, const K &k) {
+    unsigned lo = 0, hi = l->count;
+    while (lo < hi) {
+      unsigned mid = (lo + hi) / 2;
+      if (CMP()(k, l->values[mid].first))
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+    return lo;
+  }
+  /// The index of the first key not less than \a k.
+  static unsigned lowerBound(const Leaf *l, const K &k) {
+    unsigned lo = 0, hi = l->count;
+    while (lo < hi) {
+      unsigned mid = (lo + hi) / 2;
+      if (CMP()(l->values[mid].first, k))
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return lo;
+  }
+  /// The child of \a in which holds \a k if it is in the map, which is
+  /// also the child to insert it into.
+  static unsigned childIndex(const Inner *in, const K &k) {
+    unsigned i = upperBound(in, k);
+    return i ? i - 1 : 0;
+  }
+
+  /// Insert \a child with smallest key \a key at \a at, splitting \a in
+  /// if it is full. The new right sibling is returned in \a split.
+  static void insertChild(Inner *in, unsigned at, Node *child, const K &key,
+                          Node *&split) {
+    Inner *target = in;
+    if (in->count == Order) {
+      Inner *r = new Inner();
+      unsigned half = Order / 2;
+      for (unsigned i = half; i < Order; ++i) {
+        r->keys[i - half] = in->keys[i];
+        r->children[i - half] = in->children[i];
+      }
+      in->count = half;
+      r->count = Order - half;
+      split = r;
+      if (at > half) {
+        target = r;
+        at -= half;
+      }
+    }
+    for (unsigned i = target->count; i > at; --i) {
+      target->keys[i] = target->keys[i - 1];
+      target->children[i] = target->children[i - 1];
+    }
+    target->keys[at] = key;
+    target->children[at] = child;
+    ++target->count;
+  }
+
+  static bool insertRec(Node *&slot, const value_type &v, bool overwrite,
+                        Node *&split) {
+    Node *n = getWriteable(slot);
+    const K &k = v.first;
+    if (n->leaf) {
+      Leaf *l = static_cast<Leaf *>(n);
+      unsigned p = lowerBound(l, k);
+      if (p < l->count && !CMP()(k, l->values[p].first)) {
+        if (overwrite)
+          l->values[p] = v;
+        return false;
+      }
+      if (l->count == Order) {
+        Leaf *r = new Leaf();
+        unsigned half = Order / 2;
+        for (unsigned i = half; i < Order; ++i) {
+          r->values[i - half] = l->values[i];
+          l->values[i] = value_type();
+        }
+        l->count = half;
+        r->count = Order - half;
+        split = r;
+        if (p > half) {
+          l = r;
+          p -= half;
+        }
+      }
+      for (unsigned i = l->count; i > p; --i)
+        l->values[i] = l->values[i - 1];
+      l->values[p] = v;
+      ++l->count;
+      return true;
+    }
+
+    Inner *in = static_cast<Inner *>(n);
+    unsigned i = childIndex(in, k);
+    Node *childSplit = 0;
+    bool inserted = insertRec(in->children[i], v, overwrite, childSplit);
+    if (CMP()(k, in->keys[i]))
+      in->keys[i] = k;
+    if (childSplit)
+      insertChild(in, i + 1, childSplit, minKey(childSplit), split);
+    return inserted;
+  }
+
+  /// Refill child \a i of \a in, which is less than half full, from a
+  /// sibling, or merge the two if they fit in one node. This keeps every
+  /// node but the root at least half full.
+  static void rebalance(Inner *in, unsigned i) {
+    if (in->count < 2)
+      return;
+    unsigned l = i ? i - 1 : 0;
+    Node *a = getWriteable(in->children[l]);
+    Node *b = getWriteable(in->children[l + 1]);
+
+    if (a->count + b->count <= Order) {
+      // Merge b into a, its children move without changing owners.
+      for (unsigned j = 0; j < b->count; ++j)
+        moveEntry(b, j, a, a->count + j);
+      a->count += b->count;
+      b->count = 0;
+      release(b);
+      for (unsigned j = l + 2; j < in->count; ++j) {
+        in->keys[j - 1] = in->keys[j];
+        in->children[j - 1] = in->children[j];
+      }
+      in->keys[--in->count] = K();
+    } else {
+      unsigned total = a->count + b->count, half = total / 2;
+      if (a->count < half) {
+        unsigned n = half - a->count;
+        for (unsigned j = 0; j < n; ++j)
+          moveEntry(b, j, a, a->count + j);
+        for (unsigned j = n; j < b->count; ++j)
+          moveEntry(b, j, b, j - n);
+        a->count = half;
+        b->count = total - half;
+      } else {
+        unsigned n = a->count - half;
+        for (unsigned j = b->count; j > 0; --j)
+          moveEntry(b, j - 1, b, j - 1 + n);
+        for (unsigned j = 0; j < n; ++j)
+          moveEntry(a, half + j, b, j);
+        a->count = half;
+        b->count = total - half;
+      }
+      in->keys[l + 1] = minKey(b);
+    }
+    if (a->count)
+      in->keys[l] = minKey(a);
+  }
+
+  /// Move entry \a from of \a src to entry \a to of \a dst, both nodes
+  /// of the same kind.
+  static void moveEntry(Node *src, unsigned from, Node *dst, unsigned to) {
+    if (src->leaf) {
+      Leaf *s = static_cast<Leaf *>(src), *d = static_cast<Leaf *>(dst);
+      d->values[to] = s->values[from];
+      s->values[from] = value_type();
+    } else {
+      Inner *s = static_cast<Inner *>(src), *d = static_cast<Inner *>(dst);
+      d->keys[to] = s->keys[from];
+      d->children[to] = s->children[from];
+      s->keys[from] = K();
+    }
+  }
+
+  /// Remove \a k, which must be in the subtree of \a slot.
+  static void removeRec(Node *&slot, const K &k) {
+    Node *n = getWriteable(slot);
+    if (n->leaf) {
+      Leaf *l = static_cast<Leaf *>(n);
+      unsigned p = lowerBound(l, k);
+      for (unsigned i = p + 1; i < l->count; ++i)
+        l->values[i - 1] = l->values[i];
+      l->values[--l->count] = value_type();
+      return;
+    }
+
+    Inner *in = static_cast<Inner *>(n);
+    unsigned i = childIndex(in, k);
+    removeRec(in->children[i], k);
+    Node *child = in->children[i];
+    if (child->count && !CMP()(in->keys[i], k))
+      in->keys[i] = minKey(child);
+    if (child->count < Order / 2)
+      rebalance(in, i);
+    // Only the root may end up with a single empty child.
+    if (in->count == 1 && in->children[0]->count == 0) {
+      release(in->children[0]);
+      in->keys[0] = K();
+      in->count = 0;
+    }
+  }
+
+public:
+  BTreeMap() : root(0), numElements(0) {}
+  BTreeMap(const BTreeMap &b) : root(b.root), numElements(b.numElements) {
+    if (root)
+      ++root->refCount;
+  }
+  ~BTreeMap() {
+    if (root)
+      release(root);
+  }
+
+  BTreeMap &operator=(const BTreeMap &b) {
+    if (b.root)
+      ++b.root->refCount;
+    if (root)
+      release(root);
+    root = b.root;
+    numElements = b.numElements;
+    return *this;
+  }
+
+  bool empty() const { return numElements == 0; }
+  size_t size() const { return numElements; }
+
+  /// Return the last value whose key is less than or equal to \a k, or
+  /// null if there is no such value.
+  const value_type *lookup_previous(const key_type &k) const {
+    const Node *n = root;
+    if (!n)
+      return 0;
+    while (!n->leaf) {
+      unsigned i = upperBound(asInner(n), k);
+      if (!i)
+        return 0;
+      n = asInner(n)->children[i - 1];
+    }
+    unsigned i = upperBound(asLeaf(n), k);
+    return i ? &asLeaf(n)->values[i - 1] : 0;
+  }
+
+  const value_type *lookup(const key_type &k) const {
+    const value_type *res = lookup_previous(k);
+    return res && !CMP()(res->first, k) ? res : 0;
+  }
+
+  size_t count(const key_type &k) const { return lookup(k) ? 1 : 0; }
+
+  const value_type &min() const { return *begin(); }
+  const value_type &max() const { return *--end(); }
+
+  /// Insert \a v, leaving the map unchanged if its key is present.
+  void insert(const value_type &v) {
+    if (!lookup(v.first))
+      replace(v);
+  }
+
+  /// Insert \a v, replacing the value with the same key if there is one.
+  void replace(const value_type &v) {
+    if (!root) {
+      Leaf *l = new Leaf();
+      l->values[0] = v;
+      l->count = 1;
+      root = l;
+      numElements = 1;
+      return;
+    }
+    Node *split = 0;
+    if (insertRec(root, v, true, split))
+      ++numElements;
+    if (split) {
+      Inner *r = new Inner();
+      r->keys[0] = minKey(root);
+      r->children[0] = root;
+      r->keys[1] = minKey(split);
+      r->children[1] = split;
+      r->count = 2;
+      root = r;
+    }
+  }
+
+  void remove(const key_type &k) {
+    if (!lookup(k))
+      return;
+    removeRec(root, k);
+    --numElements;
+    if (root->count == 0) {
+      release(root);
+      root = 0;
+      return;
+    }
+    while (!root->leaf && root->count == 1) {
+      Node *child = asInner(root)->children[0];
+      ++child->refCount;
+      release(root);
+      root = child;
+    }
+  }
+
+  iterator begin() const {
+    iterator it(root);
+    if (root)
+      it.descend(root, true);
+    return it;
+  }
+  iterator end() const { return iterator(root); }
+
+  /// Return an iterator to the first value whose key is not less than
+  /// \a k.
+  iterator lower_bound(const key_type &k) const {
+    return search(k, false);
+  }
+  /// Return an iterator to the first value whose key is greater than
+  /// \a k.
+  iterator upper_bound(const key_type &k) const { return search(k, true); }
+
+  iterator find(const key_type &k) const {
+    iterator it = lower_bound(k);
+    if (it != end() && CMP()(k, it->first))
+      return end();
+    return it;
+  }
+
+private:
+  iterator search(const key_type &k, bool upper) const {
+    iterator it(root);
+    const Node *n = root;
+    if (!n)
+      return it;
+    while (!n->leaf) {
+      unsigned i = childIndex(asInner(n), k);
+      it.push(n, i);
+      n = asInner(n)->children[i];
+    }
+    unsigned p = upper ? upperBound(asLeaf(n), k) : lowerBound(asLeaf(n), k);
+    if (p < n->count) {
+      it.push(n, p);
+    } else {
+      // The value is the first one of the next leaf.
+      it.push(n, p - 1);
+      ++it;
+    }
+    return it;
+  }
+
+public:
+  /// A bidirectional iterator, which is invalidated by modifications of
+  /// the map it belongs to. Replacing the value of a present key does not
+  /// change the shape of the tree though, iterators stay usable across it
+  /// (but may still see the replaced value).
+  class iterator {
+    friend class BTreeMap;
+
+    const Node *root;
+    const Node *path[MaxDepth];
+    unsigned pos[MaxDepth];
+    /// The length of the path, 0 for the end iterator.
+    unsigned depth;
+
+    explicit iterator(const Node *_root) : root(_root), depth(0) {}
+
+    void push(const Node *n, unsigned p) {
+      if (depth == MaxDepth) {
+        fputs("KLEE: BTreeMap: tree too deep\n", stderr);
+        abort();
+      }
+      path[depth] = n;
+      pos[depth] = p;
+      ++depth;
+    }
+
+    /// Descend from \a n to its first (or last) value.
+    void descend(const Node *n, bool first) {
+      for (;;) {
+        unsigned p = first ? 0 : n->count - 1;
+        push(n, p);
+        if (n->leaf)
+          break;
+        n = asInner(n)->children[p];
+      }
+    }
+
+  public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef typename BTreeMap::value_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const value_type *pointer;
+    typedef const value_type &reference;
+
+    iterator() : root(0), depth(0) {}
+    iterator(const iterator &b) : root(b.root), depth(b.depth) {
+      for (unsigned i = 0; i < depth; ++i) {
+        path[i] = b.path[i];
+        pos[i] = b.pos[i];
+      }
+    }
+
+    iterator &operator=(const iterator &b) {
+      root = b.root;
+      depth = b.depth;
+      for (unsigned i = 0; i < depth; ++i) {
+        path[i] = b.path[i];
+        pos[i] = b.pos[i];
+      }
+      return *this;
+    }
+
+    const value_type &operator*() const {
+      assert(depth && "dereferencing end iterator");
+      return asLeaf(path[depth - 1])->values[pos[depth - 1]];
+    }
+    const value_type *operator->() const { return &**this; }
+
+    bool operator==(const iterator &b) const {
+      if (depth != b.depth)
+        return false;
+      return !depth || (path[depth - 1] == b.path[depth - 1] &&
+                        pos[depth - 1] == b.pos[depth - 1]);
+    }
+    bool operator!=(const iterator &b) const { return !(*this == b); }
+
+    iterator &operator++() {
+      assert(depth && "incrementing end iterator");
+      unsigned d = depth - 1;
+      if (++pos[d] < path[d]->count)
+        return *this;
+      while (d > 0) {
+        --d;
+        if (++pos[d] < path[d]->count) {
+          depth = d + 1;
+          descend(asInner(path[d])->children[pos[d]], true);
+          return *this;
+        }
+      }
+      depth = 0;
+      return *this;
+    }
+
+    iterator &operator--() {
+      if (!depth) {
+        assert(root && "decrementing begin iterator");
+        descend(root, false);
+        return *this;
+      }
+      unsigned d = depth - 1;
+      if (pos[d] > 0) {
+        --pos[d];
+        return *this;
+      }
+      while (d > 0) {
+        --d;
+        if (pos[d] > 0) {
+          --pos[d];
+          depth = d + 1;
+          descend(asInner(path[d])->children[pos[d]], false);
+          return *this;
+        }
+      }
+      assert(0 && "decrementing begin iterator");
+      return *this;
+    }
+  };
+};
+
+} // End klee namespace
+
+#endif
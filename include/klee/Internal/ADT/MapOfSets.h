@@ -11,6 +11,7 @@
 #define __UTIL_MAPOFSETS_H__
 
 #include <cassert>
+#include <stdint.h>
 #include <vector>
 #include <set>
 #include <map>
@@ -24,9 +25,21 @@
 
 namespace klee {
 
+  /// NoSetSignature - The default element signature of a MapOfSets, which
+  /// disables the signature based pruning of superset searches.
+  template<class K>
+  struct NoSetSignature {
+    uint64_t operator()(const K &) const { return 0; }
+  };
+
   /** This implements the UBTree data structure (see Hoffmann and
-      Koehler, "A New Method to Index and Query Sets", IJCAI 1999) */
-  template<class K, class V>
+      Koehler, "A New Method to Index and Query Sets", IJCAI 1999).
+
+      Every node also keeps the union of the signatures (a small bit set
+      given by \a Signature for each element) of the elements below it,
+      superset searches skip a subtree whose union lacks a bit of the
+      elements which remain to be matched. */
+  template<class K, class V, class Signature = NoSetSignature<K> >
   class MapOfSets {
   public:
     class iterator;
@@ -38,6 +51,9 @@ namespace klee {
 
     void insert(const std::set<K> &set, const V &value);
 
+    /// Remove the entry for \a set, returns false if there was none.
+    bool remove(const std::set<K> &set);
+
     V *lookup(const std::set<K> &set);
 
     iterator begin();
@@ -74,6 +90,7 @@ namespace klee {
     V *findSuperset(Node *n, 
                     typename std::set<K>::iterator begin, 
                     typename std::set<K>::iterator end,
+                    const uint64_t *need,
                     const Predicate &p);
     template<class Predicate>
     V *findSubset(Node *n, 
@@ -84,10 +101,10 @@ namespace klee {
 
   /***/
 
-  template<class K, class V>
-  class MapOfSets<K,V>::Node {
-    friend class MapOfSets<K,V>;
-    friend class MapOfSets<K,V>::iterator;
+  template<class K, class V, class Signature>
+  class MapOfSets<K,V,Signature>::Node {
+    friend class MapOfSets<K,V,Signature>;
+    friend class MapOfSets<K,V,Signature>::iterator;
 
   public:
     typedef std::map<K, Node> children_ty;
@@ -96,16 +113,18 @@ namespace klee {
 
   private:
     bool isEndOfSet;
+    /// The union of the signatures of the elements below this node.
+    uint64_t signature;
     std::map<K, Node> children;
     
   public:
-    Node() : isEndOfSet(false) {}
+    Node() : isEndOfSet(false), signature(0) {}
   };
   
-  template<class K, class V>
-  class MapOfSets<K,V>::iterator {
+  template<class K, class V, class Signature>
+  class MapOfSets<K,V,Signature>::iterator {
     typedef std::vector< typename std::map<K, Node>::iterator > stack_ty;
-    friend class MapOfSets<K,V>;
+    friend class MapOfSets<K,V,Signature>;
   private:
     Node *root;
     bool onEntry;
@@ -181,21 +200,65 @@ namespace klee {
 
   /***/
 
-  template<class K, class V>
-  MapOfSets<K,V>::MapOfSets() {}  
-
-  template<class K, class V>
-  void MapOfSets<K,V>::insert(const std::set<K> &set, const V &value) {
+  template<class K, class V, class Signature>
+  MapOfSets<K,V,Signature>::MapOfSets() {}  
+
+  template<class K, class V, class Signature>
+  void MapOfSets<K,V,Signature>::insert(const std::set<K> &set, const V &value) {
+    Signature sig;
+    std::vector<uint64_t> below(set.size() + 1, 0);
+    unsigned i = set.size();
+    for (typename std::set<K>::const_reverse_iterator it = set.rbegin(),
+           ie = set.rend(); it != ie; ++it, --i)
+      below[i - 1] = below[i] | sig(*it);
     Node *n = &root;
+    i = 0;
     for (typename std::set<K>::const_iterator it = set.begin(), ie = set.end();
-         it != ie; ++it)
+         it != ie; ++it, ++i) {
+      n->signature |= below[i];
       n = &n->children.insert(std::make_pair(*it, Node())).first->second;
+    }
     n->isEndOfSet = true;
     n->value = value;
   }
 
-  template<class K, class V>
-  V *MapOfSets<K,V>::lookup(const std::set<K> &set) {
+  template<class K, class V, class Signature>
+  bool MapOfSets<K,V,Signature>::remove(const std::set<K> &set) {
+    std::vector<Node*> path;
+    Node *n = &root;
+    for (typename std::set<K>::const_iterator it = set.begin(), ie = set.end();
+         it != ie; ++it) {
+      typename Node::children_ty::iterator kit = n->children.find(*it);
+      if (kit==n->children.end())
+        return false;
+      path.push_back(n);
+      n = &kit->second;
+    }
+    if (!n->isEndOfSet)
+      return false;
+    n->isEndOfSet = false;
+    n->value = V();
+
+    // Drop the nodes which no longer lead to a set and recompute the
+    // signatures along the path.
+    Signature sig;
+    typename std::set<K>::const_reverse_iterator rit = set.rbegin();
+    for (typename std::vector<Node*>::reverse_iterator it = path.rbegin(),
+           ie = path.rend(); it != ie; ++it, ++rit) {
+      Node *parent = *it;
+      if (!n->isEndOfSet && n->children.empty())
+        parent->children.erase(*rit);
+      parent->signature = 0;
+      for (typename Node::children_ty::iterator cit = parent->children.begin(),
+             cie = parent->children.end(); cit != cie; ++cit)
+        parent->signature |= sig(cit->first) | cit->second.signature;
+      n = parent;
+    }
+    return true;
+  }
+
+  template<class K, class V, class Signature>
+  V *MapOfSets<K,V,Signature>::lookup(const std::set<K> &set) {
     Node *n = &root;
     for (typename std::set<K>::const_iterator it = set.begin(), ie = set.end();
          it != ie; ++it) {
@@ -213,17 +276,17 @@ namespace klee {
     }
   }
 
-  template<class K, class V>
-  typename MapOfSets<K,V>::iterator 
-  MapOfSets<K,V>::begin() { return iterator(&root); }
+  template<class K, class V, class Signature>
+  typename MapOfSets<K,V,Signature>::iterator 
+  MapOfSets<K,V,Signature>::begin() { return iterator(&root); }
   
-  template<class K, class V>
-  typename MapOfSets<K,V>::iterator 
-  MapOfSets<K,V>::end() { return iterator(); }
+  template<class K, class V, class Signature>
+  typename MapOfSets<K,V,Signature>::iterator 
+  MapOfSets<K,V,Signature>::end() { return iterator(); }
 
-  template<class K, class V>
+  template<class K, class V, class Signature>
   template<class Iterator, class Vector>
-  void MapOfSets<K,V>::findSubsets(Node *n, 
+  void MapOfSets<K,V,Signature>::findSubsets(Node *n, 
                                   const std::set<K> &accum,
                                   Iterator begin, 
                                   Iterator end,
@@ -244,16 +307,16 @@ namespace klee {
     }
   }
 
-  template<class K, class V>
-  void MapOfSets<K,V>::subsets(const std::set<K> &set,
+  template<class K, class V, class Signature>
+  void MapOfSets<K,V,Signature>::subsets(const std::set<K> &set,
                                std::vector< std::pair<std::set<K>, 
                                                       V> > &resultOut) {
     findSubsets(&root, std::set<K>(), set.begin(), set.end(), resultOut);
   }
 
-  template<class K, class V>
+  template<class K, class V, class Signature>
   template<class Iterator, class Vector>
-  void MapOfSets<K,V>::findSupersets(Node *n, 
+  void MapOfSets<K,V,Signature>::findSupersets(Node *n, 
                                      const std::set<K> &accum,
                                      Iterator begin, 
                                      Iterator end,
@@ -286,15 +349,15 @@ namespace klee {
     }
   }
 
-  template<class K, class V>
-  void MapOfSets<K,V>::supersets(const std::set<K> &set,
+  template<class K, class V, class Signature>
+  void MapOfSets<K,V,Signature>::supersets(const std::set<K> &set,
                                std::vector< std::pair<std::set<K>, V> > &resultOut) {
     findSupersets(&root, std::set<K>(), set.begin(), set.end(), resultOut);
   }
 
-  template<class K, class V>
+  template<class K, class V, class Signature>
   template<class Predicate>
-  V *MapOfSets<K,V>::findSubset(Node *n, 
+  V *MapOfSets<K,V,Signature>::findSubset(Node *n, 
                                 typename std::set<K>::iterator begin, 
                                 typename std::set<K>::iterator end,
                                 const Predicate &p) {   
@@ -330,18 +393,21 @@ namespace klee {
     }
   }
   
-  template<class K, class V>
+  template<class K, class V, class Signature>
   template<class Predicate>
-  V *MapOfSets<K,V>::findSuperset(Node *n, 
+  V *MapOfSets<K,V,Signature>::findSuperset(Node *n, 
                                   typename std::set<K>::iterator begin, 
                                   typename std::set<K>::iterator end,
+                                  const uint64_t *need,
                                   const Predicate &p) {   
+    if (*need & ~n->signature)
+      return 0;
     if (begin==end) {
       if (n->isEndOfSet && p(n->value))
         return &n->value;
       for (typename Node::children_ty::iterator it = n->children.begin(),
              ie = n->children.end(); it != ie; ++it) {
-        V *res = findSuperset(&it->second, begin, end, p);
+        V *res = findSuperset(&it->second, begin, end, need, p);
         if (res) return res;
       }
     } else {
@@ -349,32 +415,42 @@ namespace klee {
         n->children.lower_bound(*begin);
       for (typename Node::children_ty::iterator it = n->children.begin(),
              ie = n->children.end(); it != ie; ++it) {
-        V *res = findSuperset(&it->second, begin, end, p);
+        V *res = findSuperset(&it->second, begin, end, need, p);
         if (res) return res;
       }
       if (kmid!=n->children.end() && *begin==kmid->first) {
-        V *res = findSuperset(&kmid->second, ++begin, end, p);
+        V *res = findSuperset(&kmid->second, ++begin, end, need + 1, p);
         if (res) return res;
       }
     }
     return 0;
   }
 
-  template<class K, class V>
+  template<class K, class V, class Signature>
   template<class Predicate>
-  V *MapOfSets<K,V>::findSuperset(const std::set<K> &set, const Predicate &p) {    
-    return findSuperset(&root, set.begin(), set.end(), p);
+  V *MapOfSets<K,V,Signature>::findSuperset(const std::set<K> &set, const Predicate &p) {    
+    // need[i] is the union of the signatures of the elements from the i-th
+    // one on, which a superset must have below the node matching the
+    // first i elements.
+    Signature sig;
+    std::vector<uint64_t> need(set.size() + 1, 0);
+    unsigned i = set.size();
+    for (typename std::set<K>::const_reverse_iterator it = set.rbegin(),
+           ie = set.rend(); it != ie; ++it, --i)
+      need[i - 1] = need[i] | sig(*it);
+    return findSuperset(&root, set.begin(), set.end(), &need[0], p);
   }
 
-  template<class K, class V>
+  template<class K, class V, class Signature>
   template<class Predicate>
-  V *MapOfSets<K,V>::findSubset(const std::set<K> &set, const Predicate &p) {    
+  V *MapOfSets<K,V,Signature>::findSubset(const std::set<K> &set, const Predicate &p) {    
     return findSubset(&root, set.begin(), set.end(), p);
   }
 
-  template<class K, class V>
-  void MapOfSets<K,V>::clear() {
+  template<class K, class V, class Signature>
+  void MapOfSets<K,V,Signature>::clear() {
     root.isEndOfSet = false;
+    root.signature = 0;
     root.value = V();
     root.children.clear();
   }
@@ -0,0 +1,183 @@
+//===-- PagedArray.h --------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_PAGEDARRAY_H
+#define KLEE_PAGEDARRAY_H
+
+#include <cassert>
+#include <stdint.h>
+#include <vector>
+
+namespace klee {
+
+/// PagedArray - A fixed size array which is split into pages of PageSize
+/// elements. Copies of an array share their pages, a page is only copied
+/// when it is about to be modified while shared. Filling the array makes
+/// all of its pages share a single page.
+template <class T, unsigned PageSize> class PagedArray {
+  struct Page {
+    unsigned refCount;
+    std::vector<T> elems;
+
+    Page(unsigned n, const T &value) : refCount(1), elems(n, value) {}
+    Page(const Page &p) : refCount(1), elems(p.elems) {}
+  };
+
+  std::vector<Page *> pages;
+  unsigned size;
+
+  static void release(Page *p) {
+    if (--p->refCount == 0)
+      delete p;
+  }
+
+  unsigned getPageLength(unsigned page) const {
+    unsigned base = page * PageSize;
+    return size - base < PageSize ? size - base : PageSize;
+  }
+
+  Page *getWriteablePage(unsigned page) {
+    Page *&p = pages[page];
+    if (p->refCount > 1) {
+      --p->refCount;
+      p = new Page(*p);
+    }
+    return p;
+  }
+
+  // DO NOT IMPLEMENT
+  PagedArray &operator=(const PagedArray &);
+
+public:
+  PagedArray(unsigned _size, const T &value = T())
+      : pages((_size + PageSize - 1) / PageSize), size(_size) {
+    fill(value);
+  }
+
+  PagedArray(const PagedArray &b) : pages(b.pages), size(b.size) {
+    for (unsigned i = 0; i < pages.size(); ++i)
+      ++pages[i]->refCount;
+  }
+
+  ~PagedArray() {
+    for (unsigned i = 0; i < pages.size(); ++i)
+      release(pages[i]);
+  }
+
+  unsigned getSize() const { return size; }
+
+  const T &get(unsigned idx) const {
+    assert(idx < size && "out of bounds paged array access");
+    return pages[idx / PageSize]->elems[idx % PageSize];
+  }
+
+  void set(unsigned idx, const T &value) {
+    assert(idx < size && "out of bounds paged array access");
+    getWriteablePage(idx / PageSize)->elems[idx % PageSize] = value;
+  }
+
+  /// Set all elements to \a value. All full pages share one page.
+  void fill(const T &value) {
+    Page *full = 0;
+    for (unsigned i = 0; i < pages.size(); ++i) {
+      Page *old = pages[i];
+      unsigned n = getPageLength(i);
+      if (n == PageSize) {
+        if (full) {
+          ++full->refCount;
+        } else {
+          full = new Page(n, value);
+        }
+        pages[i] = full;
+      } else {
+        pages[i] = new Page(n, value);
+      }
+      if (old)
+        release(old);
+    }
+  }
+
+  /// Copy the elements to \a dst.
+  void copyOut(T *dst) const {
+    for (unsigned i = 0; i < pages.size(); ++i) {
+      const std::vector<T> &elems = pages[i]->elems;
+      for (unsigned j = 0, e = elems.size(); j != e; ++j)
+        *dst++ = elems[j];
+    }
+  }
+
+  /// Return true if the elements equal the ones at \a src.
+  bool equals(const T *src) const {
+    for (unsigned i = 0; i < pages.size(); ++i) {
+      const std::vector<T> &elems = pages[i]->elems;
+      for (unsigned j = 0, e = elems.size(); j != e; ++j)
+        if (!(*src++ == elems[j]))
+          return false;
+    }
+    return true;
+  }
+
+  /// Copy the elements from \a src, pages which do not change are left
+  /// shared.
+  void copyIn(const T *src) {
+    for (unsigned i = 0; i < pages.size(); ++i, src += PageSize) {
+      unsigned n = getPageLength(i);
+      const std::vector<T> &elems = pages[i]->elems;
+      unsigned j = 0;
+      while (j != n && src[j] == elems[j])
+        ++j;
+      if (j == n)
+        continue;
+      std::vector<T> &writeable = getWriteablePage(i)->elems;
+      for (; j != n; ++j)
+        writeable[j] = src[j];
+    }
+  }
+};
+
+/// PagedBitArray - A copy-on-write paged version of BitArray.
+class PagedBitArray {
+  // 128 words cover as many bits as a page of a PagedArray<uint8_t, 4096>
+  // has bytes.
+  PagedArray<uint32_t, 128> words;
+
+  static unsigned length(unsigned size) { return (size + 31) / 32; }
+
+public:
+  PagedBitArray(unsigned size, bool value = false)
+      : words(length(size), value ? 0xFFFFFFFF : 0) {}
+  PagedBitArray(const PagedBitArray &b, unsigned size) : words(b.words) {
+    assert(length(size) == words.getSize() && "size mismatch");
+  }
+
+  bool get(unsigned idx) const {
+    return (words.get(idx / 32) >> (idx & 0x1F)) & 1;
+  }
+  // Setting a bit to its current value does not copy a shared page.
+  void set(unsigned idx) {
+    uint32_t w = words.get(idx / 32);
+    if (!(w & (1 << (idx & 0x1F))))
+      words.set(idx / 32, w | (1 << (idx & 0x1F)));
+  }
+  void unset(unsigned idx) {
+    uint32_t w = words.get(idx / 32);
+    if (w & (1 << (idx & 0x1F)))
+      words.set(idx / 32, w & ~(1 << (idx & 0x1F)));
+  }
+  void set(unsigned idx, bool value) {
+    if (value)
+      set(idx);
+    else
+      unset(idx);
+  }
+};
+
+} // End klee namespace
+
+#endif
@@ -0,0 +1,161 @@
+//===-- SlabAllocator.h -----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_SLABALLOCATOR_H
+#define KLEE_SLABALLOCATOR_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+namespace klee {
+
+/// SlabAllocator - Hands out fixed size slots which are carved out of
+/// large slabs. Freed slots are kept on a free list and handed out again
+/// first, so both allocation and deallocation are O(1). Slabs are returned
+/// to the system by releaseEmptySlabs(), or when the allocator is
+/// destroyed.
+class SlabAllocator {
+  struct FreeSlot {
+    FreeSlot *next;
+  };
+
+  size_t slotSize;
+  size_t slotsPerSlab;
+  std::vector<char *> slabs;
+  FreeSlot *freeList;
+  size_t slotsInUse;
+
+  // DO NOT IMPLEMENT
+  SlabAllocator(const SlabAllocator &);
+  void operator=(const SlabAllocator &);
+
+  /// Index of the slab holding \a p, the slabs must be sorted.
+  size_t findSlab(char *p) const {
+    std::vector<char *>::const_iterator it =
+        std::upper_bound(slabs.begin(), slabs.end(), p, std::less<char *>());
+    assert(it != slabs.begin() && "slot outside of the slabs");
+    return it - slabs.begin() - 1;
+  }
+
+  void addSlab() {
+    char *slab = (char *)malloc(slotSize * slotsPerSlab);
+    if (!slab)
+      return;
+    slabs.push_back(slab);
+    // Thread the new slots onto the free list in address order.
+    for (size_t i = slotsPerSlab; i--;) {
+      FreeSlot *slot = (FreeSlot *)(slab + i * slotSize);
+      slot->next = freeList;
+      freeList = slot;
+    }
+  }
+
+public:
+  /// \param _slotSize - The size of every slot, it is rounded up to a
+  /// multiple of 16 so that all slots are 16 byte aligned.
+  /// \param slabSize - The approximate size of the slabs.
+  explicit SlabAllocator(size_t _slotSize, size_t slabSize = 64 * 1024)
+      : slotSize((_slotSize + 15) & ~(size_t)15), freeList(0), slotsInUse(0) {
+    slotsPerSlab = slabSize / slotSize;
+    if (slotsPerSlab < 16)
+      slotsPerSlab = 16;
+  }
+
+  ~SlabAllocator() {
+    for (std::vector<char *>::iterator it = slabs.begin(), ie = slabs.end();
+         it != ie; ++it)
+      free(*it);
+  }
+
+  /// Return a free slot, or null if no memory is left.
+  void *allocate() {
+    if (!freeList)
+      addSlab();
+    FreeSlot *slot = freeList;
+    if (slot) {
+      freeList = slot->next;
+      ++slotsInUse;
+    }
+    return slot;
+  }
+
+  void deallocate(void *p) {
+    assert(slotsInUse && "deallocating from an empty slab allocator");
+    FreeSlot *slot = (FreeSlot *)p;
+    slot->next = freeList;
+    freeList = slot;
+    --slotsInUse;
+  }
+
+  /// Return the slabs whose slots are all free to the system. This walks
+  /// the whole free list, so it is meant to be called rarely, e.g. when
+  /// the memory cap is reached. Returns the number of bytes released.
+  size_t releaseEmptySlabs() {
+    size_t numSlots = slabs.size() * slotsPerSlab;
+    if (slotsInUse == numSlots)
+      return 0;
+
+    // Count the free slots of every slab, the slabs are sorted by
+    // address so that the slab of a slot can be found by bisection.
+    std::sort(slabs.begin(), slabs.end(), std::less<char *>());
+    std::vector<size_t> numFree(slabs.size());
+    for (FreeSlot *slot = freeList; slot; slot = slot->next)
+      ++numFree[findSlab((char *)slot)];
+
+    std::vector<bool> empty(slabs.size());
+    bool any = false;
+    for (size_t i = 0; i != slabs.size(); ++i)
+      if (numFree[i] == slotsPerSlab)
+        empty[i] = any = true;
+    if (!any)
+      return 0;
+
+    // Unlink the slots of the empty slabs, keeping the order of the rest.
+    FreeSlot **link = &freeList;
+    while (*link) {
+      if (empty[findSlab((char *)*link)])
+        *link = (*link)->next;
+      else
+        link = &(*link)->next;
+    }
+
+    size_t released = 0;
+    std::vector<char *> kept;
+    for (size_t i = 0; i != slabs.size(); ++i) {
+      if (empty[i]) {
+        free(slabs[i]);
+        released += slotsPerSlab * slotSize;
+      } else {
+        kept.push_back(slabs[i]);
+      }
+    }
+    slabs.swap(kept);
+    return released;
+  }
+
+  size_t getSlotSize() const { return slotSize; }
+
+  /// The number of slabs obtained from the system.
+  size_t getNumSlabs() const { return slabs.size(); }
+
+  /// Bytes obtained from the system.
+  size_t getReservedSize() const {
+    return slabs.size() * slotsPerSlab * slotSize;
+  }
+
+  /// Bytes in slots that are currently handed out.
+  size_t getUsedSize() const { return slotsInUse * slotSize; }
+};
+
+} // End klee namespace
+
+#endif
@@ -15,8 +15,60 @@
 namespace klee {
   class MemoryObject;
 
+  /// Cell - The value of a register or constant. Constants of up to 64
+  /// bits are kept inline, so that the interpreter can operate on them
+  /// directly; the corresponding ConstantExpr is only created when a
+  /// client asks for the value as an expression.
   struct Cell {
-    ref<Expr> value;
+  private:
+    /// The value, may be null if it is an inline constant which has not
+    /// been requested as an expression yet.
+    mutable ref<Expr> expr;
+    uint64_t constant;
+    /// The width of the inline constant, or 0 if the value is not one.
+    Expr::Width constantWidth;
+
+  public:
+    Cell() : constant(0), constantWidth(0) {}
+
+    /// Return true if the value is a constant that is kept inline.
+    bool isConstant() const { return constantWidth != 0; }
+    uint64_t getConstant() const { return constant; }
+    Expr::Width getConstantWidth() const { return constantWidth; }
+
+    const ref<Expr> &getValue() const {
+      if (expr.isNull() && constantWidth) {
+        if (constantWidth == Expr::Bool) {
+          // Branch conditions, avoid creating these over and over again.
+          static const ref<Expr> False = ConstantExpr::create(0, Expr::Bool);
+          static const ref<Expr> True = ConstantExpr::create(1, Expr::Bool);
+          expr = constant ? True : False;
+        } else {
+          expr = ConstantExpr::create(constant, constantWidth);
+        }
+      }
+      return expr;
+    }
+
+    void setValue(const ref<Expr> &value) {
+      expr = value;
+      ConstantExpr *ce = value.isNull() ? 0 : dyn_cast<ConstantExpr>(value);
+      if (ce && ce->getWidth() <= Expr::Int64) {
+        constant = ce->getZExtValue();
+        constantWidth = ce->getWidth();
+      } else {
+        constantWidth = 0;
+      }
+    }
+
+    /// Set the value to the constant \a value of the given width, which
+    /// must be at most 64 bits. Bits above the width are ignored.
+    void setConstant(uint64_t value, Expr::Width width) {
+      assert(width && width <= Expr::Int64 && "invalid inline constant width");
+      expr = 0;
+      constant = width == Expr::Int64 ? value : value & ((1ULL << width) - 1);
+      constantWidth = width;
+    }
   };
 }
 
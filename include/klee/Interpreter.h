@@ -41,9 +41,30 @@ public:
 
   virtual void incPathsExplored() = 0;
 
+  virtual unsigned getNumPathsExplored() = 0;
+  virtual unsigned getNumTestCases() = 0;
+
   virtual void processTestCase(const ExecutionState &state,
-                               const char *err, 
+                               const char *err,
                                const char *suffix) = 0;
+
+  /// Called in every exploration worker process right after the
+  /// interpreter split its states across \a numWorkers processes
+  /// (\see --parallel-workers). Worker 0 is the original process.
+  /// Handlers should make sure that the output of different workers
+  /// does not collide.
+  virtual void setWorker(unsigned index, unsigned numWorkers) {}
+
+  /// Called in worker 0 for every other worker once it has finished,
+  /// with the number of paths and test cases the worker produced.
+  virtual void addWorkerResults(unsigned pathsExplored,
+                                unsigned numTestCases) {}
+
+  /// Called when resuming from a checkpoint with the number of paths
+  /// and test cases of the run which wrote it, counting continues from
+  /// there.
+  virtual void setResumedResults(unsigned pathsExplored,
+                                 unsigned numTestCases) {}
 };
 
 class Interpreter {
@@ -127,6 +148,10 @@ public:
   // for the search. use null to reset.
   virtual void useSeeds(const std::vector<struct KTest *> *seeds) = 0;
 
+  // supply a checkpoint file written by an earlier run to continue its
+  // exploration from. use an empty path to reset.
+  virtual void setResumeCheckpoint(const std::string &path) = 0;
+
   virtual void runFunctionAsMain(llvm::Function *f,
                                  int argc,
                                  char **argv,
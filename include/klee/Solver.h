@@ -18,6 +18,7 @@
 namespace klee {
   class ConstraintManager;
   class Expr;
+  class QueryLatencyHistogram;
   class SolverImpl;
 
   struct Query {
@@ -226,6 +227,14 @@ namespace klee {
   /// \param s - The underlying solver to use.
   Solver *createCachingSolver(Solver *s);
 
+  /// createPersistentCachingSolver - Create a solver which caches query
+  /// results and counterexamples in the file at \a path, so that they can
+  /// be reused by later runs and by other processes using the same file.
+  ///
+  /// \param s - The underlying solver to use.
+  /// \param path - The cache file, which is created if it does not exist.
+  Solver *createPersistentCachingSolver(Solver *s, const std::string &path);
+
   /// createCexCachingSolver - Create a counterexample caching solver. This is a
   /// more sophisticated cache which records counterexamples for a constraint
   /// set and uses subset/superset relations among constraints to try and
@@ -259,10 +268,36 @@ namespace klee {
                                     int minQueryTimeToLog);
 
 
+  /// createLatencyHistogramSolver - Create a solver which will forward all
+  /// queries and record their latency in \a histogram.
+  Solver *createLatencyHistogramSolver(Solver *s,
+                                       QueryLatencyHistogram &histogram);
+
+  /// createSlowestKQueryLoggingSolver - Create a solver which will forward
+  /// all queries and, when it is destroyed, write the \a count slowest ones
+  /// to the given path in .kquery format.
+  Solver *createSlowestKQueryLoggingSolver(Solver *s, std::string path,
+                                           unsigned count);
+
+  /// createForkedSolver - Create a solver which runs every query of \a s
+  /// in a forked process, so that a crashing backend does not take KLEE
+  /// with it and a query which overruns the solver timeout can be killed.
+  /// \a s must not fork itself.
+  Solver *createForkedSolver(Solver *s);
+
   /// createDummySolver - Create a dummy solver implementation which always
   /// fails.
   Solver *createDummySolver();
 
+  /// createPortfolioSolver - Create a core solver which runs every query on
+  /// all of the given backends at the same time, each in a forked process,
+  /// and uses the first answer.
+  ///
+  /// \param backends - The backends and their types, which must be core
+  /// solvers that do not fork themselves.
+  Solver *createPortfolioSolver(
+      const std::vector<std::pair<CoreSolverType, Solver *> > &backends);
+
   // Create a solver based on the supplied ``CoreSolverType``.
   Solver *createCoreSolver(CoreSolverType cst);
 }
@@ -12,19 +12,62 @@
 
 #include "klee/Statistic.h"
 
+#include <stdint.h>
+
 namespace klee {
+
+  /// QueryLatencyHistogram - The number of queries answered by a solver,
+  /// bucketed by their latency in powers of ten from 10us to 10s.
+  class QueryLatencyHistogram {
+  public:
+    static const unsigned NumBuckets = 8;
+
+  private:
+    const char *name;
+    uint64_t counts[NumBuckets];
+
+  public:
+    explicit QueryLatencyHistogram(const char *_name);
+
+    const char *getName() const { return name; }
+    uint64_t getCount(unsigned bucket) const { return counts[bucket]; }
+    /// The upper bound of the bucket, e.g. "10ms" for the queries which
+    /// took between 1ms and 10ms, "inf" for the last one.
+    static const char *getBucketName(unsigned bucket);
+
+    void record(double seconds);
+  };
+
 namespace stats {
 
   extern Statistic cexCacheTime;
+  extern Statistic portfolioWinsMetaSMT;
+  extern Statistic portfolioWinsSTP;
+  extern Statistic portfolioWinsZ3;
   extern Statistic queries;
   extern Statistic queriesInvalid;
   extern Statistic queriesValid;
   extern Statistic queryCacheHits;
   extern Statistic queryCacheMisses;
+  extern Statistic queryCexCacheBytes;
+  extern Statistic queryCexCacheEntries;
+  extern Statistic queryCexCacheEvictions;
+  extern Statistic queryCexCacheFreedBytes;
   extern Statistic queryCexCacheHits;
   extern Statistic queryCexCacheMisses;
+  /// The number of translations held by the construct caches of the
+  /// solver builders, an entry count and not a size in bytes.
+  extern Statistic queryConstructCacheEntries;
+  extern Statistic queryConstructCacheEvictions;
+  extern Statistic queryConstructCacheHits;
+  extern Statistic queryConstructCacheMisses;
   extern Statistic queryConstructTime;
   extern Statistic queryConstructs;
+  extern Statistic queryIncrementalHits;
+  extern Statistic queryIncrementalMisses;
+  extern Statistic queryIncrementalReused;
+  extern Statistic queryPersistentCacheHits;
+  extern Statistic queryPersistentCacheMisses;
   extern Statistic queryCounterexamples;
   extern Statistic queryTime;
   
@@ -32,6 +75,13 @@ namespace stats {
   extern Statistic arrayHashTime;
 #endif
 
+  /// Query latencies at the layers of the solver chain, only recorded with
+  /// --query-latency-histograms.
+  extern QueryLatencyHistogram cacheQueryLatency;
+  extern QueryLatencyHistogram cexCacheQueryLatency;
+  extern QueryLatencyHistogram coreQueryLatency;
+  extern QueryLatencyHistogram independentQueryLatency;
+
 }
 }
 
@@ -45,6 +45,7 @@ namespace klee {
     uint64_t *indexedStats;
     StatisticRecord *contextStats;
     unsigned index;
+    unsigned totalIndices;
 
   public:
     StatisticManager();
@@ -52,17 +53,25 @@ namespace klee {
 
     void useIndexedStats(unsigned totalIndices);
 
+    /// While disabled, increments of all statistics are ignored.
+    void setEnabled(bool _enabled) { enabled = _enabled; }
+    bool isEnabled() const { return enabled; }
+
     StatisticRecord *getContext();
     void setContext(StatisticRecord *sr); /* null to reset */
 
     void setIndex(unsigned i) { index = i; }
     unsigned getIndex() { return index; }
     unsigned getNumStatistics() { return stats.size(); }
+    /// Number of indices tracked by indexed statistics, zero when
+    /// indexed statistics are not in use.
+    unsigned getNumIndices() const { return totalIndices; }
     Statistic &getStatistic(unsigned i) { return *stats[i]; }
     
     void registerStatistic(Statistic &s);
     void incrementStatistic(Statistic &s, uint64_t addend);
     uint64_t getValue(const Statistic &s) const;
+    void setValue(const Statistic &s, uint64_t value);
     void incrementIndexedValue(const Statistic &s, unsigned index, 
                                uint64_t addend) const;
     uint64_t getIndexedValue(const Statistic &s, unsigned index) const;
@@ -133,6 +142,10 @@ namespace klee {
     return globalStats[s.id];
   }
 
+  inline void StatisticManager::setValue(const Statistic &s, uint64_t value) {
+    globalStats[s.id] = value;
+  }
+
   inline void StatisticManager::incrementIndexedValue(const Statistic &s, 
                                                       unsigned index,
                                                       uint64_t addend) const {
@@ -22,6 +22,7 @@
 #define unordered_set std::tr1::unordered_set
 #endif
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -67,12 +68,28 @@ public:
                            Expr::Width _domain = Expr::Int32,
                            Expr::Width _range = Expr::Int8);
 
+  /// Create a constant Array object, or return the one created earlier by
+  /// this method with the same size, contents, domain and range.
+  ///
+  /// Arrays which are created over and over from the contents of memory,
+  /// such as the folded updates of an object, are thereby only kept once
+  /// per distinct contents. \a _name is only used for a new array.
+  const Array *
+  CreateSharedConstantArray(const std::string &_name, uint64_t _size,
+                            const ref<ConstantExpr> *constantValuesBegin,
+                            const ref<ConstantExpr> *constantValuesEnd,
+                            Expr::Width _domain = Expr::Int32,
+                            Expr::Width _range = Expr::Int8);
+
 private:
   typedef unordered_set<const Array *, klee::ArrayHashFn,
                         klee::EquivArrayCmpFn> ArrayHashMap;
   ArrayHashMap cachedSymbolicArrays;
   typedef std::vector<const Array *> ArrayPtrVec;
   ArrayPtrVec concreteArrays;
+  /// The shared constant arrays by the hash of their contents, they are
+  /// owned by concreteArrays.
+  std::multimap<unsigned, const Array *> sharedConstantArrays;
 };
 }
 
@@ -13,8 +13,30 @@
 #include "klee/Expr.h"
 #include "klee/util/ExprVisitor.h"
 
+#include <map>
+
 namespace klee {
   class ExprEvaluator : public ExprVisitor {
+  private:
+    /// UpdateIndex - The newest update at every index of an update list,
+    /// down to the first update whose index does not evaluate to a
+    /// constant.
+    struct UpdateIndex {
+      /// Keeps the indexed update nodes alive.
+      UpdateList updates;
+      std::map<uint64_t, const UpdateNode*> nodes;
+      /// The first update with a non-constant index, or null.
+      const UpdateNode *barrier;
+
+      UpdateIndex(const UpdateList &_updates)
+        : updates(_updates), barrier(0) {}
+    };
+
+    /// The indices of the long update lists read so far.
+    std::map<const UpdateNode*, UpdateIndex> updateIndices;
+
+    const UpdateIndex &getUpdateIndex(const UpdateList &ul);
+
   protected:
     Action evalRead(const UpdateList &ul, unsigned index);
     Action visitRead(const ReadExpr &re);
@@ -0,0 +1,77 @@
+//===-- RefCount.h ----------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_REFCOUNT_H
+#define KLEE_REFCOUNT_H
+
+#ifdef KLEE_ATOMIC_REFCOUNT
+#include <atomic>
+#endif
+
+namespace klee {
+
+/// RefCount - The reference count of a node which is managed by ref<T>.
+///
+/// By default this is a plain integer. When KLEE is configured with
+/// -DENABLE_ATOMIC_REFCOUNT=ON (which defines KLEE_ATOMIC_REFCOUNT) the
+/// count is atomic, so that expressions and update lists may be shared
+/// between threads. Increments are relaxed and only the decrement which
+/// can free the node orders the accesses before it.
+class RefCount {
+#ifdef KLEE_ATOMIC_REFCOUNT
+  std::atomic<unsigned> count;
+#else
+  unsigned count;
+#endif
+
+public:
+  RefCount() : count(0) {}
+  // A copy of a node is a new node, nothing refers to it yet.
+  RefCount(const RefCount &) : count(0) {}
+  RefCount &operator=(const RefCount &) { return *this; }
+
+#ifdef KLEE_ATOMIC_REFCOUNT
+  operator unsigned() const { return count.load(std::memory_order_relaxed); }
+
+  unsigned operator++() {
+    return count.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  unsigned operator--() {
+    return count.fetch_sub(1, std::memory_order_acq_rel) - 1;
+  }
+
+  /// Take a reference unless the count already dropped to zero, i.e. the
+  /// node is being deleted by another thread.
+  bool tryRetain() {
+    unsigned c = count.load(std::memory_order_relaxed);
+    do {
+      if (c == 0)
+        return false;
+    } while (!count.compare_exchange_weak(c, c + 1,
+                                          std::memory_order_relaxed));
+    return true;
+  }
+#else
+  operator unsigned() const { return count; }
+  unsigned operator++() { return ++count; }
+  unsigned operator--() { return --count; }
+
+  bool tryRetain() {
+    if (count == 0)
+      return false;
+    ++count;
+    return true;
+  }
+#endif
+};
+
+} // end namespace klee
+
+#endif
@@ -38,6 +38,12 @@ UseCache("use-cache",
          cl::init(true),
          cl::desc("Use validity caching (default=on)"));
 
+cl::opt<std::string>
+PersistentQueryCache("persistent-query-cache",
+                     cl::desc("Cache query results in the given file and "
+                              "reuse them across runs (default=off)"),
+                     cl::value_desc("path"));
+
 cl::opt<bool>
 UseIndependentSolver("use-independent-solver",
                      cl::init(true),
@@ -66,11 +72,32 @@ UseForkedCoreSolver("use-forked-solver",
                     cl::desc("Run the core SMT solver in a forked process (default=on)"),
                     cl::init(true));
 
+cl::opt<bool>
+UseForkedZ3Solver("use-forked-z3",
+                  cl::desc("Run every Z3 query in a forked process, which loses the translations kept across queries (see --construct-cache-size) and has no effect with an incremental Z3 solver (default=off)"),
+                  cl::init(false));
+
 cl::opt<bool>
 CoreSolverOptimizeDivides("solver-optimize-divides", 
                           cl::desc("Optimize constant divides into add/shift/multiplies before passing to core SMT solver (default=off)"),
                           cl::init(false));
 
+cl::opt<unsigned>
+ConstructCacheSize("construct-cache-size",
+                   cl::desc("Keep the translations of up to this many expressions to the core SMT solver across queries (0=only within a query, default=65536)"),
+                   cl::init(65536));
+
+cl::opt<bool>
+QueryLatencyHistograms("query-latency-histograms",
+                       cl::init(false),
+                       cl::desc("Record histograms of the query latencies at the core solver and the caching and independence layers, written to run.stats (default=off)"));
+
+cl::opt<unsigned>
+SlowestQueriesToLog("log-slowest-queries",
+                    cl::init(0),
+                    cl::value_desc("N"),
+                    cl::desc("Write the N slowest queries reaching the core solver in .kquery format when the solver is destroyed (default=0 (off))"));
+
 cl::bits<QueryLoggingSolverType>
 queryLoggingOptions("use-query-log",
                     cl::desc("Log queries to a file. Multiple options can be specified separated by a comma. By default nothing is logged."),
@@ -166,10 +193,21 @@ CoreSolverToUse("solver-backend", cl::desc("Specifiy the core solver backend to
                 cl::values(clEnumValN(STP_SOLVER, "stp", "stp" STP_IS_DEFAULT_STR),
                            clEnumValN(METASMT_SOLVER, "metasmt", "metaSMT" METASMT_IS_DEFAULT_STR),
                            clEnumValN(DUMMY_SOLVER, "dummy", "Dummy solver"),
-                           clEnumValN(Z3_SOLVER, "z3", "Z3" Z3_IS_DEFAULT_STR)
+                           clEnumValN(Z3_SOLVER, "z3", "Z3" Z3_IS_DEFAULT_STR),
+                           clEnumValN(PORTFOLIO_SOLVER, "portfolio",
+                                      "Race the --portfolio-solvers against each other")
                            KLEE_LLVM_CL_VAL_END),
                 cl::init(DEFAULT_CORE_SOLVER));
 
+cl::list<CoreSolverType>
+PortfolioSolvers("portfolio-solvers",
+                 cl::desc("Backends used by the portfolio solver (default=all available)"),
+                 cl::values(clEnumValN(STP_SOLVER, "stp", "stp"),
+                            clEnumValN(METASMT_SOLVER, "metasmt", "metaSMT"),
+                            clEnumValN(Z3_SOLVER, "z3", "Z3")
+                            KLEE_LLVM_CL_VAL_END),
+                 cl::CommaSeparated);
+
 cl::opt<CoreSolverType>
 DebugCrossCheckCoreSolverWith("debug-crosscheck-core-solver",
                               cl::desc("Specifiy a solver to use for cross checking with the core solver"),
@@ -12,6 +12,7 @@
  */
 #include "klee/Common.h"
 #include "klee/CommandLine.h"
+#include "klee/SolverStats.h"
 #include "klee/Internal/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -20,9 +21,21 @@ Solver *constructSolverChain(Solver *coreSolver,
                              std::string querySMT2LogPath,
                              std::string baseSolverQuerySMT2LogPath,
                              std::string queryKQueryLogPath,
-                             std::string baseSolverQueryKQueryLogPath) {
+                             std::string baseSolverQueryKQueryLogPath,
+                             std::string slowestQueriesKQueryLogPath) {
   Solver *solver = coreSolver;
 
+  if (SlowestQueriesToLog) {
+    solver = createSlowestKQueryLoggingSolver(
+        solver, slowestQueriesKQueryLogPath, SlowestQueriesToLog);
+    klee_message("Logging the %u slowest queries in .kquery format to %s\n",
+                 SlowestQueriesToLog.getValue(),
+                 slowestQueriesKQueryLogPath.c_str());
+  }
+
+  if (QueryLatencyHistograms)
+    solver = createLatencyHistogramSolver(solver, stats::coreQueryLatency);
+
   if (queryLoggingOptions.isSet(SOLVER_KQUERY)) {
     solver = createKQueryLoggingSolver(solver, baseSolverQueryKQueryLogPath,
                                    MinQueryTimeToLog);
@@ -37,20 +50,33 @@ Solver *constructSolverChain(Solver *coreSolver,
                  baseSolverQuerySMT2LogPath.c_str());
   }
 
+  if (!PersistentQueryCache.empty())
+    solver = createPersistentCachingSolver(solver, PersistentQueryCache);
+
   if (UseAssignmentValidatingSolver)
     solver = createAssignmentValidatingSolver(solver);
 
   if (UseFastCexSolver)
     solver = createFastCexSolver(solver);
 
-  if (UseCexCache)
+  if (UseCexCache) {
     solver = createCexCachingSolver(solver);
+    if (QueryLatencyHistograms)
+      solver = createLatencyHistogramSolver(solver, stats::cexCacheQueryLatency);
+  }
 
-  if (UseCache)
+  if (UseCache) {
     solver = createCachingSolver(solver);
+    if (QueryLatencyHistograms)
+      solver = createLatencyHistogramSolver(solver, stats::cacheQueryLatency);
+  }
 
-  if (UseIndependentSolver)
+  if (UseIndependentSolver) {
     solver = createIndependentSolver(solver);
+    if (QueryLatencyHistograms)
+      solver =
+          createLatencyHistogramSolver(solver, stats::independentQueryLatency);
+  }
 
   if (DebugValidateSolver)
     solver = createValidatingSolver(solver, coreSolver);
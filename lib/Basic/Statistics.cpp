@@ -18,7 +18,8 @@ StatisticManager::StatisticManager()
     globalStats(0),
     indexedStats(0),
     contextStats(0),
-    index(0) {
+    index(0),
+    totalIndices(0) {
 }
 
 StatisticManager::~StatisticManager() {
@@ -28,6 +29,7 @@ StatisticManager::~StatisticManager() {
 
 void StatisticManager::useIndexedStats(unsigned totalIndices) {  
   delete[] indexedStats;
+  this->totalIndices = totalIndices;
   indexedStats = new uint64_t[totalIndices * stats.size()];
   memset(indexedStats, 0, sizeof(*indexedStats) * totalIndices * stats.size());
 }
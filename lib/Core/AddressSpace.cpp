@@ -15,18 +15,27 @@
 #include "klee/Expr.h"
 #include "klee/TimerStatIncrementer.h"
 
+#include "llvm/Support/CommandLine.h"
+
 using namespace klee;
 
+namespace {
+  llvm::cl::opt<bool>
+  ResolveBisect("resolve-bisect",
+                llvm::cl::desc("Resolve symbolic pointers by bisecting the address space, needs a number of queries logarithmic in the address range of the objects per object found (default=off)"),
+                llvm::cl::init(false));
+}
+
 ///
 
 void AddressSpace::bindObject(const MemoryObject *mo, ObjectState *os) {
   assert(os->copyOnWriteOwner==0 && "object already has owner");
   os->copyOnWriteOwner = cowKey;
-  objects = objects.replace(std::make_pair(mo, os));
+  objects.replace(std::make_pair(mo, os));
 }
 
 void AddressSpace::unbindObject(const MemoryObject *mo) {
-  objects = objects.remove(mo);
+  objects.remove(mo);
 }
 
 const ObjectState *AddressSpace::findObject(const MemoryObject *mo) const {
@@ -44,7 +53,7 @@ ObjectState *AddressSpace::getWriteable(const MemoryObject *mo,
   } else {
     ObjectState *n = new ObjectState(*os);
     n->copyOnWriteOwner = cowKey;
-    objects = objects.replace(std::make_pair(mo, n));
+    objects.replace(std::make_pair(mo, n));
     return n;    
   }
 }
@@ -100,6 +109,16 @@ bool AddressSpace::resolveOne(ExecutionState &state,
     }
 
     // didn't work, now we have to search
+
+    if (ResolveBisect) {
+      ResolutionList rl;
+      if (!resolveBisect(state, solver, address, rl, 1, 0, timer))
+        return false;
+      success = !rl.empty();
+      if (success)
+        result = rl[0];
+      return true;
+    }
        
     MemoryMap::iterator oi = objects.upper_bound(&hack);
     MemoryMap::iterator begin = objects.begin();
@@ -195,6 +214,27 @@ bool AddressSpace::resolve(ExecutionState &state,
       return true;
     uint64_t example = cex->getZExtValue();
     MemoryObject hack(example);
+
+    if (ResolveBisect) {
+      // Most pointers are in bounds of the object of the example.
+      if (const MemoryMap::value_type *res = objects.lookup_previous(&hack)) {
+        const MemoryObject *mo = res->first;
+        if (example - mo->address < mo->size) {
+          bool mustBeTrue;
+          if (!solver->mustBeTrue(state, mo->getBoundsCheckPointer(p),
+                                  mustBeTrue))
+            return true;
+          if (mustBeTrue) {
+            rl.push_back(*res);
+            return false;
+          }
+        }
+      }
+      if (!resolveBisect(state, solver, p, rl, maxResolutions, timeout_us,
+                         timer))
+        return true;
+      return maxResolutions && rl.size() == maxResolutions;
+    }
     
     MemoryMap::iterator oi = objects.upper_bound(&hack);
     MemoryMap::iterator begin = objects.begin();
@@ -285,6 +325,62 @@ bool AddressSpace::resolve(ExecutionState &state,
   return false;
 }
 
+bool AddressSpace::resolveBisect(ExecutionState &state, TimingSolver *solver,
+                                 ref<Expr> address, ResolutionList &rl,
+                                 unsigned maxResolutions, uint64_t timeout_us,
+                                 TimerStatIncrementer &timer) {
+  if (objects.empty())
+    return true;
+
+  // The runs of objects [first, last] which remain to be checked, the top
+  // of the stack is the lowest run. The runs are split at the middle of
+  // the addresses of their objects, so nothing but the objects found and
+  // the path to them is visited.
+  std::vector< std::pair<const MemoryMap::value_type *,
+                         const MemoryMap::value_type *> > runs;
+  runs.push_back(std::make_pair(&objects.min(), &objects.max()));
+  while (!runs.empty()) {
+    const MemoryMap::value_type *first = runs.back().first;
+    const MemoryMap::value_type *last = runs.back().second;
+    runs.pop_back();
+    if (timeout_us && timeout_us < timer.check())
+      return false;
+
+    const MemoryObject *lo = first->first, *hi = last->first;
+    ref<Expr> inBounds;
+    if (first == last) {
+      inBounds = lo->getBoundsCheckPointer(address);
+    } else {
+      // The run as one interval, including the gaps between its objects.
+      uint64_t end = hi->address + (hi->size ? hi->size : 1);
+      inBounds = UltExpr::create(lo->getOffsetExpr(address),
+                                 ConstantExpr::create(end - lo->address,
+                                   Context::get().getPointerWidth()));
+    }
+
+    bool mayBeTrue;
+    if (!solver->mayBeTrue(state, inBounds, mayBeTrue))
+      return false;
+    if (!mayBeTrue)
+      continue;
+
+    if (first == last) {
+      rl.push_back(*first);
+      if (rl.size() == maxResolutions)
+        return true;
+    } else {
+      // Both halves are non-empty, the upper one holds at least hi.
+      MemoryObject hack(lo->address + (hi->address - lo->address + 1) / 2);
+      MemoryMap::iterator mid = objects.lower_bound(&hack);
+      const MemoryMap::value_type *upper = &*mid;
+      runs.push_back(std::make_pair(upper, last));
+      runs.push_back(std::make_pair(first, &*--mid));
+    }
+  }
+
+  return true;
+}
+
 // These two are pretty big hack so we can sort of pass memory back
 // and forth to externals. They work by abusing the concrete cache
 // store inside of the object states, which allows them to
@@ -301,7 +397,7 @@ void AddressSpace::copyOutConcretes() {
       uint8_t *address = (uint8_t*) (unsigned long) mo->address;
 
       if (!os->readOnly)
-        memcpy(address, os->concreteStore, mo->size);
+        os->concreteStore.copyOut(address);
     }
   }
 }
@@ -315,12 +411,12 @@ bool AddressSpace::copyInConcretes() {
       const ObjectState *os = it->second;
       uint8_t *address = (uint8_t*) (unsigned long) mo->address;
 
-      if (memcmp(address, os->concreteStore, mo->size)!=0) {
+      if (!os->concreteStore.equals(address)) {
         if (os->readOnly) {
           return false;
         } else {
           ObjectState *wos = getWriteable(mo, os);
-          memcpy(wos->concreteStore, address, mo->size);
+          wos->concreteStore.copyIn(address);
         }
       }
     }
@@ -13,12 +13,13 @@
 #include "ObjectHolder.h"
 
 #include "klee/Expr.h"
-#include "klee/Internal/ADT/ImmutableMap.h"
+#include "klee/Internal/ADT/BTreeMap.h"
 
 namespace klee {
   class ExecutionState;
   class MemoryObject;
   class ObjectState;
+  class TimerStatIncrementer;
   class TimingSolver;
 
   template<class T> class ref;
@@ -31,7 +32,7 @@ namespace klee {
     bool operator()(const MemoryObject *a, const MemoryObject *b) const;
   };
   
-  typedef ImmutableMap<const MemoryObject*, ObjectHolder, MemoryObjectLT> MemoryMap;
+  typedef BTreeMap<const MemoryObject*, ObjectHolder, MemoryObjectLT> MemoryMap;
   
   class AddressSpace {
   private:
@@ -40,6 +41,17 @@ namespace klee {
 
     /// Unsupported, use copy constructor
     AddressSpace &operator=(const AddressSpace&); 
+
+    /// Find the objects \a address may point to by bisecting the address
+    /// ranges of the runs of objects it may point into, appending them to
+    /// \a rl in address order. Stops once \a maxResolutions (if non-zero)
+    /// objects were found.
+    ///
+    /// \return false iff a query failed or the timeout expired.
+    bool resolveBisect(ExecutionState &state, TimingSolver *solver,
+                       ref<Expr> address, ResolutionList &rl,
+                       unsigned maxResolutions, uint64_t timeout_us,
+                       TimerStatIncrementer &timer);
     
   public:
     /// The MemoryObject -> ObjectState map that constitutes the
@@ -0,0 +1,82 @@
+//===-- Checkpoint.h --------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_CHECKPOINT_H
+#define KLEE_CHECKPOINT_H
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace klee {
+
+  /// ForkChoice - A split in the fork history of a state: the choice the
+  /// state took, together with the instruction which split and the number
+  /// of states it split into, which are checked when the history is
+  /// replayed.
+  struct ForkChoice {
+    uint32_t instruction;
+    uint32_t numChoices;
+    uint32_t choice;
+  };
+
+  /// ResumeNode - A node of the trie of the fork histories in a
+  /// checkpoint, the children are indexed by the fork choice.
+  struct ResumeNode {
+    std::map<unsigned, ResumeNode*> children;
+    /// Whether the history of a checkpointed state ends here.
+    bool live;
+    /// The split recorded at this node, the replay must split the same
+    /// way. Zero choices if no history continues past the node.
+    uint32_t instruction, numChoices;
+
+    ResumeNode() : live(false), instruction(0), numChoices(0) {}
+
+    /// Return the child for \a fc, creating it if needed. Returns null if
+    /// \a fc disagrees with the split recorded at this node.
+    ResumeNode *addChild(const ForkChoice &fc);
+    ~ResumeNode();
+
+    const ResumeNode *getChild(unsigned choice) const {
+      std::map<unsigned, ResumeNode*>::const_iterator it =
+        children.find(choice);
+      return it == children.end() ? 0 : it->second;
+    }
+  };
+
+  /// Checkpoint - The contents of a checkpoint file. \see
+  /// Executor::writeCheckpoint()
+  struct Checkpoint {
+    /// The number of instructions of the module, used to detect that
+    /// the checkpoint was written for a different module.
+    uint32_t numInstructions;
+    uint64_t pathsExplored, numTestCases;
+
+    std::vector<std::string> statNames;
+    std::vector<uint64_t> statValues;
+    /// The indexed statistics, one value per statistic for every index.
+    uint32_t numIndices;
+    std::vector<uint64_t> indexedValues;
+
+    uint32_t numStates;
+    ResumeNode root;
+
+    Checkpoint()
+      : numInstructions(0), pathsExplored(0), numTestCases(0),
+        numIndices(0), numStates(0) {}
+
+    /// Read the checkpoint file at \a path, returns false and sets
+    /// \a error if it cannot be read.
+    bool read(const std::string &path, std::string &error);
+  };
+
+}
+
+#endif
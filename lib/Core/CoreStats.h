@@ -30,6 +30,14 @@ namespace stats {
   /// The number of process forks.
   extern Statistic forks;
 
+  /// The number of branch queries solved in a forked process.
+  /// \see --async-branch-queries
+  extern Statistic asyncBranchQueries;
+
+  /// The number of updates removed from update lists by compacting them.
+  /// \see --compact-update-lists
+  extern Statistic compactedUpdates;
+
   /// Number of states, this is a "fake" statistic used by istats, it
   /// isn't normally up-to-date.
   extern Statistic states;
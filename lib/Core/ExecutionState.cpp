@@ -73,12 +73,16 @@ ExecutionState::ExecutionState(KFunction *kf) :
     instsSinceCovNew(0),
     coveredNew(false),
     forkDisabled(false),
-    ptreeNode(0) {
+    ptreeNode(0),
+    spilled(false),
+    spillOffset(0),
+    madeExternalCall(false) {
   pushFrame(0, kf);
 }
 
 ExecutionState::ExecutionState(const std::vector<ref<Expr> > &assumptions)
-    : constraints(assumptions), queryCost(0.), ptreeNode(0) {}
+    : constraints(assumptions), queryCost(0.), ptreeNode(0), spilled(false),
+      spillOffset(0), madeExternalCall(false) {}
 
 ExecutionState::~ExecutionState() {
   for (unsigned int i=0; i<symbolics.size(); i++)
@@ -115,6 +119,10 @@ ExecutionState::ExecutionState(const ExecutionState& state):
     forkDisabled(state.forkDisabled),
     coveredLines(state.coveredLines),
     ptreeNode(state.ptreeNode),
+    forkHistory(state.forkHistory),
+    spilled(state.spilled),
+    spillOffset(state.spillOffset),
+    madeExternalCall(state.madeExternalCall),
     symbolics(state.symbolics),
     arrayNames(state.arrayNames),
     openMergeStack(state.openMergeStack)
@@ -123,6 +131,16 @@ ExecutionState::ExecutionState(const ExecutionState& state):
     symbolics[i].first->refCount++;
 }
 
+ForkHistory::~ForkHistory() {
+  // Release the uniquely owned part of the history iteratively, deep
+  // histories would otherwise overflow the stack.
+  while (!parent.isNull() && parent->refCount == 1) {
+    ref<ForkHistory> next = parent->parent;
+    parent->parent = 0;
+    parent = next;
+  }
+}
+
 ExecutionState *ExecutionState::branch() {
   depth++;
 
@@ -308,13 +326,14 @@ bool ExecutionState::merge(const ExecutionState &b) {
     StackFrame &af = *itA;
     const StackFrame &bf = *itB;
     for (unsigned i=0; i<af.kf->numRegisters; i++) {
-      ref<Expr> &av = af.locals[i].value;
-      const ref<Expr> &bv = bf.locals[i].value;
+      Cell &ac = af.locals[i];
+      const ref<Expr> &av = ac.getValue();
+      const ref<Expr> &bv = bf.locals[i].getValue();
       if (av.isNull() || bv.isNull()) {
         // if one is null then by implication (we are at same pc)
         // we cannot reuse this local, so just ignore
       } else {
-        av = SelectExpr::create(inA, av, bv);
+        ac.setValue(SelectExpr::create(inA, av, bv));
       }
     }
   }
@@ -367,7 +386,7 @@ void ExecutionState::dumpStack(llvm::raw_ostream &out) const {
 
       out << ai->getName().str();
       // XXX should go through function
-      ref<Expr> value = sf.locals[sf.kf->getArgRegister(index++)].value;
+      ref<Expr> value = sf.locals[sf.kf->getArgRegister(index++)].getValue();
       if (value.get() && isa<ConstantExpr>(value))
         out << "=" << value;
     }
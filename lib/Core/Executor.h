@@ -20,6 +20,7 @@
 #include "klee/Internal/Module/Cell.h"
 #include "klee/Internal/Module/KInstruction.h"
 #include "klee/Internal/Module/KModule.h"
+#include "klee/Solver.h"
 #include "klee/util/ArrayCache.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -50,6 +51,8 @@ namespace llvm {
 namespace klee {  
   class Array;
   struct Cell;
+  struct Checkpoint;
+  struct ForkChoice;
   class ExecutionState;
   class ExternalDispatcher;
   class Expr;
@@ -62,6 +65,7 @@ namespace klee {
   class MemoryObject;
   class ObjectState;
   class PTree;
+  struct ResumeNode;
   class Searcher;
   class SeedInfo;
   class SpecialFunctionHandler;
@@ -159,6 +163,32 @@ private:
   /// happens with other states (that don't satisfy the seeds) depends
   /// on as-yet-to-be-determined flags.
   std::map<ExecutionState*, std::vector<SeedInfo> > seedMap;
+
+  /// When non-empty the Executor is resuming from a checkpoint. The
+  /// states in this map are replaying the fork histories of the
+  /// checkpointed states, they are executed outside the normal search
+  /// interface until they reach the end of their history. \see
+  /// loadCheckpoint()
+  std::map<ExecutionState*, const ResumeNode*> resumeMap;
+
+  /// The checkpoint file to resume from, empty if not resuming.
+  std::string resumePath;
+
+  /// The checkpoint being resumed from, until its replay has finished.
+  Checkpoint *resumeCheckpoint;
+
+  /// Whether the fork history of the states is recorded, which is
+  /// needed to write checkpoints and to spill states.
+  bool recordForkHistory;
+
+  /// Copy of the initial state, spilled states are recreated from it.
+  /// \see --spill-states
+  ExecutionState *spillBaseState;
+
+  /// The file holding the fork histories of spilled states, -1 until
+  /// the first state is spilled.
+  int spillFd;
+  uint64_t spillFileSize;
   
   /// Map of globals to their representative memory object.
   std::map<const llvm::GlobalValue*, MemoryObject*> globalObjects;
@@ -215,11 +245,56 @@ private:
   // @brief buffer to store logs before flushing to file
   llvm::raw_string_ostream debugLogBuffer;
 
+  /// Index of this exploration worker process, 0 for the original
+  /// process. \see splitIntoWorkers()
+  unsigned workerIndex;
+
+  /// Process ids of the other workers, only known to worker 0.
+  std::vector<int> workerPids;
+
+  /// Shared memory through which finished workers report their
+  /// statistics to worker 0, one slot of \ref workerSlotSize bytes
+  /// per worker.
+  char *workerSlots;
+  size_t workerSlotSize;
+
+  /// Paths explored and tests generated before the split, which must
+  /// not be reported again by the workers.
+  unsigned pathsBeforeSplit, testsBeforeSplit;
+
+  /// A branch query which is being solved by a forked process while
+  /// its state is paused. \see startAsyncBranch()
+  struct AsyncBranch {
+    ExecutionState *state;
+    ref<Expr> condition;
+    int pid;
+    /// Read end of the pipe the answer is written to.
+    int fd;
+  };
+  std::vector<AsyncBranch> asyncBranches;
+
+  /// The answer of a finished branch query, consumed by fork() when
+  /// the state executes the branch again.
+  struct AsyncBranchResult {
+    ref<Expr> condition;
+    /// False if the process did not answer, the query is then solved
+    /// again in the executor.
+    bool answered;
+    bool success;
+    Solver::Validity validity;
+  };
+  std::map<ExecutionState*, AsyncBranchResult> asyncBranchResults;
+
   llvm::Function* getTargetFunction(llvm::Value *calledVal,
                                     ExecutionState &state);
   
   void executeInstruction(ExecutionState &state, KInstruction *ki);
 
+  /// Execute integer arithmetic, comparisons and casts whose operands
+  /// are all inline constants without creating any expressions. Returns
+  /// false if the instruction has to go through executeInstruction.
+  bool executeConstantInstruction(ExecutionState &state, KInstruction *ki);
+
   void printFileLine(ExecutionState &state, KInstruction *ki,
                      llvm::raw_ostream &file);
 
@@ -402,6 +477,8 @@ private:
   void continueState(ExecutionState& state);
   // remove state from queue and delete
   void terminateState(ExecutionState &state);
+  // remove state from queue and delete, without counting it as a path
+  void discardState(ExecutionState &state);
   // call exit handler and terminate state
   void terminateStateEarly(ExecutionState &state, const llvm::Twine &message);
   // call exit handler and terminate state
@@ -448,10 +525,54 @@ private:
   void initTimers();
   void processTimers(ExecutionState *current,
                      double maxInstTime);
-  void checkMemoryUsage();
+  void checkMemoryUsage(ExecutionState *current);
   void printDebugInstructions(ExecutionState &state);
   void doDumpStates();
 
+  /// Fork --parallel-workers exploration processes, each continuing
+  /// with a disjoint share of the current states.
+  void splitIntoWorkers();
+  /// Publish the statistics of a worker process and exit it.
+  void exitWorker();
+  /// Wait for all other workers and merge their statistics.
+  void joinWorkers();
+
+  /// Solve the feasibility of the branch on \a condition of \a state in
+  /// a forked process and pause the state until the answer arrives.
+  /// Returns false if the branch has to be solved in the executor.
+  /// \see --async-branch-queries
+  bool startAsyncBranch(ExecutionState &state, ref<Expr> condition);
+  /// Collect the answers of the finished branch queries and continue
+  /// their states, if \a wait is set wait a little for one to finish.
+  void collectAsyncBranches(bool wait);
+  /// Kill the branch query of \a state, if any, and drop its answer.
+  void cancelAsyncBranch(ExecutionState *state);
+
+  /// Read the checkpoint to resume from and start replaying it from
+  /// \a initialState.
+  void loadCheckpoint(ExecutionState &initialState);
+  /// Move the states of a split of the replaying state \a original
+  /// along the checkpoint, \a split[i] took choice i. States which
+  /// leave the checkpointed histories are discarded and set to null.
+  void resumeSplit(ExecutionState &original,
+                   std::vector<ExecutionState*> &split);
+  /// Restore the statistics of the checkpoint once all of its states
+  /// were recreated.
+  void finishResume();
+
+  /// Get the fork history of \a state, oldest choice first.
+  void getForkHistory(const ExecutionState &state,
+                      std::vector<ForkChoice> &choices);
+  /// Spill up to \a count states other than the executing state \a
+  /// current, those the searcher will select last. Returns the number of
+  /// states spilled.
+  unsigned spillStates(unsigned count, ExecutionState *current);
+  bool spillState(ExecutionState &state);
+  /// Recreate the spilled state \a state by replaying its fork history,
+  /// the recreated state replaces it. The replay stops early when the
+  /// execution halts, unless \a whileHalting is set.
+  void restoreState(ExecutionState &state, bool whileHalting = false);
+
 public:
   Executor(llvm::LLVMContext &ctx, const InterpreterOptions &opts,
       InterpreterHandler *ie);
@@ -487,6 +608,10 @@ public:
     usingSeeds = seeds;
   }
 
+  virtual void setResumeCheckpoint(const std::string &path) {
+    resumePath = path;
+  }
+
   virtual void runFunctionAsMain(llvm::Function *f,
                                  int argc,
                                  char **argv,
@@ -504,6 +629,10 @@ public:
 
   void prepareForEarlyExit();
 
+  /// Write the fork histories of all states and the statistics to
+  /// checkpoint.bin in the output directory. \see --checkpoint-interval
+  void writeCheckpoint();
+
   /*** State accessor methods ***/
 
   virtual unsigned getPathStreamID(const ExecutionState &state);
@@ -0,0 +1,171 @@
+//===-- ExecutorAsyncBranches.cpp -----------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Asynchronous branch queries. When a state reaches a symbolic branch, the
+// feasibility query is handed to a forked process and the state is paused,
+// so the searcher keeps interpreting the other states while the solver
+// works. Once the answer arrives the state is continued and executes the
+// branch again, this time taking the answer instead of asking the solver.
+// Expressions and the solver chain are not thread safe, so the queries run
+// in processes rather than threads, like the exploration workers do; the
+// price is a fork per query, which only pays off for expensive queries.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CoreStats.h"
+#include "Executor.h"
+#include "TimingSolver.h"
+
+#include "klee/ExecutionState.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Errno.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+using namespace llvm;
+using namespace klee;
+
+cl::opt<unsigned>
+AsyncBranchQueries("async-branch-queries",
+                   cl::desc("Solve up to this many branch queries in "
+                            "forked processes while other states are "
+                            "executed (default=0 (off))"),
+                   cl::init(0));
+
+namespace {
+  /// Answer written by the query process.
+  struct AsyncAnswer {
+    uint8_t success;
+    uint8_t validity;
+  };
+}
+
+bool Executor::startAsyncBranch(ExecutionState &state, ref<Expr> condition) {
+  // Seeding, replaying and resuming states must take their branches in
+  // order, and a state which comes back with an answer must use it.
+  if (asyncBranches.size() >= AsyncBranchQueries ||
+      isa<ConstantExpr>(condition) || !searcher || replayKTest ||
+      replayPath || seedMap.count(&state) || resumeMap.count(&state) ||
+      asyncBranchResults.count(&state))
+    return false;
+
+  int p[2];
+  if (pipe(p) < 0)
+    return false;
+
+  fflush(stdout);
+  fflush(stderr);
+  pid_t pid = ::fork();
+  if (pid == 0) {
+    close(p[0]);
+#ifdef __linux__
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+    AsyncAnswer answer;
+    Solver::Validity validity = Solver::Unknown;
+    solver->setTimeout(coreSolverTimeout);
+    answer.success = solver->evaluate(state, condition, validity);
+    answer.validity = (uint8_t) (validity + 1);
+    ssize_t n;
+    while ((n = write(p[1], &answer, sizeof(answer))) < 0 && errno == EINTR)
+      ;
+    _exit(n == sizeof(answer) ? 0 : 1);
+  }
+  close(p[1]);
+  if (pid < 0) {
+    klee_warning_once(0, "unable to fork branch query process - %s",
+                      llvm::sys::StrError(errno).c_str());
+    close(p[0]);
+    return false;
+  }
+
+  AsyncBranch pending = { &state, condition, pid, p[0] };
+  asyncBranches.push_back(pending);
+  ++stats::asyncBranchQueries;
+
+  // Execute the branch again once the answer is in, whether or not it
+  // is used, which accounts for the instruction. This step is undone.
+  // A branch which covered new code keeps its count of instructions
+  // since then.
+  stats::instructions += (uint64_t) -1;
+  if (state.instsSinceCovNew > 1)
+    --state.instsSinceCovNew;
+  state.pc = state.prevPC;
+  pauseState(state);
+  return true;
+}
+
+void Executor::collectAsyncBranches(bool wait) {
+  std::vector<struct pollfd> fds(asyncBranches.size());
+  for (unsigned i = 0; i < asyncBranches.size(); ++i) {
+    fds[i].fd = asyncBranches[i].fd;
+    fds[i].events = POLLIN;
+    fds[i].revents = 0;
+  }
+  int res;
+  // Waiting is bounded so that the timers keep running.
+  while ((res = poll(&fds[0], fds.size(), wait ? 100 : 0)) < 0 &&
+         errno == EINTR)
+    ;
+  if (res <= 0)
+    return;
+
+  std::vector<AsyncBranch> pending;
+  for (unsigned i = 0; i < asyncBranches.size(); ++i) {
+    AsyncBranch &ab = asyncBranches[i];
+    if (!fds[i].revents) {
+      pending.push_back(ab);
+      continue;
+    }
+
+    AsyncAnswer answer;
+    ssize_t n;
+    while ((n = read(ab.fd, &answer, sizeof(answer))) < 0 && errno == EINTR)
+      ;
+    close(ab.fd);
+    int status;
+    while (waitpid(ab.pid, &status, 0) < 0 && errno == EINTR)
+      ;
+
+    AsyncBranchResult &result = asyncBranchResults[ab.state];
+    result.condition = ab.condition;
+    result.answered = n == sizeof(answer);
+    result.success = result.answered && answer.success;
+    result.validity = result.success ?
+      (Solver::Validity) ((int) answer.validity - 1) : Solver::Unknown;
+    continueState(*ab.state);
+  }
+  asyncBranches.swap(pending);
+}
+
+void Executor::cancelAsyncBranch(ExecutionState *state) {
+  asyncBranchResults.erase(state);
+  for (std::vector<AsyncBranch>::iterator it = asyncBranches.begin(),
+         ie = asyncBranches.end(); it != ie; ++it) {
+    if (it->state != state)
+      continue;
+    kill(it->pid, SIGKILL);
+    close(it->fd);
+    while (waitpid(it->pid, 0, 0) < 0 && errno == EINTR)
+      ;
+    asyncBranches.erase(it);
+    return;
+  }
+}
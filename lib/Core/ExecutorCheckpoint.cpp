@@ -0,0 +1,542 @@
+//===-- ExecutorCheckpoint.cpp --------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Checkpointing and resuming of an exploration. Serializing the states
+// themselves (memory, constraints, stacks) would tie the checkpoint to
+// pointers and expressions of this process, so a checkpoint instead stores
+// the fork history of every live state: the choice taken at each split
+// since the initial state. Resuming replays the histories from the initial
+// state to recreate the states, discarding every state that leaves the
+// recorded paths (they were explored before the checkpoint). Once the
+// replay is done the statistics of the checkpoint are restored and the
+// exploration continues.
+//
+// The replay is not guaranteed to be deterministic: concrete addresses of
+// allocations differ between runs and change the order in which symbolic
+// pointers are resolved, and solver timeouts or counterexample cache hits
+// can differ. Every split therefore also records the instruction which
+// split and the number of states it split into. A replayed state which
+// splits differently, or terminates before the end of its history, has
+// diverged; it is discarded with a warning instead of silently exploring
+// a different path.
+//
+// The same mechanism spills states when memory runs out: the fork history
+// of a spilled state is written to disk and its memory and constraints are
+// dropped, while the state itself stays with the searcher. When the
+// searcher selects it again, or the execution halts and it needs a test,
+// it is recreated by replaying its history. The searcher picks the states
+// it will select last. The replay starts from the initial state and would
+// repeat external calls, so states which made one are never spilled.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Checkpoint.h"
+#include "Executor.h"
+#include "PTree.h"
+#include "Searcher.h"
+#include "StatsTracker.h"
+
+#include "klee/ExecutionState.h"
+#include "klee/Internal/Module/InstructionInfoTable.h"
+#include "klee/Internal/Module/KModule.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+#include "klee/Statistics.h"
+
+#include "llvm/Support/Errno.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+  const char checkpointMagic[8] = { 'K', 'L', 'E', 'E', 'C', 'K', 'P', 'T' };
+  const uint32_t checkpointVersion = 2;
+
+  template <typename T> void writeValue(std::ostream &os, T value) {
+    os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  template <typename T> bool readValue(std::istream &is, T &value) {
+    is.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return is.good();
+  }
+
+  /// Choices are almost always 0 or 1, store them as LEB128.
+  void writeLEB128(std::ostream &os, unsigned value) {
+    do {
+      unsigned char byte = value & 0x7F;
+      value >>= 7;
+      if (value)
+        byte |= 0x80;
+      os.put(byte);
+    } while (value);
+  }
+
+  bool readLEB128(std::istream &is, uint32_t &value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 32; shift += 7) {
+      int byte = is.get();
+      if (byte == EOF)
+        return false;
+      value |= (uint32_t) (byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  void writeChoice(std::ostream &os, const ForkChoice &fc) {
+    writeLEB128(os, fc.choice);
+    writeLEB128(os, fc.numChoices);
+    writeLEB128(os, fc.instruction);
+  }
+
+  bool readChoice(std::istream &is, ForkChoice &fc) {
+    return readLEB128(is, fc.choice) && readLEB128(is, fc.numChoices) &&
+           readLEB128(is, fc.instruction);
+  }
+}
+
+ResumeNode *ResumeNode::addChild(const ForkChoice &fc) {
+  if (fc.choice >= fc.numChoices)
+    return 0;
+  if (!numChoices) {
+    instruction = fc.instruction;
+    numChoices = fc.numChoices;
+  } else if (instruction != fc.instruction || numChoices != fc.numChoices) {
+    return 0;
+  }
+  ResumeNode *&child = children[fc.choice];
+  if (!child)
+    child = new ResumeNode();
+  return child;
+}
+
+ResumeNode::~ResumeNode() {
+  // The trie is as deep as the longest history, delete it iteratively.
+  std::vector<ResumeNode*> stack;
+  for (std::map<unsigned, ResumeNode*>::iterator it = children.begin(),
+         ie = children.end(); it != ie; ++it)
+    stack.push_back(it->second);
+  children.clear();
+
+  while (!stack.empty()) {
+    ResumeNode *n = stack.back();
+    stack.pop_back();
+    for (std::map<unsigned, ResumeNode*>::iterator it = n->children.begin(),
+           ie = n->children.end(); it != ie; ++it)
+      stack.push_back(it->second);
+    n->children.clear();
+    delete n;
+  }
+}
+
+bool Checkpoint::read(const std::string &path, std::string &error) {
+  std::ifstream is(path.c_str(), std::ios::in | std::ios::binary);
+  if (!is.good()) {
+    error = "unable to open file";
+    return false;
+  }
+
+  char magic[sizeof(checkpointMagic)];
+  uint32_t version;
+  is.read(magic, sizeof(magic));
+  if (!is.good() || memcmp(magic, checkpointMagic, sizeof(magic)) ||
+      !readValue(is, version) || version != checkpointVersion) {
+    error = "not a checkpoint file";
+    return false;
+  }
+
+  error = "truncated checkpoint file";
+  uint32_t numStats;
+  if (!readValue(is, numInstructions) || !readValue(is, pathsExplored) ||
+      !readValue(is, numTestCases) || !readValue(is, numStats))
+    return false;
+
+  for (unsigned i = 0; i < numStats; ++i) {
+    uint32_t length;
+    uint64_t value;
+    if (!readValue(is, length) || length > 1024)
+      return false;
+    std::string name(length, '\0');
+    is.read(&name[0], length);
+    if (!is.good() || !readValue(is, value))
+      return false;
+    statNames.push_back(name);
+    statValues.push_back(value);
+  }
+
+  if (!readValue(is, numIndices))
+    return false;
+  indexedValues.resize((size_t) numIndices * numStats);
+  if (!indexedValues.empty()) {
+    is.read(reinterpret_cast<char*>(&indexedValues[0]),
+            indexedValues.size() * sizeof(uint64_t));
+    if (!is.good())
+      return false;
+  }
+
+  if (!readValue(is, numStates))
+    return false;
+  for (unsigned i = 0; i < numStates; ++i) {
+    uint32_t length;
+    if (!readValue(is, length))
+      return false;
+    ResumeNode *node = &root;
+    for (unsigned j = 0; j < length; ++j) {
+      ForkChoice fc;
+      if (!readChoice(is, fc))
+        return false;
+      if (!(node = node->addChild(fc))) {
+        error = "inconsistent fork histories in checkpoint file";
+        return false;
+      }
+    }
+    node->live = true;
+  }
+
+  error.clear();
+  return true;
+}
+
+void Executor::writeCheckpoint() {
+  if (workerSlots) {
+    klee_warning_once(0, "checkpoints are not supported with "
+                      "--parallel-workers");
+    return;
+  }
+  if (!resumeMap.empty()) {
+    // The states which are still replaying stand for whole subtrees of
+    // the checkpoint they came from.
+    klee_warning("skipping checkpoint, the exploration is still resuming");
+    return;
+  }
+
+  // Timers fire before the states of the current step are updated.
+  std::vector<ExecutionState*> live;
+  for (std::set<ExecutionState*>::iterator it = states.begin(),
+         ie = states.end(); it != ie; ++it)
+    if (std::find(removedStates.begin(), removedStates.end(), *it) ==
+        removedStates.end())
+      live.push_back(*it);
+  live.insert(live.end(), addedStates.begin(), addedStates.end());
+
+  // Write a new file and rename it, so that a job killed while writing
+  // still leaves the previous checkpoint.
+  std::string path = interpreterHandler->getOutputFilename("checkpoint.bin");
+  std::string tmpPath = path + ".tmp";
+  std::ofstream os(tmpPath.c_str(),
+                   std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!os.good()) {
+    klee_warning("unable to write checkpoint \"%s\"", tmpPath.c_str());
+    return;
+  }
+
+  StatisticManager &sm = *theStatisticManager;
+  unsigned numStats = sm.getNumStatistics();
+  unsigned numIndices = sm.getNumIndices();
+
+  os.write(checkpointMagic, sizeof(checkpointMagic));
+  writeValue<uint32_t>(os, checkpointVersion);
+  writeValue<uint32_t>(os, kmodule->infos->getMaxID());
+  writeValue<uint64_t>(os, interpreterHandler->getNumPathsExplored());
+  writeValue<uint64_t>(os, interpreterHandler->getNumTestCases());
+
+  writeValue<uint32_t>(os, numStats);
+  for (unsigned i = 0; i < numStats; ++i) {
+    const Statistic &s = sm.getStatistic(i);
+    writeValue<uint32_t>(os, s.getName().size());
+    os.write(s.getName().data(), s.getName().size());
+    writeValue<uint64_t>(os, s.getValue());
+  }
+  writeValue<uint32_t>(os, numIndices);
+  for (unsigned index = 0; index < numIndices; ++index)
+    for (unsigned i = 0; i < numStats; ++i)
+      writeValue<uint64_t>(os, sm.getIndexedValue(sm.getStatistic(i), index));
+
+  writeValue<uint32_t>(os, live.size());
+  std::vector<ForkChoice> choices;
+  for (std::vector<ExecutionState*>::iterator it = live.begin(),
+         ie = live.end(); it != ie; ++it) {
+    getForkHistory(**it, choices);
+    writeValue<uint32_t>(os, choices.size());
+    for (std::vector<ForkChoice>::iterator ci = choices.begin(),
+           ce = choices.end(); ci != ce; ++ci)
+      writeChoice(os, *ci);
+  }
+
+  os.close();
+  if (os.fail()) {
+    klee_warning("unable to write checkpoint \"%s\"", tmpPath.c_str());
+    return;
+  }
+  if (::rename(tmpPath.c_str(), path.c_str()) < 0) {
+    klee_warning("unable to rename checkpoint \"%s\" - %s", tmpPath.c_str(),
+                 llvm::sys::StrError(errno).c_str());
+    return;
+  }
+  klee_message("wrote checkpoint of %u states", (unsigned) live.size());
+}
+
+void Executor::loadCheckpoint(ExecutionState &initialState) {
+  resumeCheckpoint = new Checkpoint();
+  std::string error;
+  if (!resumeCheckpoint->read(resumePath, error))
+    klee_error("unable to resume from \"%s\": %s", resumePath.c_str(),
+               error.c_str());
+  if (resumeCheckpoint->numInstructions != kmodule->infos->getMaxID())
+    klee_error("unable to resume from \"%s\": it was written for a "
+               "different program", resumePath.c_str());
+
+  klee_message("resuming %u states from \"%s\"",
+               resumeCheckpoint->numStates, resumePath.c_str());
+  // Nothing of the states themselves is stored, so getting back to them
+  // costs about as much as the run that wrote the checkpoint.
+  uint64_t instructions = 0;
+  for (unsigned i = 0; i < resumeCheckpoint->statNames.size(); ++i)
+    if (resumeCheckpoint->statNames[i] == "Instructions")
+      instructions = resumeCheckpoint->statValues[i];
+  klee_warning("resuming re-executes every path from the initial state, "
+               "this can take up to the %llu instructions executed before "
+               "the checkpoint", (unsigned long long) instructions);
+  interpreterHandler->setResumedResults(resumeCheckpoint->pathsExplored,
+                                        resumeCheckpoint->numTestCases);
+
+  const ResumeNode *root = &resumeCheckpoint->root;
+  if (root->children.empty() && !root->live) {
+    // The exploration had already finished.
+    discardState(initialState);
+    updateStates(0);
+  } else if (!root->live) {
+    resumeMap[&initialState] = root;
+  }
+}
+
+void Executor::resumeSplit(ExecutionState &original,
+                           std::vector<ExecutionState*> &split) {
+  std::map<ExecutionState*, const ResumeNode*>::iterator it =
+    resumeMap.find(&original);
+  if (it == resumeMap.end())
+    return;
+  const ResumeNode *node = it->second;
+  resumeMap.erase(it);
+
+  unsigned instruction = original.prevPC->info->id;
+  if (node->instruction != instruction || node->numChoices != split.size()) {
+    klee_warning("replayed state diverged from its fork history, it split "
+                 "%u ways at instruction %u instead of %u ways at "
+                 "instruction %u, discarding it",
+                 (unsigned) split.size(), instruction, node->numChoices,
+                 node->instruction);
+    for (unsigned i = 0; i < split.size(); ++i) {
+      discardState(*split[i]);
+      split[i] = 0;
+    }
+    return;
+  }
+
+  for (unsigned i = 0; i < split.size(); ++i) {
+    const ResumeNode *child = node->getChild(i);
+    if (!child) {
+      discardState(*split[i]);
+      split[i] = 0;
+    } else if (!child->live) {
+      resumeMap[split[i]] = child;
+    }
+  }
+}
+
+void Executor::finishResume() {
+  StatisticManager &sm = *theStatisticManager;
+  const Checkpoint &cp = *resumeCheckpoint;
+  unsigned numStats = cp.statNames.size();
+  bool restoreIndexed = cp.numIndices == sm.getNumIndices();
+
+  // The replay executed the checkpointed paths a second time, the
+  // statistics of the checkpoint replace everything it counted.
+  for (unsigned i = 0; i < numStats; ++i) {
+    Statistic *s = sm.getStatisticByName(cp.statNames[i]);
+    if (!s)
+      continue;
+    sm.setValue(*s, cp.statValues[i]);
+    if (restoreIndexed)
+      for (unsigned index = 0; index < cp.numIndices; ++index)
+        sm.setIndexedValue(*s, index,
+                           cp.indexedValues[(size_t) index * numStats + i]);
+  }
+  if (statsTracker && restoreIndexed && cp.numIndices)
+    statsTracker->recomputeBranchCoverage();
+
+  klee_message("resumed %u states", (unsigned) states.size());
+  delete resumeCheckpoint;
+  resumeCheckpoint = 0;
+}
+
+void Executor::getForkHistory(const ExecutionState &state,
+                              std::vector<ForkChoice> &choices) {
+  choices.clear();
+  if (state.spilled) {
+    uint32_t length;
+    if (pread(spillFd, &length, sizeof(length), state.spillOffset) ==
+        sizeof(length)) {
+      choices.resize(length);
+      size_t size = length * sizeof(ForkChoice);
+      if (!length ||
+          pread(spillFd, &choices[0], size,
+                state.spillOffset + sizeof(length)) == (ssize_t) size)
+        return;
+    }
+    klee_error("unable to read spilled state - %s",
+               llvm::sys::StrError(errno).c_str());
+  }
+
+  for (const ForkHistory *h = state.forkHistory.get(); h;
+       h = h->parent.get()) {
+    ForkChoice fc = { h->instruction, h->numChoices, h->choice };
+    choices.push_back(fc);
+  }
+  std::reverse(choices.begin(), choices.end());
+}
+
+bool Executor::spillState(ExecutionState &state) {
+  if (spillFd < 0) {
+    std::string path = interpreterHandler->getOutputFilename("states.spill");
+    spillFd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (spillFd < 0) {
+      klee_warning("unable to open spill file \"%s\" - %s", path.c_str(),
+                   llvm::sys::StrError(errno).c_str());
+      return false;
+    }
+    // Nobody else needs the file, it disappears with the process.
+    unlink(path.c_str());
+  }
+
+  std::vector<ForkChoice> choices;
+  getForkHistory(state, choices);
+  uint32_t length = choices.size();
+  size_t size = sizeof(length) + length * sizeof(ForkChoice);
+  std::vector<char> record(size);
+  memcpy(&record[0], &length, sizeof(length));
+  if (length)
+    memcpy(&record[sizeof(length)], &choices[0],
+           length * sizeof(ForkChoice));
+  if (pwrite(spillFd, &record[0], size, spillFileSize) != (ssize_t) size) {
+    klee_warning_once(0, "unable to write spill file - %s",
+                      llvm::sys::StrError(errno).c_str());
+    return false;
+  }
+
+  state.spilled = true;
+  state.spillOffset = spillFileSize;
+  spillFileSize += size;
+
+  // Drop everything but what the searchers look at. The stack stays, it
+  // is used to compute the distance to uncovered code.
+  state.forkHistory = 0;
+  state.addressSpace.objects = MemoryMap();
+  state.constraints = ConstraintManager();
+  return true;
+}
+
+unsigned Executor::spillStates(unsigned count, ExecutionState *current) {
+  // States at an asynchronous branch are waiting for its answer.
+  std::set<ExecutionState*> atBranch;
+  for (unsigned i = 0; i < asyncBranches.size(); ++i)
+    atBranch.insert(asyncBranches[i].state);
+
+  std::vector<ExecutionState*> arr;
+  for (std::set<ExecutionState*>::iterator it = states.begin(),
+         ie = states.end(); it != ie; ++it) {
+    ExecutionState *es = *it;
+    // Replaying a state that made an external call would make it again,
+    // states in merges are referenced by their merge handler.
+    if (es == current || es->spilled || es->madeExternalCall ||
+        !es->openMergeStack.empty() ||
+        seedMap.count(es) ||
+        atBranch.count(es) || asyncBranchResults.count(es) ||
+        std::find(removedStates.begin(), removedStates.end(), es) !=
+          removedStates.end())
+      continue;
+    arr.push_back(es);
+  }
+
+  // Spill the states the searcher will get to last.
+  if (searcher)
+    searcher->orderForSpilling(arr);
+  unsigned spilled = 0;
+  for (unsigned i = 0; i < arr.size() && spilled < count; ++i) {
+    if (!spillState(*arr[i]))
+      break;
+    ++spilled;
+  }
+
+  if (spilled)
+    klee_warning("spilled %u states (over memory cap)", spilled);
+  return spilled;
+}
+
+void Executor::restoreState(ExecutionState &state, bool whileHalting) {
+  assert(state.spilled && spillBaseState && "restoring an unspilled state");
+
+  std::vector<ForkChoice> choices;
+  getForkHistory(state, choices);
+  ResumeNode root, *node = &root;
+  for (unsigned i = 0; i < choices.size(); ++i)
+    node = node->addChild(choices[i]);
+  node->live = true;
+
+  // The recreated state takes the place of the spilled one in the
+  // process tree.
+  ExecutionState *es = new ExecutionState(*spillBaseState);
+  state.ptreeNode->data = 0;
+  std::pair<PTree::Node*, PTree::Node*> res =
+    processTree->split(state.ptreeNode, es, &state);
+  es->ptreeNode = res.first;
+  state.ptreeNode = res.second;
+  addedStates.push_back(es);
+  discardState(state);
+  if (!root.live)
+    resumeMap[es] = &root;
+  updateStates(0);
+  size_t numStates = states.size();
+
+  // The paths were already counted when they were first explored, this
+  // includes the indexed statistics written to run.istats.
+  StatisticManager &sm = *theStatisticManager;
+  bool statsEnabled = sm.isEnabled();
+  sm.setEnabled(false);
+  // The replay must split the same way as the original run did.
+  bool wasAtMemoryLimit = atMemoryLimit;
+  atMemoryLimit = false;
+
+  while (!resumeMap.empty() && (whileHalting || !haltExecution)) {
+    ExecutionState &current = *resumeMap.begin()->first;
+    KInstruction *ki = current.pc;
+    stepInstruction(current);
+
+    executeInstruction(current, ki);
+    updateStates(&current);
+  }
+  resumeMap.clear();
+
+  sm.setEnabled(statsEnabled);
+  atMemoryLimit = wasAtMemoryLimit;
+
+  // The replay discards every state which leaves the history, including
+  // the recreated state itself if the replay diverged.
+  if (states.size() < numStates)
+    klee_warning("unable to restore a spilled state, its replay diverged");
+}
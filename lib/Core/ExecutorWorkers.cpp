@@ -0,0 +1,301 @@
+//===-- ExecutorWorkers.cpp -----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Parallel exploration using forked worker processes. Once the executor
+// has enough states, it forks --parallel-workers processes which each
+// continue with a disjoint share of the states. Expressions, memory
+// objects and the statistics are not thread safe, so the workers are
+// processes rather than threads: every worker gets its own copy of the
+// interpreter and its own solver chain for free. Test cases of all workers
+// are written to the same output directory; the statistics of the other
+// workers are merged into worker 0 when they finish.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CoreStats.h"
+#include "Executor.h"
+#include "StatsTracker.h"
+
+#include "klee/ExecutionState.h"
+#include "klee/Internal/ADT/RNG.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+#include "klee/Statistics.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Errno.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+using namespace llvm;
+using namespace klee;
+
+cl::opt<unsigned>
+ParallelWorkers("parallel-workers",
+                cl::desc("Split the exploration across this many worker "
+                         "processes once there are enough states "
+                         "(default=1 (off))"),
+                cl::init(1));
+
+namespace klee {
+  extern RNG theRNG;
+}
+
+namespace {
+  /// Header of the shared memory slot of a worker. It is followed by
+  /// the global statistics and, if numIndices is non-zero, by the
+  /// indexed statistics of the worker.
+  struct WorkerSlot {
+    uint64_t finished;
+    uint64_t pathsExplored;
+    uint64_t numTestCases;
+    uint64_t numIndices;
+  };
+
+  enum MergeKind { Sum, Max, Min, Keep };
+
+  /// Coverage statistics record whether something was covered, they
+  /// are merged by taking the union instead of the sum.
+  MergeKind getMergeKind(const Statistic &s) {
+    if (&s == &stats::coveredInstructions || &s == &stats::trueBranches ||
+        &s == &stats::falseBranches)
+      return Max;
+    if (&s == &stats::uncoveredInstructions)
+      return Min;
+    // Recomputed by the stats tracker from the merged coverage.
+    if (&s == &stats::minDistToUncovered)
+      return Keep;
+    return Sum;
+  }
+
+  uint64_t merge(MergeKind kind, uint64_t a, uint64_t b) {
+    switch (kind) {
+    case Sum: return a + b;
+    case Max: return std::max(a, b);
+    case Min: return std::min(a, b);
+    case Keep: return a;
+    }
+    return a;
+  }
+}
+
+void Executor::splitIntoWorkers() {
+  if (pathWriter || symPathWriter) {
+    klee_warning("--parallel-workers is not supported when writing path "
+                 "files, continuing with a single worker");
+    ParallelWorkers = 1;
+    return;
+  }
+
+  for (std::set<ExecutionState*>::iterator it = states.begin(),
+         ie = states.end(); it != ie; ++it)
+    if (!(*it)->openMergeStack.empty())
+      return; // try again once all merges are closed
+
+  // The query processes are children of this process, the states
+  // waiting for them have to be back in the searcher before splitting.
+  while (!asyncBranches.empty())
+    collectAsyncBranches(true);
+  updateStates(0);
+
+  unsigned numWorkers = ParallelWorkers;
+  StatisticManager &sm = *theStatisticManager;
+  unsigned numStats = sm.getNumStatistics();
+  unsigned numIndices = sm.getNumIndices();
+
+  long pageSize = sysconf(_SC_PAGESIZE);
+  size_t slotSize = sizeof(WorkerSlot) +
+    (size_t) numStats * (1 + numIndices) * sizeof(uint64_t);
+  slotSize = (slotSize + pageSize - 1) / pageSize * pageSize;
+  void *slots = mmap(0, slotSize * numWorkers, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (slots == MAP_FAILED) {
+    // Fall back to merging only the global statistics.
+    numIndices = 0;
+    slotSize = sizeof(WorkerSlot) + numStats * sizeof(uint64_t);
+    slotSize = (slotSize + pageSize - 1) / pageSize * pageSize;
+    slots = mmap(0, slotSize * numWorkers, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  }
+  if (slots == MAP_FAILED) {
+    klee_warning("unable to allocate memory for exploration workers, "
+                 "continuing with a single worker");
+    ParallelWorkers = 1;
+    return;
+  }
+  workerSlots = (char*) slots;
+  workerSlotSize = slotSize;
+  for (unsigned i = 0; i < numWorkers; ++i)
+    ((WorkerSlot*) (workerSlots + i * workerSlotSize))->numIndices =
+      numIndices;
+
+  klee_message("splitting %u states across %u workers",
+               (unsigned) states.size(), numWorkers);
+
+  pathsBeforeSplit = interpreterHandler->getNumPathsExplored();
+  testsBeforeSplit = interpreterHandler->getNumTestCases();
+
+  // The slot of worker 0 holds the statistics at the time of the split,
+  // they are shared by all workers and must only be counted once.
+  uint64_t *values = (uint64_t*) ((WorkerSlot*) workerSlots + 1);
+  for (unsigned i = 0; i < numStats; ++i)
+    values[i] = sm.getStatistic(i).getValue();
+  values += numStats;
+  for (unsigned index = 0; index < numIndices; ++index)
+    for (unsigned i = 0; i < numStats; ++i)
+      *values++ = sm.getIndexedValue(sm.getStatistic(i), index);
+
+  // Nothing buffered may be written twice.
+  interpreterHandler->getInfoStream().flush();
+  fflush(0);
+
+  unsigned index = 0;
+  for (unsigned i = 1; i < numWorkers; ++i) {
+    pid_t pid = ::fork();
+    if (pid < 0)
+      klee_error("fork failed for exploration worker %u - %s", i,
+                 llvm::sys::StrError(errno).c_str());
+    if (pid == 0) {
+      index = i;
+      workerPids.clear();
+#ifdef __linux__
+      prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+      break;
+    }
+    workerPids.push_back(pid);
+  }
+
+  workerIndex = index;
+  interpreterHandler->setWorker(workerIndex, numWorkers);
+  if (workerIndex) {
+    if (statsTracker)
+      statsTracker->closeOutputFiles();
+    theRNG.seed(theRNG.getInt32() + workerIndex);
+  }
+
+  // Keep every numWorkers-th state. The state set is ordered by address
+  // and the address space was identical when forking, so the shares
+  // are disjoint.
+  unsigned i = 0;
+  for (std::set<ExecutionState*>::iterator it = states.begin(),
+         ie = states.end(); it != ie; ++it, ++i)
+    if (i % numWorkers != workerIndex)
+      removedStates.push_back(*it);
+  updateStates(0);
+}
+
+void Executor::exitWorker() {
+  StatisticManager &sm = *theStatisticManager;
+  unsigned numStats = sm.getNumStatistics();
+  WorkerSlot *slot = (WorkerSlot*) (workerSlots + workerIndex * workerSlotSize);
+  uint64_t *values = (uint64_t*) (slot + 1);
+
+  slot->pathsExplored =
+    interpreterHandler->getNumPathsExplored() - pathsBeforeSplit;
+  slot->numTestCases =
+    interpreterHandler->getNumTestCases() - testsBeforeSplit;
+  for (unsigned i = 0; i < numStats; ++i)
+    values[i] = sm.getStatistic(i).getValue();
+  values += numStats;
+  for (unsigned index = 0; index < slot->numIndices; ++index)
+    for (unsigned i = 0; i < numStats; ++i)
+      *values++ = sm.getIndexedValue(sm.getStatistic(i), index);
+  slot->finished = 1;
+
+  fflush(0);
+  _exit(0);
+}
+
+void Executor::joinWorkers() {
+  if (!workerSlots)
+    return;
+
+  if (haltExecution)
+    for (unsigned i = 0; i < workerPids.size(); ++i)
+      kill(workerPids[i], SIGINT);
+
+  StatisticManager &sm = *theStatisticManager;
+  unsigned numStats = sm.getNumStatistics();
+  const uint64_t *atSplit = (const uint64_t*) ((WorkerSlot*) workerSlots + 1);
+  const uint64_t *indexedAtSplit = atSplit + numStats;
+
+  for (unsigned w = 0; w < workerPids.size(); ++w) {
+    int status;
+    pid_t res;
+    do {
+      res = waitpid(workerPids[w], &status, 0);
+    } while (res < 0 && errno == EINTR);
+
+    WorkerSlot *slot = (WorkerSlot*) (workerSlots + (w + 1) * workerSlotSize);
+    if (res < 0 || !slot->finished) {
+      klee_warning("exploration worker %u did not finish, its statistics "
+                   "are lost", w + 1);
+      continue;
+    }
+
+    interpreterHandler->addWorkerResults(slot->pathsExplored,
+                                         slot->numTestCases);
+
+    const uint64_t *values = (const uint64_t*) (slot + 1);
+    for (unsigned i = 0; i < numStats; ++i) {
+      Statistic &s = sm.getStatistic(i);
+      MergeKind kind = getMergeKind(s);
+      // The worker started out with the statistics of worker 0 at the
+      // time of the split, only count what it added since.
+      if (kind == Sum)
+        sm.setValue(s, s.getValue() + values[i] - atSplit[i]);
+      else
+        sm.setValue(s, merge(kind, s.getValue(), values[i]));
+    }
+    values += numStats;
+
+    const uint64_t *before = indexedAtSplit;
+    for (unsigned index = 0; index < slot->numIndices; ++index) {
+      for (unsigned i = 0; i < numStats; ++i, ++values, ++before) {
+        // Indexed values are rebased like the global ones.
+        Statistic &s = sm.getStatistic(i);
+        MergeKind kind = getMergeKind(s);
+        uint64_t value = sm.getIndexedValue(s, index);
+        if (kind == Sum)
+          sm.setIndexedValue(s, index, value + *values - *before);
+        else
+          sm.setIndexedValue(s, index, merge(kind, value, *values));
+      }
+    }
+  }
+
+  // With indexed statistics the merged coverage is exact, recompute the
+  // global coverage counters from it.
+  if (unsigned numIndices = sm.getNumIndices()) {
+    Statistic *coverage[] = { &stats::coveredInstructions,
+                              &stats::uncoveredInstructions,
+                              &stats::trueBranches, &stats::falseBranches };
+    for (unsigned i = 0; i < sizeof(coverage) / sizeof(coverage[0]); ++i) {
+      uint64_t total = 0;
+      for (unsigned index = 0; index < numIndices; ++index)
+        total += sm.getIndexedValue(*coverage[i], index);
+      sm.setValue(*coverage[i], total);
+    }
+    if (statsTracker)
+      statsTracker->recomputeBranchCoverage();
+  }
+
+  munmap(workerSlots, workerSlotSize * ParallelWorkers);
+  workerSlots = 0;
+  workerPids.clear();
+}
@@ -0,0 +1,94 @@
+//===-- IStatsDeltaWriter.cpp ---------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "IStatsDeltaWriter.h"
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstring>
+#include <string>
+
+using namespace klee;
+
+static void writeVarint(std::string &out, uint64_t value) {
+  while (value >= 0x80) {
+    out += (char) ((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  out += (char) value;
+}
+
+IStatsDeltaWriter::IStatsDeltaWriter(llvm::raw_fd_ostream *_os, unsigned size)
+    : os(_os), pendingTime(0), hasPending(false), stop(false),
+      previous(size, 0) {
+  writer = std::thread(&IStatsDeltaWriter::run, this);
+}
+
+IStatsDeltaWriter::~IStatsDeltaWriter() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stop = true;
+  }
+  wakeup.notify_one();
+  writer.join();
+  delete os;
+}
+
+void IStatsDeltaWriter::submit(double time, std::vector<uint64_t> &snapshot) {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    pending.swap(snapshot);
+    pendingTime = time;
+    hasPending = true;
+  }
+  wakeup.notify_one();
+}
+
+void IStatsDeltaWriter::run() {
+  std::vector<uint64_t> current;
+  for (;;) {
+    double time;
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      while (!hasPending && !stop)
+        wakeup.wait(guard);
+      if (!hasPending)
+        return;
+      current.swap(pending);
+      time = pendingTime;
+      hasPending = false;
+    }
+    writeDelta(time, current);
+    previous.swap(current);
+  }
+}
+
+void IStatsDeltaWriter::writeDelta(double time,
+                                   const std::vector<uint64_t> &current) {
+  std::string changes;
+  uint64_t numChanges = 0, last = 0;
+  for (unsigned i = 0, e = current.size(); i != e; ++i) {
+    if (current[i] == previous[i])
+      continue;
+    int64_t diff = (int64_t) (current[i] - previous[i]);
+    writeVarint(changes, i - last);
+    writeVarint(changes, ((uint64_t) diff << 1) ^ (uint64_t) (diff >> 63));
+    last = i;
+    ++numChanges;
+  }
+
+  std::string record = "D";
+  uint64_t bits;
+  memcpy(&bits, &time, sizeof(bits));
+  for (unsigned i = 0; i != 8; ++i)
+    record += (char) ((bits >> (8 * i)) & 0xFF);
+  writeVarint(record, numChanges);
+  *os << record << changes;
+  os->flush();
+}
@@ -0,0 +1,70 @@
+//===-- IStatsDeltaWriter.h -------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_ISTATSDELTAWRITER_H
+#define KLEE_ISTATSDELTAWRITER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace llvm {
+  class raw_fd_ostream;
+}
+
+namespace klee {
+
+/// IStatsDeltaWriter - Appends snapshots of the instruction level
+/// statistics to a stream as the differences to the previous snapshot,
+/// encoding and writing them on a separate thread.
+///
+/// Each record is the byte 'D', the time of the snapshot as a little
+/// endian double, the number of changed values and, for each of them,
+/// the distance of its position in the snapshot from the previous
+/// changed one and the zigzag encoded difference to its previous value,
+/// all as LEB128 varints.
+class IStatsDeltaWriter {
+  llvm::raw_fd_ostream *os;
+
+  std::mutex lock;
+  std::condition_variable wakeup;
+  /// The snapshot waiting to be written, guarded by lock.
+  std::vector<uint64_t> pending;
+  double pendingTime;
+  bool hasPending, stop;
+
+  /// The last written snapshot, only used by the writer thread.
+  std::vector<uint64_t> previous;
+  std::thread writer;
+
+  void run();
+  void writeDelta(double time, const std::vector<uint64_t> &current);
+
+  IStatsDeltaWriter(const IStatsDeltaWriter &);
+  void operator=(const IStatsDeltaWriter &);
+
+public:
+  /// Take ownership of \a os and start the writer thread. The snapshots
+  /// have \a size values, which are initially zero.
+  IStatsDeltaWriter(llvm::raw_fd_ostream *os, unsigned size);
+  /// Write the remaining snapshot, stop the writer thread and close the
+  /// stream.
+  ~IStatsDeltaWriter();
+
+  /// Queue \a snapshot to be written, replacing a queued snapshot that was
+  /// not picked up yet. \a snapshot is swapped with a spare buffer, so the
+  /// caller can reuse its allocation for the next snapshot.
+  void submit(double time, std::vector<uint64_t> &snapshot);
+};
+
+}
+
+#endif
@@ -10,9 +10,9 @@
 #include "Memory.h"
 
 #include "Context.h"
+#include "CoreStats.h"
 #include "klee/Expr.h"
 #include "klee/Solver.h"
-#include "klee/util/BitArray.h"
 #include "klee/Internal/Support/ErrorHandling.h"
 #include "klee/util/ArrayCache.h"
 
@@ -27,6 +27,7 @@
 #include "llvm/Support/raw_ostream.h"
 
 #include <cassert>
+#include <set>
 #include <sstream>
 
 using namespace llvm;
@@ -36,6 +37,11 @@ namespace {
   cl::opt<bool>
   UseConstantArrays("use-constant-arrays",
                     cl::init(true));
+
+  cl::opt<unsigned>
+  CompactUpdateLists("compact-update-lists",
+                     cl::desc("Compact the update list of an object once it has this many updates, and again whenever it doubled in size since (0=off, default=128)"),
+                     cl::init(128));
 }
 
 /***/
@@ -63,6 +69,29 @@ ObjectHolder &ObjectHolder::operator=(const ObjectHolder &b) {
 
 int MemoryObject::counter = 0;
 
+static SlabAllocator &getMemoryObjectSlab() {
+  // Never freed, memory objects may outlive any other object.
+  static SlabAllocator *slab = new SlabAllocator(sizeof(MemoryObject));
+  return *slab;
+}
+
+void *MemoryObject::operator new(size_t size) {
+  assert(size == sizeof(MemoryObject) && "unexpected memory object size");
+  void *p = getMemoryObjectSlab().allocate();
+  if (!p)
+    klee_error("out of memory allocating a memory object");
+  return p;
+}
+
+void MemoryObject::operator delete(void *p) {
+  if (p)
+    getMemoryObjectSlab().deallocate(p);
+}
+
+size_t MemoryObject::releaseFreeSlabs() {
+  return getMemoryObjectSlab().releaseEmptySlabs();
+}
+
 MemoryObject::~MemoryObject() {
   if (parent)
     parent->markFreed(this);
@@ -96,11 +125,12 @@ ObjectState::ObjectState(const MemoryObject *mo)
   : copyOnWriteOwner(0),
     refCount(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
+    concreteStore(mo->size),
     concreteMask(0),
     flushMask(0),
     knownSymbolics(0),
     updates(0, 0),
+    compactedUpdates(0),
     size(mo->size),
     readOnly(false) {
   mo->refCount++;
@@ -110,7 +140,6 @@ ObjectState::ObjectState(const MemoryObject *mo)
         getArrayCache()->CreateArray("tmp_arr" + llvm::utostr(++id), size);
     updates = UpdateList(array, 0);
   }
-  memset(concreteStore, 0, size);
 }
 
 
@@ -118,47 +147,42 @@ ObjectState::ObjectState(const MemoryObject *mo, const Array *array)
   : copyOnWriteOwner(0),
     refCount(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
+    concreteStore(mo->size),
     concreteMask(0),
     flushMask(0),
     knownSymbolics(0),
     updates(array, 0),
+    compactedUpdates(0),
     size(mo->size),
     readOnly(false) {
   mo->refCount++;
   makeSymbolic();
-  memset(concreteStore, 0, size);
 }
 
 ObjectState::ObjectState(const ObjectState &os) 
   : copyOnWriteOwner(0),
     refCount(0),
     object(os.object),
-    concreteStore(new uint8_t[os.size]),
-    concreteMask(os.concreteMask ? new BitArray(*os.concreteMask, os.size) : 0),
-    flushMask(os.flushMask ? new BitArray(*os.flushMask, os.size) : 0),
+    concreteStore(os.concreteStore),
+    concreteMask(os.concreteMask ? new PagedBitArray(*os.concreteMask, os.size) : 0),
+    flushMask(os.flushMask ? new PagedBitArray(*os.flushMask, os.size) : 0),
     knownSymbolics(0),
     updates(os.updates),
+    compactedUpdates(os.compactedUpdates),
     size(os.size),
     readOnly(false) {
   assert(!os.readOnly && "no need to copy read only object?");
   if (object)
     object->refCount++;
 
-  if (os.knownSymbolics) {
-    knownSymbolics = new ref<Expr>[size];
-    for (unsigned i=0; i<size; i++)
-      knownSymbolics[i] = os.knownSymbolics[i];
-  }
-
-  memcpy(concreteStore, os.concreteStore, size*sizeof(*concreteStore));
+  if (os.knownSymbolics)
+    knownSymbolics = new PagedArray<ref<Expr>, 512>(*os.knownSymbolics);
 }
 
 ObjectState::~ObjectState() {
   delete concreteMask;
   delete flushMask;
-  delete[] knownSymbolics;
-  delete[] concreteStore;
+  delete knownSymbolics;
 
   if (object)
   {
@@ -178,6 +202,8 @@ ArrayCache *ObjectState::getArrayCache() const {
 
 /***/
 
+static unsigned constantArrayId = 0;
+
 const UpdateList &ObjectState::getUpdates() const {
   // Constant arrays are created lazily.
   if (!updates.root) {
@@ -215,9 +241,8 @@ const UpdateList &ObjectState::getUpdates() const {
       Contents[Index->getZExtValue()] = Value;
     }
 
-    static unsigned id = 0;
     const Array *array = getArrayCache()->CreateArray(
-        "const_arr" + llvm::utostr(++id), size, &Contents[0],
+        "const_arr" + llvm::utostr(++constantArrayId), size, &Contents[0],
         &Contents[0] + Contents.size());
     updates = UpdateList(array, 0);
 
@@ -229,10 +254,78 @@ const UpdateList &ObjectState::getUpdates() const {
   return updates;
 }
 
+void ObjectState::compactUpdates() const {
+  unsigned numUpdates = updates.getSize();
+  if (!CompactUpdateLists || numUpdates < CompactUpdateLists ||
+      numUpdates < 2 * compactedUpdates)
+    return;
+
+  // The updates, newest first.
+  std::vector<const UpdateNode*> nodes;
+  nodes.reserve(numUpdates);
+  for (const UpdateNode *un = updates.head; un; un = un->next)
+    nodes.push_back(un);
+
+  // An update is dead if a newer one writes the same concrete index, as
+  // every read of that index stops at the newer one.
+  std::vector<bool> live(numUpdates, true);
+  std::set<uint64_t> written;
+  unsigned oldestDead = numUpdates;
+  for (unsigned i = 0; i != numUpdates; ++i) {
+    if (ConstantExpr *CE = dyn_cast<ConstantExpr>(nodes[i]->index)) {
+      if (!written.insert(CE->getZExtValue()).second) {
+        live[i] = false;
+        oldestDead = i;
+      }
+    }
+  }
+
+  // The concrete updates directly above a constant array can be folded
+  // into a new one.
+  unsigned folded = numUpdates;
+  if (updates.root && updates.root->isConstantArray())
+    while (folded && isa<ConstantExpr>(nodes[folded - 1]->index) &&
+           isa<ConstantExpr>(nodes[folded - 1]->value))
+      --folded;
+
+  UpdateList compacted(0, 0);
+  unsigned rebuilt;
+  if (folded != numUpdates) {
+    std::vector< ref<ConstantExpr> > Contents(updates.root->constantValues);
+    for (unsigned i = numUpdates; i != folded; --i) {
+      uint64_t index = cast<ConstantExpr>(nodes[i - 1]->index)->getZExtValue();
+      if (index < Contents.size())
+        Contents[index] = cast<ConstantExpr>(nodes[i - 1]->value);
+    }
+    // Objects which keep being written are folded again and again, the
+    // arrays are shared so that only distinct contents are kept.
+    const Array *array = getArrayCache()->CreateSharedConstantArray(
+        "const_arr" + llvm::utostr(++constantArrayId), size, &Contents[0],
+        &Contents[0] + Contents.size());
+    compacted = UpdateList(array, 0);
+    rebuilt = folded;
+  } else if (oldestDead != numUpdates) {
+    // Keep sharing the updates below the oldest dead one.
+    compacted = UpdateList(updates.root, nodes[oldestDead]->next);
+    rebuilt = oldestDead;
+  } else {
+    compactedUpdates = numUpdates;
+    return;
+  }
+
+  for (unsigned i = rebuilt; i != 0; --i)
+    if (live[i - 1])
+      compacted.extend(nodes[i - 1]->index, nodes[i - 1]->value);
+  nodes.clear();
+  stats::compactedUpdates += numUpdates - compacted.getSize();
+  updates = compacted;
+  compactedUpdates = updates.getSize();
+}
+
 void ObjectState::makeConcrete() {
   delete concreteMask;
   delete flushMask;
-  delete[] knownSymbolics;
+  delete knownSymbolics;
   concreteMask = 0;
   flushMask = 0;
   knownSymbolics = 0;
@@ -252,15 +345,13 @@ void ObjectState::makeSymbolic() {
 
 void ObjectState::initializeToZero() {
   makeConcrete();
-  memset(concreteStore, 0, size);
+  concreteStore.fill(0);
 }
 
 void ObjectState::initializeToRandom() {  
   makeConcrete();
-  for (unsigned i=0; i<size; i++) {
-    // randomly selected by 256 sided die
-    concreteStore[i] = 0xAB;
-  }
+  // randomly selected by 256 sided die
+  concreteStore.fill(0xAB);
 }
 
 /*
@@ -280,38 +371,39 @@ void ObjectState::fastRangeCheckOffset(ref<Expr> offset,
 
 void ObjectState::flushRangeForRead(unsigned rangeBase, 
                                     unsigned rangeSize) const {
-  if (!flushMask) flushMask = new BitArray(size, true);
+  if (!flushMask) flushMask = new PagedBitArray(size, true);
  
   for (unsigned offset=rangeBase; offset<rangeBase+rangeSize; offset++) {
     if (!isByteFlushed(offset)) {
       if (isByteConcrete(offset)) {
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       ConstantExpr::create(concreteStore[offset], Expr::Int8));
+                       ConstantExpr::create(concreteStore.get(offset), Expr::Int8));
       } else {
         assert(isByteKnownSymbolic(offset) && "invalid bit set in flushMask");
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       knownSymbolics[offset]);
+                       knownSymbolics->get(offset));
       }
 
       flushMask->unset(offset);
     }
   } 
+  compactUpdates();
 }
 
 void ObjectState::flushRangeForWrite(unsigned rangeBase, 
                                      unsigned rangeSize) {
-  if (!flushMask) flushMask = new BitArray(size, true);
+  if (!flushMask) flushMask = new PagedBitArray(size, true);
 
   for (unsigned offset=rangeBase; offset<rangeBase+rangeSize; offset++) {
     if (!isByteFlushed(offset)) {
       if (isByteConcrete(offset)) {
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       ConstantExpr::create(concreteStore[offset], Expr::Int8));
+                       ConstantExpr::create(concreteStore.get(offset), Expr::Int8));
         markByteSymbolic(offset);
       } else {
         assert(isByteKnownSymbolic(offset) && "invalid bit set in flushMask");
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       knownSymbolics[offset]);
+                       knownSymbolics->get(offset));
         setKnownSymbolic(offset, 0);
       }
 
@@ -326,6 +418,7 @@ void ObjectState::flushRangeForWrite(unsigned rangeBase,
       }
     }
   } 
+  compactUpdates();
 }
 
 bool ObjectState::isByteConcrete(unsigned offset) const {
@@ -337,7 +430,7 @@ bool ObjectState::isByteFlushed(unsigned offset) const {
 }
 
 bool ObjectState::isByteKnownSymbolic(unsigned offset) const {
-  return knownSymbolics && knownSymbolics[offset].get();
+  return knownSymbolics && knownSymbolics->get(offset).get();
 }
 
 void ObjectState::markByteConcrete(unsigned offset) {
@@ -347,7 +440,7 @@ void ObjectState::markByteConcrete(unsigned offset) {
 
 void ObjectState::markByteSymbolic(unsigned offset) {
   if (!concreteMask)
-    concreteMask = new BitArray(size, true);
+    concreteMask = new PagedBitArray(size, true);
   concreteMask->unset(offset);
 }
 
@@ -358,7 +451,7 @@ void ObjectState::markByteUnflushed(unsigned offset) {
 
 void ObjectState::markByteFlushed(unsigned offset) {
   if (!flushMask) {
-    flushMask = new BitArray(size, false);
+    flushMask = new PagedBitArray(size, false);
   } else {
     flushMask->unset(offset);
   }
@@ -367,11 +460,13 @@ void ObjectState::markByteFlushed(unsigned offset) {
 void ObjectState::setKnownSymbolic(unsigned offset, 
                                    Expr *value /* can be null */) {
   if (knownSymbolics) {
-    knownSymbolics[offset] = value;
+    // Avoid copying a shared page when there is nothing to clear.
+    if (value || knownSymbolics->get(offset).get())
+      knownSymbolics->set(offset, value);
   } else {
     if (value) {
-      knownSymbolics = new ref<Expr>[size];
-      knownSymbolics[offset] = value;
+      knownSymbolics = new PagedArray<ref<Expr>, 512>(size);
+      knownSymbolics->set(offset, value);
     }
   }
 }
@@ -380,9 +475,9 @@ void ObjectState::setKnownSymbolic(unsigned offset,
 
 ref<Expr> ObjectState::read8(unsigned offset) const {
   if (isByteConcrete(offset)) {
-    return ConstantExpr::create(concreteStore[offset], Expr::Int8);
+    return ConstantExpr::create(concreteStore.get(offset), Expr::Int8);
   } else if (isByteKnownSymbolic(offset)) {
-    return knownSymbolics[offset];
+    return knownSymbolics->get(offset);
   } else {
     assert(isByteFlushed(offset) && "unflushed byte without cache value");
     
@@ -410,7 +505,8 @@ ref<Expr> ObjectState::read8(ref<Expr> offset) const {
 
 void ObjectState::write8(unsigned offset, uint8_t value) {
   //assert(read_only == false && "writing to read-only object!");
-  concreteStore[offset] = value;
+  if (concreteStore.get(offset) != value)
+    concreteStore.set(offset, value);
   setKnownSymbolic(offset, 0);
 
   markByteConcrete(offset);
@@ -444,6 +540,7 @@ void ObjectState::write8(ref<Expr> offset, ref<Expr> value) {
   }
   
   updates.extend(ZExtExpr::create(offset, Expr::Int32), value);
+  compactUpdates();
 }
 
 /***/
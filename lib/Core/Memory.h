@@ -12,6 +12,7 @@
 
 #include "Context.h"
 #include "klee/Expr.h"
+#include "klee/Internal/ADT/PagedArray.h"
 
 #include "llvm/ADT/StringExtras.h"
 
@@ -24,7 +25,6 @@ namespace llvm {
 
 namespace klee {
 
-class BitArray;
 class MemoryManager;
 class Solver;
 class ArrayCache;
@@ -33,11 +33,17 @@ class MemoryObject {
   friend class STPBuilder;
   friend class ObjectState;
   friend class ExecutionState;
+  friend class MemoryManager;
 
 private:
   static int counter;
   mutable unsigned refCount;
 
+  /// Neighbours in the list of live objects of the parent MemoryManager.
+  MemoryObject *prevObject, *nextObject;
+  /// The arena size class the concrete memory was allocated from, or -1.
+  int sizeClass;
+
 public:
   unsigned id;
   uint64_t address;
@@ -74,6 +80,9 @@ public:
   explicit
   MemoryObject(uint64_t _address) 
     : refCount(0),
+      prevObject(0),
+      nextObject(0),
+      sizeClass(-1),
       id(counter++), 
       address(_address),
       size(0),
@@ -87,6 +96,9 @@ public:
                const llvm::Value *_allocSite,
                MemoryManager *_parent)
     : refCount(0), 
+      prevObject(0),
+      nextObject(0),
+      sizeClass(-1),
       id(counter++),
       address(_address),
       size(_size),
@@ -101,6 +113,13 @@ public:
 
   ~MemoryObject();
 
+  /// Memory objects are allocated from a slab allocator.
+  static void *operator new(size_t size);
+  static void operator delete(void *p);
+  /// Return the empty slabs of the allocator to the system, returns the
+  /// number of bytes released.
+  static size_t releaseFreeSlabs();
+
   /// Get an identifying string for this allocation.
   void getAllocInfo(std::string &result) const;
 
@@ -153,17 +172,21 @@ private:
 
   const MemoryObject *object;
 
-  uint8_t *concreteStore;
+  // The contents are paged so that copies of an object state share the
+  // pages that neither of them has written to.
+  PagedArray<uint8_t, 4096> concreteStore;
   // XXX cleanup name of flushMask (its backwards or something)
-  BitArray *concreteMask;
+  PagedBitArray *concreteMask;
 
   // mutable because may need flushed during read of const
-  mutable BitArray *flushMask;
+  mutable PagedBitArray *flushMask;
 
-  ref<Expr> *knownSymbolics;
+  PagedArray<ref<Expr>, 512> *knownSymbolics;
 
   // mutable because we may need flush during read of const
   mutable UpdateList updates;
+  /// The size of the update list after it was last compacted.
+  mutable unsigned compactedUpdates;
 
 public:
   unsigned size;
@@ -207,6 +230,10 @@ public:
 
 private:
   const UpdateList &getUpdates() const;
+  /// Drop the updates that are overwritten by a newer update at the same
+  /// concrete index, and fold the concrete updates at the bottom of the
+  /// list into a new constant array, once the list has grown enough.
+  void compactUpdates() const;
 
   void makeConcrete();
 
@@ -46,6 +46,12 @@ llvm::cl::opt<unsigned> RedZoneSpace(
                    "important to detect out-of-bound accesses (default=10)."),
     llvm::cl::init(10));
 
+llvm::cl::opt<bool> UseMemoryArena(
+    "use-memory-arena",
+    llvm::cl::desc("Allocate the concrete memory of small objects from "
+                   "size class arenas instead of malloc (default=on)"),
+    llvm::cl::init(true));
+
 llvm::cl::opt<unsigned long long> DeterministicStartAddress(
     "allocate-determ-start-address",
     llvm::cl::desc("Start address for deterministic allocation. Has to be page "
@@ -53,10 +59,25 @@ llvm::cl::opt<unsigned long long> DeterministicStartAddress(
     llvm::cl::init(0x7ff30000000));
 }
 
+/// The smallest arena size class, every next class is twice as large.
+static const unsigned MinSizeClass = 16;
+
+/// Space left between two arena slots, so that a pointer just past the
+/// end of one object does not point into the next one (malloc has a chunk
+/// header there).
+static const unsigned ArenaRedZone = 16;
+
 /***/
 MemoryManager::MemoryManager(ArrayCache *_arrayCache)
-    : arrayCache(_arrayCache), deterministicSpace(0), nextFreeSlot(0),
+    : objects(0), numObjects(0), arrayCache(_arrayCache),
+      deterministicSpace(0), nextFreeSlot(0),
       spaceSize(DeterministicAllocationSize.getValue() * 1024 * 1024) {
+  for (unsigned i = 0; i < NumSizeClasses; ++i)
+    arenas[i] = 0;
+  if (UseMemoryArena && !DeterministicAllocation)
+    for (unsigned i = 0; i < NumSizeClasses; ++i)
+      arenas[i] = new SlabAllocator((MinSizeClass << i) + ArenaRedZone);
+
   if (DeterministicAllocation) {
     // Page boundary
     void *expectedAddress = (void *)DeterministicStartAddress.getValue();
@@ -79,14 +100,16 @@ MemoryManager::MemoryManager(ArrayCache *_arrayCache)
 }
 
 MemoryManager::~MemoryManager() {
-  while (!objects.empty()) {
-    MemoryObject *mo = *objects.begin();
-    if (!mo->isFixed && !DeterministicAllocation)
-      free((void *)mo->address);
-    objects.erase(mo);
+  while (objects) {
+    MemoryObject *mo = objects;
+    markFreed(mo);
+    mo->parent = 0;
     delete mo;
   }
 
+  for (unsigned i = 0; i < NumSizeClasses; ++i)
+    delete arenas[i];
+
   if (DeterministicAllocation)
     munmap(deterministicSpace, spaceSize);
 }
@@ -110,7 +133,14 @@ MemoryObject *MemoryManager::allocate(uint64_t size, bool isLocal,
   }
 
   uint64_t address = 0;
-  if (DeterministicAllocation) {
+  int sizeClass = -1;
+  if (arenas[0] && alignment <= MinSizeClass &&
+      size <= (MinSizeClass << (NumSizeClasses - 1))) {
+    sizeClass = 0;
+    while ((MinSizeClass << sizeClass) < size)
+      ++sizeClass;
+    address = (uint64_t)arenas[sizeClass]->allocate();
+  } else if (DeterministicAllocation) {
 
     address = llvm::RoundUpToAlignment((uint64_t)nextFreeSlot + alignment - 1,
                                        alignment);
@@ -145,16 +175,15 @@ MemoryObject *MemoryManager::allocate(uint64_t size, bool isLocal,
   ++stats::allocations;
   MemoryObject *res = new MemoryObject(address, size, isLocal, isGlobal, false,
                                        allocSite, this);
-  objects.insert(res);
+  res->sizeClass = sizeClass;
+  registerObject(res);
   return res;
 }
 
 MemoryObject *MemoryManager::allocateFixed(uint64_t address, uint64_t size,
                                            const llvm::Value *allocSite) {
 #ifndef NDEBUG
-  for (objects_ty::iterator it = objects.begin(), ie = objects.end(); it != ie;
-       ++it) {
-    MemoryObject *mo = *it;
+  for (MemoryObject *mo = objects; mo; mo = mo->nextObject) {
     if (address + size > mo->address && address < mo->address + mo->size)
       klee_error("Trying to allocate an overlapping object");
   }
@@ -163,18 +192,62 @@ MemoryObject *MemoryManager::allocateFixed(uint64_t address, uint64_t size,
   ++stats::allocations;
   MemoryObject *res =
       new MemoryObject(address, size, false, true, true, allocSite, this);
-  objects.insert(res);
+  registerObject(res);
   return res;
 }
 
 void MemoryManager::deallocate(const MemoryObject *mo) { assert(0); }
 
+void MemoryManager::registerObject(MemoryObject *mo) {
+  mo->prevObject = 0;
+  mo->nextObject = objects;
+  if (objects)
+    objects->prevObject = mo;
+  objects = mo;
+  ++numObjects;
+}
+
 void MemoryManager::markFreed(MemoryObject *mo) {
-  if (objects.find(mo) != objects.end()) {
-    if (!mo->isFixed && !DeterministicAllocation)
-      free((void *)mo->address);
-    objects.erase(mo);
-  }
+  if (!mo->prevObject && objects != mo)
+    return; // already freed
+
+  if (mo->sizeClass >= 0)
+    arenas[mo->sizeClass]->deallocate((void *)mo->address);
+  else if (!mo->isFixed && !DeterministicAllocation)
+    free((void *)mo->address);
+
+  if (mo->prevObject)
+    mo->prevObject->nextObject = mo->nextObject;
+  else
+    objects = mo->nextObject;
+  if (mo->nextObject)
+    mo->nextObject->prevObject = mo->prevObject;
+  mo->prevObject = mo->nextObject = 0;
+  --numObjects;
+}
+
+size_t MemoryManager::getArenaReservedSize() const {
+  size_t res = 0;
+  for (unsigned i = 0; i < NumSizeClasses; ++i)
+    if (arenas[i])
+      res += arenas[i]->getReservedSize();
+  return res;
+}
+
+size_t MemoryManager::getArenaUsedSize() const {
+  size_t res = 0;
+  for (unsigned i = 0; i < NumSizeClasses; ++i)
+    if (arenas[i])
+      res += arenas[i]->getUsedSize();
+  return res;
+}
+
+size_t MemoryManager::releaseFreeMemory() {
+  size_t res = MemoryObject::releaseFreeSlabs();
+  for (unsigned i = 0; i < NumSizeClasses; ++i)
+    if (arenas[i])
+      res += arenas[i]->releaseEmptySlabs();
+  return res;
 }
 
 size_t MemoryManager::getUsedDeterministicSize() {
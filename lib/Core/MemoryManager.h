@@ -10,7 +10,8 @@
 #ifndef KLEE_MEMORYMANAGER_H
 #define KLEE_MEMORYMANAGER_H
 
-#include <set>
+#include "klee/Internal/ADT/SlabAllocator.h"
+
 #include <stdint.h>
 
 namespace llvm {
@@ -23,14 +24,23 @@ class ArrayCache;
 
 class MemoryManager {
 private:
-  typedef std::set<MemoryObject *> objects_ty;
-  objects_ty objects;
+  /// Number of arena size classes for small allocations.
+  enum { NumSizeClasses = 5 };
+
+  /// Head of the intrusive list of live memory objects.
+  MemoryObject *objects;
+  unsigned numObjects;
   ArrayCache *const arrayCache;
 
+  /// Arenas for the concrete memory of small objects, one per size class.
+  SlabAllocator *arenas[NumSizeClasses];
+
   char *deterministicSpace;
   char *nextFreeSlot;
   size_t spaceSize;
 
+  void registerObject(MemoryObject *mo);
+
 public:
   MemoryManager(ArrayCache *arrayCache);
   ~MemoryManager();
@@ -47,6 +57,22 @@ public:
   void markFreed(MemoryObject *mo);
   ArrayCache *getArrayCache() const { return arrayCache; }
 
+  /// Returns the number of memory objects that have not been freed.
+  unsigned getNumObjects() const { return numObjects; }
+
+  /// Returns the bytes of concrete memory reserved for the arenas.
+  size_t getArenaReservedSize() const;
+
+  /// Returns the bytes of concrete memory handed out from the arenas,
+  /// including padding up to the size classes.
+  size_t getArenaUsedSize() const;
+
+  /// Return the empty slabs of the arenas and of the memory objects to
+  /// the system. Freed slots are otherwise kept for reuse, so the malloc
+  /// usage would not drop when states are killed. Returns the number of
+  /// bytes released.
+  size_t releaseFreeMemory();
+
   /*
    * Returns the size used by deterministic allocation in bytes
    */
@@ -35,7 +35,9 @@
 #include "llvm/IR/CallSite.h"
 #endif
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <fstream>
 #include <climits>
 
@@ -49,6 +51,45 @@ namespace klee {
 Searcher::~Searcher() {
 }
 
+static bool hasNotCoveredNew(const ExecutionState *es) {
+  return !es->coveredNew;
+}
+
+void Searcher::orderForSpilling(std::vector<ExecutionState *> &states) {
+  for (unsigned i = states.size(); i > 1; --i)
+    std::swap(states[i - 1], states[theRNG.getInt32() % i]);
+  // States that covered new code are likely to be selected again soon.
+  std::stable_partition(states.begin(), states.end(), hasNotCoveredNew);
+}
+
+namespace {
+  /// Compare states by their rank, states without one come last.
+  struct RankOrder {
+    const std::map<ExecutionState*, double> &rank;
+
+    RankOrder(const std::map<ExecutionState*, double> &_rank) : rank(_rank) {}
+
+    double get(ExecutionState *es) const {
+      std::map<ExecutionState*, double>::const_iterator it = rank.find(es);
+      return it == rank.end() ? HUGE_VAL : it->second;
+    }
+
+    bool operator()(ExecutionState *a, ExecutionState *b) const {
+      return get(a) < get(b);
+    }
+  };
+}
+
+/// Sort \a states by their position in [\a begin, \a end).
+template <class Iterator>
+static void sortByPosition(Iterator begin, Iterator end,
+                           std::vector<ExecutionState *> &states) {
+  std::map<ExecutionState*, double> position;
+  for (double i = 0; begin != end; ++begin, ++i)
+    position[*begin] = i;
+  std::stable_sort(states.begin(), states.end(), RankOrder(position));
+}
+
 ///
 
 ExecutionState &DFSSearcher::selectState() {
@@ -85,6 +126,11 @@ void DFSSearcher::update(ExecutionState *current,
   }
 }
 
+void DFSSearcher::orderForSpilling(std::vector<ExecutionState *> &es) {
+  // The bottom of the stack is selected last.
+  sortByPosition(states.begin(), states.end(), es);
+}
+
 ///
 
 ExecutionState &BFSSearcher::selectState() {
@@ -132,6 +178,11 @@ void BFSSearcher::update(ExecutionState *current,
   }
 }
 
+void BFSSearcher::orderForSpilling(std::vector<ExecutionState *> &es) {
+  // The back of the queue is selected last.
+  sortByPosition(states.rbegin(), states.rend(), es);
+}
+
 ///
 
 ExecutionState &RandomSearcher::selectState() {
@@ -256,6 +307,16 @@ bool WeightedRandomSearcher::empty() {
   return states->empty(); 
 }
 
+void WeightedRandomSearcher::orderForSpilling(
+    std::vector<ExecutionState *> &es) {
+  std::map<ExecutionState*, double> weights;
+  for (std::vector<ExecutionState *>::iterator it = es.begin(), ie = es.end();
+       it != ie; ++it)
+    if (states->inTree(*it))
+      weights[*it] = states->getWeight(*it);
+  std::stable_sort(es.begin(), es.end(), RankOrder(weights));
+}
+
 ///
 
 RandomPathSearcher::RandomPathSearcher(Executor &_executor)
@@ -401,6 +462,26 @@ void IterativeDeepeningTimeSearcher::update(
   }
 }
 
+namespace {
+  struct IsPaused {
+    const std::set<ExecutionState*> &pausedStates;
+
+    IsPaused(const std::set<ExecutionState*> &_pausedStates)
+      : pausedStates(_pausedStates) {}
+
+    bool operator()(ExecutionState *es) const {
+      return pausedStates.count(es);
+    }
+  };
+}
+
+void IterativeDeepeningTimeSearcher::orderForSpilling(
+    std::vector<ExecutionState *> &states) {
+  baseSearcher->orderForSpilling(states);
+  // Paused states wait for the time budget to increase.
+  std::stable_partition(states.begin(), states.end(), IsPaused(pausedStates));
+}
+
 /***/
 
 InterleavedSearcher::InterleavedSearcher(const std::vector<Searcher*> &_searchers)
@@ -420,6 +501,16 @@ ExecutionState &InterleavedSearcher::selectState() {
   return s->selectState();
 }
 
+bool InterleavedSearcher::empty() {
+  // The searchers may disagree on paused states, e.g. random-path does
+  // not track them, so nothing is selected unless all have a state.
+  for (std::vector<Searcher*>::const_iterator it = searchers.begin(),
+         ie = searchers.end(); it != ie; ++it)
+    if ((*it)->empty())
+      return true;
+  return false;
+}
+
 void InterleavedSearcher::update(
     ExecutionState *current, const std::vector<ExecutionState *> &addedStates,
     const std::vector<ExecutionState *> &removedStates) {
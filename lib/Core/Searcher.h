@@ -40,6 +40,12 @@ namespace klee {
 
     virtual bool empty() = 0;
 
+    /// Order \a states, which are tracked by the searcher, so that the
+    /// states it expects to select last come first. The executor spills
+    /// states from the front when memory runs out. The default order is
+    /// random, except that states which covered new code come last.
+    virtual void orderForSpilling(std::vector<ExecutionState *> &states);
+
     // prints name of searcher as a klee_message()
     // TODO: could probably make prettier or more flexible
     virtual void printName(llvm::raw_ostream &os) {
@@ -89,6 +95,7 @@ namespace klee {
                 const std::vector<ExecutionState *> &addedStates,
                 const std::vector<ExecutionState *> &removedStates);
     bool empty() { return states.empty(); }
+    void orderForSpilling(std::vector<ExecutionState *> &states);
     void printName(llvm::raw_ostream &os) {
       os << "DFSSearcher\n";
     }
@@ -103,6 +110,7 @@ namespace klee {
                 const std::vector<ExecutionState *> &addedStates,
                 const std::vector<ExecutionState *> &removedStates);
     bool empty() { return states.empty(); }
+    void orderForSpilling(std::vector<ExecutionState *> &states);
     void printName(llvm::raw_ostream &os) {
       os << "BFSSearcher\n";
     }
@@ -149,6 +157,7 @@ namespace klee {
                 const std::vector<ExecutionState *> &addedStates,
                 const std::vector<ExecutionState *> &removedStates);
     bool empty();
+    void orderForSpilling(std::vector<ExecutionState *> &states);
     void printName(llvm::raw_ostream &os) {
       os << "WeightedRandomSearcher::";
       switch(type) {
@@ -200,6 +209,9 @@ namespace klee {
                 const std::vector<ExecutionState *> &addedStates,
                 const std::vector<ExecutionState *> &removedStates);
     bool empty() { return baseSearcher->empty(); }
+    void orderForSpilling(std::vector<ExecutionState *> &states) {
+      baseSearcher->orderForSpilling(states);
+    }
     void printName(llvm::raw_ostream &os) {
       os << "<BatchingSearcher> timeBudget: " << timeBudget
          << ", instructionBudget: " << instructionBudget
@@ -223,6 +235,7 @@ namespace klee {
                 const std::vector<ExecutionState *> &addedStates,
                 const std::vector<ExecutionState *> &removedStates);
     bool empty() { return baseSearcher->empty() && pausedStates.empty(); }
+    void orderForSpilling(std::vector<ExecutionState *> &states);
     void printName(llvm::raw_ostream &os) {
       os << "IterativeDeepeningTimeSearcher\n";
     }
@@ -242,7 +255,10 @@ namespace klee {
     void update(ExecutionState *current,
                 const std::vector<ExecutionState *> &addedStates,
                 const std::vector<ExecutionState *> &removedStates);
-    bool empty() { return searchers[0]->empty(); }
+    bool empty();
+    void orderForSpilling(std::vector<ExecutionState *> &states) {
+      searchers[0]->orderForSpilling(states);
+    }
     void printName(llvm::raw_ostream &os) {
       os << "<InterleavedSearcher> containing "
          << searchers.size() << " searchers:\n";
@@ -9,6 +9,7 @@
 
 #include "StatsTracker.h"
 
+#include "klee/CommandLine.h"
 #include "klee/ExecutionState.h"
 #include "klee/Statistics.h"
 #include "klee/Config/Version.h"
@@ -24,6 +25,7 @@
 #include "CallPathManager.h"
 #include "CoreStats.h"
 #include "Executor.h"
+#include "IStatsDeltaWriter.h"
 #include "MemoryManager.h"
 #include "UserSearcher.h"
 
@@ -47,6 +49,8 @@
 #include "llvm/IR/CFG.h"
 #endif
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <unistd.h>
 
@@ -71,6 +75,11 @@ namespace {
 	       cl::init(true),
                cl::desc("Write instruction level statistics in callgrind format (default=on)"));
 
+  cl::opt<bool>
+  BinaryStats("binary-stats",
+              cl::init(false),
+              cl::desc("Write run.stats as a binary log with a fixed size record per line rather than as text (default=off)"));
+
   cl::opt<double>
   StatsWriteInterval("stats-write-interval",
                      cl::init(1.),
@@ -86,6 +95,11 @@ namespace {
 		      cl::init(10.),
                       cl::desc("Approximate number of seconds between istats writes (default: 10.0s)"));
 
+  cl::opt<bool>
+  IStatsDelta("istats-delta",
+              cl::init(false),
+              cl::desc("Write the periodic istats as deltas to run.istats.delta from a separate thread, run.istats is only written at the end, see klee-istats (default=off)"));
+
   cl::opt<unsigned> IStatsWriteAfterInstructions(
       "istats-write-after-instructions", cl::init(0),
       cl::desc("Write istats after each n instructions, 0 to disable "
@@ -104,6 +118,17 @@ namespace {
   
 }
 
+/// The query latency histograms written to run.stats with
+/// --query-latency-histograms, from the top of the solver chain down.
+static QueryLatencyHistogram *const latencyHistograms[] = {
+  &stats::independentQueryLatency,
+  &stats::cacheQueryLatency,
+  &stats::cexCacheQueryLatency,
+  &stats::coreQueryLatency,
+};
+static const unsigned NumLatencyHistograms =
+  sizeof(latencyHistograms) / sizeof(latencyHistograms[0]);
+
 ///
 
 bool StatsTracker::useStatistics() {
@@ -118,7 +143,10 @@ namespace klee {
     WriteIStatsTimer(StatsTracker *_statsTracker) : statsTracker(_statsTracker) {}
     ~WriteIStatsTimer() {}
     
-    void run() { statsTracker->writeIStats(); }
+    void run() {
+      if (statsTracker->istatsFile)
+        statsTracker->updateIStats();
+    }
   };
   
   class WriteStatsTimer : public Executor::Timer {
@@ -128,7 +156,10 @@ namespace klee {
     WriteStatsTimer(StatsTracker *_statsTracker) : statsTracker(_statsTracker) {}
     ~WriteStatsTimer() {}
     
-    void run() { statsTracker->writeStatsLine(); }
+    void run() {
+      if (statsTracker->statsFile)
+        statsTracker->writeStatsLine();
+    }
   };
 
   class UpdateReachableTimer : public Executor::Timer {
@@ -174,11 +205,13 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
     objectFilename(_objectFilename),
     statsFile(0),
     istatsFile(0),
+    istatsDeltaWriter(0),
     startWallTime(util::getWallTime()),
     numBranches(0),
     fullBranches(0),
     partialBranches(0),
-    updateMinDistToUncovered(_updateMinDistToUncovered) {
+    updateMinDistToUncovered(_updateMinDistToUncovered),
+    recomputeAllUncovered(true) {
 
   if (StatsWriteAfterInstructions > 0 && StatsWriteInterval > 0)
     klee_error("Both options --stats-write-interval and "
@@ -258,6 +291,9 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
     istatsFile = executor.interpreterHandler->openOutputFile("run.istats");
     assert(istatsFile && "unable to open istats file");
 
+    if (IStatsDelta)
+      openIStatsDelta();
+
     if (IStatsWriteInterval > 0)
       executor.addTimer(new WriteIStatsTimer(this), IStatsWriteInterval);
   }
@@ -266,16 +302,66 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
 StatsTracker::~StatsTracker() {  
   delete statsFile;
   delete istatsFile;
+  delete istatsDeltaWriter;
 }
 
 void StatsTracker::done() {
   if (statsFile)
     writeStatsLine();
 
-  if (OutputIStats) {
+  if (istatsFile) {
     if (updateMinDistToUncovered)
       computeReachableUncovered();
     writeIStats();
+    if (istatsDeltaWriter) {
+      writeIStatsDelta();
+      delete istatsDeltaWriter;
+      istatsDeltaWriter = 0;
+    }
+  }
+}
+
+void StatsTracker::closeOutputFiles() {
+  delete statsFile;
+  statsFile = 0;
+  delete istatsFile;
+  istatsFile = 0;
+  // The writer thread does not exist in a forked worker, so the writer
+  // cannot be stopped and is left alone.
+  istatsDeltaWriter = 0;
+}
+
+void StatsTracker::recomputeBranchCoverage() {
+  // The coverage may have changed anywhere.
+  recomputeAllUncovered = true;
+
+  if (!OutputIStats)
+    return;
+
+  fullBranches = partialBranches = 0;
+  KModule *km = executor.kmodule;
+  for (std::vector<KFunction*>::iterator it = km->functions.begin(),
+         ie = km->functions.end(); it != ie; ++it) {
+    KFunction *kf = *it;
+    if (!kf->trackCoverage)
+      continue;
+
+    for (unsigned i=0; i<kf->numInstructions; ++i) {
+      KInstruction *ki = kf->instructions[i];
+      BranchInst *bi = dyn_cast<BranchInst>(ki->inst);
+      if (!bi || bi->isUnconditional())
+        continue;
+
+      unsigned id = ki->info->id;
+      uint64_t hasTrue =
+        theStatisticManager->getIndexedValue(stats::trueBranches, id);
+      uint64_t hasFalse =
+        theStatisticManager->getIndexedValue(stats::falseBranches, id);
+      if (hasTrue && hasFalse)
+        ++fullBranches;
+      else if (hasTrue || hasFalse)
+        ++partialBranches;
+    }
   }
 }
 
@@ -321,6 +407,8 @@ void StatsTracker::stepInstruction(ExecutionState &es) {
         es.instsSinceCovNew = 1;
 	++stats::coveredInstructions;
 	stats::uncoveredInstructions += (uint64_t)-1;
+        if (updateMinDistToUncovered)
+          newlyCoveredFunctions.insert(sf.kf->function);
       }
     }
   }
@@ -331,7 +419,7 @@ void StatsTracker::stepInstruction(ExecutionState &es) {
 
   if (istatsFile && IStatsWriteAfterInstructions &&
       stats::instructions % IStatsWriteAfterInstructions.getValue() == 0)
-    writeIStats();
+    updateIStats();
 }
 
 ///
@@ -393,29 +481,96 @@ void StatsTracker::markBranchVisited(ExecutionState *visitedTrue,
   }
 }
 
-void StatsTracker::writeStatsHeader() {
-  *statsFile << "('Instructions',"
-             << "'FullBranches',"
-             << "'PartialBranches',"
-             << "'NumBranches',"
-             << "'UserTime',"
-             << "'NumStates',"
-             << "'MallocUsage',"
-             << "'NumQueries',"
-             << "'NumQueryConstructs',"
-             << "'NumObjects',"
-             << "'WallTime',"
-             << "'CoveredInstructions',"
-             << "'UncoveredInstructions',"
-             << "'QueryTime',"
-             << "'SolverTime',"
-             << "'CexCacheTime',"
-             << "'ForkTime',"
-             << "'ResolveTime',"
+void StatsTracker::getStatsLine(std::vector<StatsValue> &line) {
+  // klee-stats reads the columns up to ResolveTime by position, new
+  // columns go at the end.
+  line.clear();
+  line.push_back(StatsValue("Instructions", stats::instructions.getValue()));
+  line.push_back(StatsValue("FullBranches", (uint64_t) fullBranches));
+  line.push_back(StatsValue("PartialBranches", (uint64_t) partialBranches));
+  line.push_back(StatsValue("NumBranches", (uint64_t) numBranches));
+  line.push_back(StatsValue("UserTime", util::getUserTime()));
+  line.push_back(StatsValue("NumStates", (uint64_t) executor.states.size()));
+  line.push_back(StatsValue("MallocUsage",
+                            (uint64_t) (util::GetTotalMallocUsage() +
+                                executor.memory->getUsedDeterministicSize())));
+  line.push_back(StatsValue("NumQueries", stats::queries.getValue()));
+  line.push_back(StatsValue("NumQueryConstructs",
+                            stats::queryConstructs.getValue()));
+  line.push_back(StatsValue("NumObjects",
+                            (uint64_t) executor.memory->getNumObjects()));
+  line.push_back(StatsValue("WallTime", elapsed()));
+  line.push_back(StatsValue("CoveredInstructions",
+                            stats::coveredInstructions.getValue()));
+  line.push_back(StatsValue("UncoveredInstructions",
+                            stats::uncoveredInstructions.getValue()));
+  line.push_back(StatsValue("QueryTime", stats::queryTime / 1000000.));
+  line.push_back(StatsValue("SolverTime", stats::solverTime / 1000000.));
+  line.push_back(StatsValue("CexCacheTime", stats::cexCacheTime / 1000000.));
+  line.push_back(StatsValue("ForkTime", stats::forkTime / 1000000.));
+  line.push_back(StatsValue("ResolveTime", stats::resolveTime / 1000000.));
 #ifdef DEBUG
-	     << "'ArrayHashTime',"
+  line.push_back(StatsValue("ArrayHashTime", stats::arrayHashTime / 1000000.));
 #endif
-             << ")\n";
+  line.push_back(StatsValue("ArenaReserved",
+                            (uint64_t) executor.memory->getArenaReservedSize()));
+  line.push_back(StatsValue("ArenaUsed",
+                            (uint64_t) executor.memory->getArenaUsedSize()));
+  line.push_back(StatsValue("ExprPoolReserved",
+                            (uint64_t) Expr::getPoolReservedSize()));
+  line.push_back(StatsValue("ExprPoolUsed", (uint64_t) Expr::getPoolUsedSize()));
+  // The live entries and estimated bytes of the counterexample cache.
+  line.push_back(StatsValue("CexCacheEntries",
+                            stats::queryCexCacheEntries -
+                                stats::queryCexCacheEvictions));
+  line.push_back(StatsValue("CexCacheBytes",
+                            stats::queryCexCacheBytes -
+                                stats::queryCexCacheFreedBytes));
+  line.push_back(StatsValue("ExprAllocations", Expr::getPoolAllocations()));
+  line.push_back(StatsValue("ExprFrees", Expr::getPoolFrees()));
+  line.push_back(StatsValue("ExprMallocs", Expr::getPoolMallocs()));
+  // The number of translations held by the solver builders.
+  line.push_back(StatsValue("ConstructCacheEntries",
+                            stats::queryConstructCacheEntries.getValue()));
+  if (QueryLatencyHistograms) {
+    for (unsigned i = 0; i != NumLatencyHistograms; ++i)
+      for (unsigned j = 0; j != QueryLatencyHistogram::NumBuckets; ++j)
+        line.push_back(StatsValue(
+            std::string(latencyHistograms[i]->getName()) + "_" +
+                QueryLatencyHistogram::getBucketName(j),
+            latencyHistograms[i]->getCount(j)));
+  }
+}
+
+/// Write \a value in little endian byte order.
+static void writeBinaryStat(llvm::raw_ostream &os, uint64_t value,
+                            unsigned bytes = 8) {
+  for (unsigned i = 0; i != bytes; ++i)
+    os << (char) ((value >> (8 * i)) & 0xFF);
+}
+
+void StatsTracker::writeStatsHeader() {
+  std::vector<StatsValue> line;
+  getStatsLine(line);
+
+  if (BinaryStats) {
+    // The magic and version, the number of columns and for each column
+    // its type ('Q' for counts, 'd' for times) and name. Every line is
+    // then a little endian 64 bit value per column.
+    *statsFile << "KLEESTAT";
+    writeBinaryStat(*statsFile, 1, 4);
+    writeBinaryStat(*statsFile, line.size(), 4);
+    for (unsigned i = 0; i != line.size(); ++i) {
+      *statsFile << (line[i].isTime ? 'd' : 'Q');
+      writeBinaryStat(*statsFile, line[i].name.size(), 2);
+      *statsFile << line[i].name;
+    }
+  } else {
+    *statsFile << "(";
+    for (unsigned i = 0; i != line.size(); ++i)
+      *statsFile << "'" << line[i].name << "',";
+    *statsFile << ")\n";
+  }
   statsFile->flush();
 }
 
@@ -424,28 +579,28 @@ double StatsTracker::elapsed() {
 }
 
 void StatsTracker::writeStatsLine() {
-  *statsFile << "(" << stats::instructions
-             << "," << fullBranches
-             << "," << partialBranches
-             << "," << numBranches
-             << "," << util::getUserTime()
-             << "," << executor.states.size()
-             << "," << util::GetTotalMallocUsage() + executor.memory->getUsedDeterministicSize()
-             << "," << stats::queries
-             << "," << stats::queryConstructs
-             << "," << 0 // was numObjects
-             << "," << elapsed()
-             << "," << stats::coveredInstructions
-             << "," << stats::uncoveredInstructions
-             << "," << stats::queryTime / 1000000.
-             << "," << stats::solverTime / 1000000.
-             << "," << stats::cexCacheTime / 1000000.
-             << "," << stats::forkTime / 1000000.
-             << "," << stats::resolveTime / 1000000.
-#ifdef DEBUG
-             << "," << stats::arrayHashTime / 1000000.
-#endif
-             << ")\n";
+  std::vector<StatsValue> line;
+  getStatsLine(line);
+
+  if (BinaryStats) {
+    for (unsigned i = 0; i != line.size(); ++i) {
+      uint64_t bits = line[i].count;
+      if (line[i].isTime)
+        memcpy(&bits, &line[i].time, sizeof(bits));
+      writeBinaryStat(*statsFile, bits);
+    }
+  } else {
+    *statsFile << "(";
+    for (unsigned i = 0; i != line.size(); ++i) {
+      if (i)
+        *statsFile << ",";
+      if (line[i].isTime)
+        *statsFile << line[i].time;
+      else
+        *statsFile << line[i].count;
+    }
+    *statsFile << ")\n";
+  }
   statsFile->flush();
 }
 
@@ -460,6 +615,117 @@ void StatsTracker::updateStateStatistics(uint64_t addend) {
   }
 }
 
+/// The statistics written to run.istats.
+static uint64_t getIStatsMask() {
+  StatisticManager &sm = *theStatisticManager;
+  uint64_t istatsMask = 0;
+
+  // Max is 13, sadly
+  istatsMask |= 1<<sm.getStatisticID("Queries");
+  istatsMask |= 1<<sm.getStatisticID("QueriesValid");
+  istatsMask |= 1<<sm.getStatisticID("QueriesInvalid");
+  istatsMask |= 1<<sm.getStatisticID("QueryTime");
+  istatsMask |= 1<<sm.getStatisticID("ResolveTime");
+  istatsMask |= 1<<sm.getStatisticID("Instructions");
+  istatsMask |= 1<<sm.getStatisticID("InstructionTimes");
+  istatsMask |= 1<<sm.getStatisticID("InstructionRealTimes");
+  istatsMask |= 1<<sm.getStatisticID("Forks");
+  istatsMask |= 1<<sm.getStatisticID("CoveredInstructions");
+  istatsMask |= 1<<sm.getStatisticID("UncoveredInstructions");
+  istatsMask |= 1<<sm.getStatisticID("States");
+  istatsMask |= 1<<sm.getStatisticID("MinDistToUncovered");
+  return istatsMask;
+}
+
+void StatsTracker::updateIStats() {
+  if (istatsDeltaWriter)
+    writeIStatsDelta();
+  else
+    writeIStats();
+}
+
+void StatsTracker::openIStatsDelta() {
+  llvm::raw_fd_ostream *of =
+    executor.interpreterHandler->openOutputFile("run.istats.delta");
+  if (!of) {
+    klee_warning("unable to open run.istats.delta, writing run.istats");
+    return;
+  }
+
+  Module *m = executor.kmodule->module;
+  StatisticManager &sm = *theStatisticManager;
+  uint64_t istatsMask = getIStatsMask();
+
+  // The layout of the snapshots, in the terms of writeIStats(), then the
+  // binary records of the IStatsDeltaWriter.
+  *of << "klee-istats-delta: 1\n";
+  *of << "creator: klee\n";
+  *of << "pid: " << getpid() << "\n";
+  *of << "cmd: " << m->getModuleIdentifier() << "\n";
+  *of << "ob=" << objectFilename << "\n";
+  for (unsigned i=0; i<sm.getNumStatistics(); i++) {
+    if (istatsMask & (1<<i)) {
+      Statistic &s = sm.getStatistic(i);
+      istatsStatistics.push_back(&s);
+      *of << "event: " << s.getShortName() << " : " << s.getName() << "\n";
+    }
+  }
+
+  std::string sourceFile = "";
+  for (Module::iterator fnIt = m->begin(), fn_ie = m->end(); 
+       fnIt != fn_ie; ++fnIt) {
+    if (fnIt->isDeclaration())
+      continue;
+    const InstructionInfo &fi =
+      executor.kmodule->infos->getFunctionInfo(&*fnIt);
+    if (fi.file != sourceFile) {
+      *of << "fl=" << fi.file << "\n";
+      sourceFile = fi.file;
+    }
+    *of << "fn=" << fnIt->getName().str() << "\n";
+    for (Function::iterator bbIt = fnIt->begin(), bb_ie = fnIt->end(); 
+         bbIt != bb_ie; ++bbIt) {
+      for (BasicBlock::iterator it = bbIt->begin(), ie = bbIt->end(); 
+           it != ie; ++it) {
+        const InstructionInfo &ii = executor.kmodule->infos->getInfo(&*it);
+        if (ii.file != sourceFile) {
+          *of << "fl=" << ii.file << "\n";
+          sourceFile = ii.file;
+        }
+        *of << ii.assemblyLine << " " << ii.line << "\n";
+        istatsInstructions.push_back(ii.id);
+      }
+    }
+  }
+  *of << "data:\n";
+
+  istatsDeltaWriter = new IStatsDeltaWriter(
+      of, istatsInstructions.size() * istatsStatistics.size());
+}
+
+void StatsTracker::writeIStatsDelta() {
+  StatisticManager &sm = *theStatisticManager;
+  bool withStates = std::find(istatsStatistics.begin(), istatsStatistics.end(),
+                              &stats::states) != istatsStatistics.end();
+
+  // See writeIStats().
+  if (withStates)
+    updateStateStatistics(1);
+
+  istatsSnapshot.resize(istatsInstructions.size() * istatsStatistics.size());
+  std::vector<uint64_t>::iterator out = istatsSnapshot.begin();
+  for (std::vector<unsigned>::iterator it = istatsInstructions.begin(),
+         ie = istatsInstructions.end(); it != ie; ++it)
+    for (std::vector<Statistic*>::iterator sit = istatsStatistics.begin(),
+           sie = istatsStatistics.end(); sit != sie; ++sit)
+      *out++ = sm.getIndexedValue(**sit, *it);
+
+  if (withStates)
+    updateStateStatistics((uint64_t)-1);
+
+  istatsDeltaWriter->submit(elapsed(), istatsSnapshot);
+}
+
 void StatsTracker::writeIStats() {
   Module *m = executor.kmodule->module;
   uint64_t istatsMask = 0;
@@ -479,20 +745,7 @@ void StatsTracker::writeIStats() {
   StatisticManager &sm = *theStatisticManager;
   unsigned nStats = sm.getNumStatistics();
 
-  // Max is 13, sadly
-  istatsMask |= 1<<sm.getStatisticID("Queries");
-  istatsMask |= 1<<sm.getStatisticID("QueriesValid");
-  istatsMask |= 1<<sm.getStatisticID("QueriesInvalid");
-  istatsMask |= 1<<sm.getStatisticID("QueryTime");
-  istatsMask |= 1<<sm.getStatisticID("ResolveTime");
-  istatsMask |= 1<<sm.getStatisticID("Instructions");
-  istatsMask |= 1<<sm.getStatisticID("InstructionTimes");
-  istatsMask |= 1<<sm.getStatisticID("InstructionRealTimes");
-  istatsMask |= 1<<sm.getStatisticID("Forks");
-  istatsMask |= 1<<sm.getStatisticID("CoveredInstructions");
-  istatsMask |= 1<<sm.getStatisticID("UncoveredInstructions");
-  istatsMask |= 1<<sm.getStatisticID("States");
-  istatsMask |= 1<<sm.getStatisticID("MinDistToUncovered");
+  istatsMask = getIStatsMask();
 
   of << "positions: instr line\n";
 
@@ -795,12 +1048,40 @@ void StatsTracker::computeReachableUncovered() {
     } while (changed);
   }
 
+  // Only the distances of the functions with newly covered instructions
+  // and of their (transitive) callers can change, the distances of the
+  // other functions are left as they are.
+  std::vector<Function *> affected;
+  if (recomputeAllUncovered) {
+    for (Module::iterator fnIt = m->begin(), fn_ie = m->end(); 
+         fnIt != fn_ie; ++fnIt)
+      affected.push_back(&*fnIt);
+  } else {
+    std::set<Function *> seen(newlyCoveredFunctions);
+    affected.assign(seen.begin(), seen.end());
+    for (unsigned i = 0; i != affected.size(); ++i) {
+      std::vector<Instruction *> &callers = functionCallers[affected[i]];
+      for (std::vector<Instruction *>::iterator it = callers.begin(),
+             ie = callers.end(); it != ie; ++it) {
+        Function *caller = (*it)->getParent()->getParent();
+        if (seen.insert(caller).second)
+          affected.push_back(caller);
+      }
+    }
+  }
+  recomputeAllUncovered = false;
+  newlyCoveredFunctions.clear();
+
+  // Nothing changed, the distances of the stack frames are still valid.
+  if (affected.empty())
+    return;
+
   // compute minDistToUncovered, 0 is unreachable
   std::vector<Instruction *> instructions;
-  for (Module::iterator fnIt = m->begin(), fn_ie = m->end(); 
-       fnIt != fn_ie; ++fnIt) {
+  for (std::vector<Function *>::iterator fnIt = affected.begin(),
+         fn_ie = affected.end(); fnIt != fn_ie; ++fnIt) {
     // Not sure if I should bother to preorder here.
-    for (Function::iterator bbIt = fnIt->begin(), bb_ie = fnIt->end(); 
+    for (Function::iterator bbIt = (*fnIt)->begin(), bb_ie = (*fnIt)->end(); 
          bbIt != bb_ie; ++bbIt) {
       for (BasicBlock::iterator it = bbIt->begin(), ie = bbIt->end(); 
            it != ie; ++it) {
@@ -13,6 +13,8 @@
 #include "CallPathManager.h"
 
 #include <set>
+#include <string>
+#include <vector>
 
 namespace llvm {
   class BranchInst;
@@ -26,6 +28,8 @@ namespace klee {
   class Executor;  
   class InstructionInfoTable;
   class InterpreterHandler;
+  class IStatsDeltaWriter;
+  class Statistic;
   struct KInstruction;
   struct StackFrame;
 
@@ -37,6 +41,14 @@ namespace klee {
     std::string objectFilename;
 
     llvm::raw_fd_ostream *statsFile, *istatsFile;
+    /// Writes the periodic snapshots of the instruction level statistics
+    /// with --istats-delta.
+    IStatsDeltaWriter *istatsDeltaWriter;
+    /// The ids of the instructions and the statistics in the order of
+    /// the values of the istats snapshots.
+    std::vector<unsigned> istatsInstructions;
+    std::vector<Statistic*> istatsStatistics;
+    std::vector<uint64_t> istatsSnapshot;
     double startWallTime;
     
     unsigned numBranches;
@@ -46,14 +58,43 @@ namespace klee {
 
     bool updateMinDistToUncovered;
 
+    /// The functions with instructions that were covered since the last
+    /// computeReachableUncovered(), only their distances to uncovered
+    /// instructions and those of their callers need to be recomputed.
+    std::set<llvm::Function*> newlyCoveredFunctions;
+    /// Whether the next computeReachableUncovered() has to recompute the
+    /// distances of every function.
+    bool recomputeAllUncovered;
+
+    /// StatsValue - A column of run.stats and its current value.
+    struct StatsValue {
+      std::string name;
+      /// Whether the value is a time (in seconds) rather than a count.
+      bool isTime;
+      uint64_t count;
+      double time;
+
+      StatsValue(const std::string &_name, uint64_t _count)
+        : name(_name), isTime(false), count(_count), time(0) {}
+      StatsValue(const std::string &_name, double _time)
+        : name(_name), isTime(true), count(0), time(_time) {}
+    };
+
   public:
     static bool useStatistics();
 
   private:
     void updateStateStatistics(uint64_t addend);
+    /// Get the current values of the run.stats columns.
+    void getStatsLine(std::vector<StatsValue> &line);
     void writeStatsHeader();
     void writeStatsLine();
     void writeIStats();
+    /// Write the instruction level statistics, as a full run.istats or as
+    /// a snapshot to run.istats.delta.
+    void updateIStats();
+    void openIStatsDelta();
+    void writeIStatsDelta();
 
   public:
     StatsTracker(Executor &_executor, std::string _objectFilename,
@@ -83,6 +124,15 @@ namespace klee {
     double elapsed();
 
     void computeReachableUncovered();
+
+    /// Stop writing run.stats and run.istats. Used by exploration
+    /// workers, which share the output directory with worker 0.
+    void closeOutputFiles();
+
+    /// Recompute the full/partial branch counts from the indexed
+    /// branch statistics, e.g. after merging the statistics of
+    /// another exploration worker.
+    void recomputeBranchCoverage();
   };
 
   uint64_t computeMinDistToUncovered(const KInstruction *ki,
@@ -20,6 +20,8 @@
 using namespace llvm;
 using namespace klee;
 
+extern cl::opt<unsigned> AsyncBranchQueries;
+
 namespace {
   cl::list<Searcher::CoreSearchType>
   CoreSearch("search", cl::desc("Specify the search heuristic (default=random-path interleaved with nurs:covnew)"),
@@ -63,6 +65,9 @@ void klee::initializeSearchOptions() {
     if (UseMerge){
       CoreSearch.push_back(Searcher::NURS_CovNew);
       klee_warning("--use-merge enabled. Using NURS_CovNew as default searcher.");
+    } else if (AsyncBranchQueries) {
+      CoreSearch.push_back(Searcher::NURS_CovNew);
+      klee_warning("--async-branch-queries enabled. Using NURS_CovNew as default searcher.");
     } else {
       CoreSearch.push_back(Searcher::RandomPath);
       CoreSearch.push_back(Searcher::NURS_CovNew);
@@ -117,6 +122,13 @@ Searcher *klee::constructUserSearcher(Executor &executor) {
     }
   }
 
+  // Random path selection walks the process tree, so it would select
+  // states which are paused at a branch query.
+  if (AsyncBranchQueries &&
+      std::find(CoreSearch.begin(), CoreSearch.end(), Searcher::RandomPath) != CoreSearch.end()) {
+    klee_error("async-branch-queries currently does not support random-path, please use another search strategy");
+  }
+
   if (UseBatchingSearch) {
     searcher = new BatchingSearcher(searcher, BatchTime, BatchInstructions);
   }
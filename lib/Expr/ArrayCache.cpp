@@ -1,5 +1,7 @@
 #include "klee/util/ArrayCache.h"
 
+#include <algorithm>
+
 namespace klee {
 
 ArrayCache::~ArrayCache() {
@@ -44,4 +46,31 @@ ArrayCache::CreateArray(const std::string &_name, uint64_t _size,
     return array;
   }
 }
+
+const Array *ArrayCache::CreateSharedConstantArray(
+    const std::string &_name, uint64_t _size,
+    const ref<ConstantExpr> *constantValuesBegin,
+    const ref<ConstantExpr> *constantValuesEnd, Expr::Width _domain,
+    Expr::Width _range) {
+  unsigned hash = _size;
+  for (const ref<ConstantExpr> *it = constantValuesBegin;
+       it != constantValuesEnd; ++it)
+    hash = hash * Expr::MAGIC_HASH_CONSTANT + (*it)->hash();
+
+  typedef std::multimap<unsigned, const Array *>::iterator iterator;
+  std::pair<iterator, iterator> range = sharedConstantArrays.equal_range(hash);
+  for (iterator it = range.first; it != range.second; ++it) {
+    const Array *array = it->second;
+    if (array->size == _size && array->domain == _domain &&
+        array->range == _range &&
+        std::equal(array->constantValues.begin(), array->constantValues.end(),
+                   constantValuesBegin))
+      return array;
+  }
+
+  const Array *array = CreateArray(_name, _size, constantValuesBegin,
+                                   constantValuesEnd, _domain, _range);
+  sharedConstantArrays.insert(std::make_pair(hash, array));
+  return array;
+}
 }
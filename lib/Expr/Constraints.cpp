@@ -10,12 +10,14 @@
 #include "klee/Constraints.h"
 
 #include "klee/util/ExprPPrinter.h"
+#include "klee/util/ExprUtil.h"
 #include "klee/util/ExprVisitor.h"
 #include "klee/Internal/Module/KModule.h"
 
 #include "llvm/IR/Function.h"
 #include "llvm/Support/CommandLine.h"
 
+#include <algorithm>
 #include <map>
 
 using namespace klee;
@@ -85,6 +87,8 @@ bool ConstraintManager::rewriteConstraints(ExprVisitor &visitor) {
     if (e!=ce) {
       addConstraintInternal(e); // enable further reductions
       changed = true;
+      // the partition is rebuilt once the constraint has been added
+      partition = 0;
     } else {
       constraints.push_back(ce);
     }
@@ -165,4 +169,159 @@ void ConstraintManager::addConstraintInternal(ref<Expr> e) {
 void ConstraintManager::addConstraint(ref<Expr> e) {
   e = simplifyExpr(e);
   addConstraintInternal(e);
+
+  if (partition.isNull()) {
+    partition = new ConstraintPartition();
+  } else if (partition->size() == constraints.size()) {
+    return;
+  } else if (partition->refCount > 1) {
+    partition = new ConstraintPartition(*partition);
+  }
+  for (unsigned i = partition->size(), n = constraints.size(); i != n; ++i)
+    partition->addConstraint(constraints[i]);
+}
+
+bool ConstraintManager::getIndependentConstraints(
+    ref<Expr> e, std::vector< ref<Expr> > &result) const {
+  if (partition.isNull())
+    return false;
+  assert(partition->size() == constraints.size() && "stale partition");
+
+  std::vector<unsigned> indices;
+  partition->getRelated(e, indices);
+  for (std::vector<unsigned>::iterator it = indices.begin(),
+         ie = indices.end(); it != ie; ++it)
+    result.push_back(constraints[*it]);
+  return true;
+}
+
+bool ConstraintManager::getIndependentClusters(
+    std::vector< std::vector< ref<Expr> > > &result) const {
+  if (partition.isNull())
+    return false;
+  assert(partition->size() == constraints.size() && "stale partition");
+
+  std::map<unsigned, unsigned> clusters;
+  for (unsigned i = 0, e = constraints.size(); i != e; ++i) {
+    std::pair<std::map<unsigned, unsigned>::iterator, bool> res =
+      clusters.insert(std::make_pair(partition->getCluster(i),
+                                     (unsigned) result.size()));
+    if (res.second)
+      result.push_back(std::vector< ref<Expr> >());
+    result[res.first->second].push_back(constraints[i]);
+  }
+  return true;
+}
+
+/***/
+
+unsigned ConstraintPartition::createNode() {
+  unsigned node = parent.size();
+  parent.push_back(node);
+  rank.push_back(0);
+  members.push_back(std::vector<unsigned>());
+  return node;
+}
+
+void ConstraintPartition::merge(unsigned a, unsigned b) {
+  a = find(a);
+  b = find(b);
+  if (a == b)
+    return;
+  if (rank[a] < rank[b])
+    std::swap(a, b);
+  parent[b] = a;
+  if (rank[a] == rank[b])
+    ++rank[a];
+
+  // append the smaller list of constraints
+  std::vector<unsigned> &m = members[a], &o = members[b];
+  if (m.size() < o.size())
+    m.swap(o);
+  m.insert(m.end(), o.begin(), o.end());
+  std::vector<unsigned>().swap(o);
+}
+
+unsigned ConstraintPartition::getVariable(const Variable &v) {
+  std::map<Variable, unsigned>::iterator it = variables.lower_bound(v);
+  if (it != variables.end() && it->first == v)
+    return it->second;
+
+  unsigned node = createNode();
+  variables.insert(it, std::make_pair(v, node));
+  Variable whole(v.first, ~0U);
+  if (v.second != ~0U) {
+    std::map<Variable, unsigned>::iterator w = variables.find(whole);
+    if (w != variables.end())
+      merge(node, w->second);
+  } else {
+    // a read at a symbolic index may alias any element of the array, the
+    // whole array variable is the last one of the array
+    for (it = variables.lower_bound(Variable(v.first, 0));
+         it->first != whole; ++it)
+      merge(node, it->second);
+  }
+  return node;
+}
+
+void ConstraintPartition::addConstraint(ref<Expr> e) {
+  std::vector< ref<ReadExpr> > reads;
+  findReads(e, /* visitUpdates= */ true, reads);
+
+  unsigned node = createNode();
+  for (unsigned i = 0; i != reads.size(); ++i) {
+    ReadExpr *re = reads[i].get();
+    // Reads of a constant array don't alias.
+    if (re->updates.root->isConstantArray() && !re->updates.head)
+      continue;
+    unsigned index = ~0U;
+    if (ConstantExpr *CE = dyn_cast<ConstantExpr>(re->index))
+      index = (unsigned) CE->getZExtValue(32);
+    merge(node, getVariable(Variable(re->updates.root, index)));
+  }
+
+  unsigned index = constraintNodes.size();
+  constraintNodes.push_back(node);
+  members[find(node)].push_back(index);
+}
+
+void ConstraintPartition::getRoots(ref<Expr> e,
+                                   std::vector<unsigned> &roots) const {
+  std::vector< ref<ReadExpr> > reads;
+  findReads(e, /* visitUpdates= */ true, reads);
+
+  for (unsigned i = 0; i != reads.size(); ++i) {
+    ReadExpr *re = reads[i].get();
+    const Array *array = re->updates.root;
+    if (array->isConstantArray() && !re->updates.head)
+      continue;
+    Variable whole(array, ~0U);
+    if (ConstantExpr *CE = dyn_cast<ConstantExpr>(re->index)) {
+      std::map<Variable, unsigned>::const_iterator it =
+        variables.find(Variable(array, (unsigned) CE->getZExtValue(32)));
+      if (it != variables.end())
+        roots.push_back(find(it->second));
+      it = variables.find(whole);
+      if (it != variables.end())
+        roots.push_back(find(it->second));
+    } else {
+      for (std::map<Variable, unsigned>::const_iterator
+             it = variables.lower_bound(Variable(array, 0)),
+             ie = variables.end(); it != ie && it->first.first == array; ++it)
+        roots.push_back(find(it->second));
+    }
+  }
+
+  std::sort(roots.begin(), roots.end());
+  roots.erase(std::unique(roots.begin(), roots.end()), roots.end());
+}
+
+void ConstraintPartition::getRelated(ref<Expr> e,
+                                     std::vector<unsigned> &indices) const {
+  std::vector<unsigned> roots;
+  getRoots(e, roots);
+  for (std::vector<unsigned>::iterator it = roots.begin(), ie = roots.end();
+       it != ie; ++it)
+    indices.insert(indices.end(), members[*it].begin(), members[*it].end());
+  std::sort(indices.begin(), indices.end());
 }
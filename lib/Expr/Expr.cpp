@@ -19,6 +19,8 @@
 
 #include "klee/util/ExprPPrinter.h"
 
+#include "HashConsTable.h"
+
 #include <sstream>
 
 using namespace klee;
@@ -29,11 +31,72 @@ namespace {
   ConstArrayOpt("const-array-opt",
 	 cl::init(false),
 	 cl::desc("Enable various optimizations involving all-constant arrays."));
+
+  cl::opt<bool>
+  HashConsExprs("hash-cons-exprs",
+                cl::init(false),
+                cl::desc("Share a single node between structurally equal "
+                         "expressions and array updates (default=off)."));
 }
 
 /***/
 
+#ifdef KLEE_ATOMIC_REFCOUNT
+std::atomic<unsigned> Expr::count(0);
+#else
 unsigned Expr::count = 0;
+#endif
+
+static HashConsTable<Expr> &getExprTable() {
+  // Never freed, expressions may outlive any static table.
+  static HashConsTable<Expr> *table = new HashConsTable<Expr>();
+  return *table;
+}
+
+bool Expr::isHashConsing() {
+  return HashConsExprs;
+}
+
+Expr::~Expr() {
+  Expr::count--;
+  if (HashConsExprs)
+    getExprTable().erase(this);
+}
+
+ref<Expr> Expr::hashCons(const ref<Expr> &e) {
+  if (!HashConsExprs)
+    return e;
+
+  // The kids of a new expression are canonical already, so comparing
+  // them by address is enough to find a structurally equal node.
+  struct ShallowEqual {
+    bool operator()(const Expr *a, const Expr *b) const {
+      Kind k = a->getKind();
+      if (k != b->getKind())
+        return false;
+      if (k == Read) {
+        const ReadExpr *ra = static_cast<const ReadExpr*>(a);
+        const ReadExpr *rb = static_cast<const ReadExpr*>(b);
+        return ra->index.get() == rb->index.get() &&
+               ra->updates.root == rb->updates.root &&
+               ra->updates.head == rb->updates.head;
+      }
+      for (unsigned i = 0, n = a->getNumKids(); i != n; ++i)
+        if (a->getKid(i).get() != b->getKid(i).get())
+          return false;
+      return a->compareContents(*b) == 0;
+    }
+  };
+
+  Expr *canonical = getExprTable().findOrInsert(e.get(), ShallowEqual());
+  if (canonical == e.get())
+    return e;
+  // The table took a reference to the existing node for us, hand it over
+  // to the result.
+  ref<Expr> result(canonical);
+  --canonical->refCount;
+  return result;
+}
 
 ref<Expr> Expr::createTempRead(const Array *array, Expr::Width w) {
   UpdateList ul(array, 0);
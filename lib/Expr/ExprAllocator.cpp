@@ -0,0 +1,170 @@
+//===-- ExprAllocator.cpp -------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Expr.h"
+#include "klee/Internal/ADT/SlabAllocator.h"
+
+#include <new>
+#ifdef KLEE_ATOMIC_REFCOUNT
+#include <mutex>
+#endif
+
+using namespace klee;
+
+namespace {
+/// NodePool - Slab allocators for the expression and update nodes, one per
+/// size class of 16 bytes. Nodes are small, so the few larger ones are
+/// left to the system allocator.
+class NodePool {
+  enum { Granularity = 16, NumSizeClasses = 8 };
+
+  SlabAllocator *classes[NumSizeClasses];
+  /// Plain counters, statistics would also update the indexed and call
+  /// path values on every node.
+  uint64_t numAllocations, numFrees, numMallocs;
+#ifdef KLEE_ATOMIC_REFCOUNT
+  // Nodes may be freed by whichever thread drops the last reference.
+  mutable std::mutex lock;
+#endif
+
+public:
+  NodePool() : numAllocations(0), numFrees(0), numMallocs(0) {
+    for (unsigned i = 0; i != NumSizeClasses; ++i)
+      classes[i] = new SlabAllocator((i + 1) * Granularity);
+  }
+
+  void *allocate(size_t size) {
+#ifdef KLEE_ATOMIC_REFCOUNT
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    ++numAllocations;
+    if (size > NumSizeClasses * Granularity) {
+      ++numMallocs;
+      return ::operator new(size);
+    }
+
+    SlabAllocator *slab = classes[(size - 1) / Granularity];
+    size_t numSlabs = slab->getNumSlabs();
+    void *p = slab->allocate();
+    if (!p)
+      throw std::bad_alloc();
+    if (slab->getNumSlabs() != numSlabs)
+      ++numMallocs;
+    return p;
+  }
+
+  void deallocate(void *p, size_t size) {
+#ifdef KLEE_ATOMIC_REFCOUNT
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    ++numFrees;
+    if (size > NumSizeClasses * Granularity)
+      ::operator delete(p);
+    else
+      classes[(size - 1) / Granularity]->deallocate(p);
+  }
+
+  size_t getReservedSize() const {
+#ifdef KLEE_ATOMIC_REFCOUNT
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    size_t size = 0;
+    for (unsigned i = 0; i != NumSizeClasses; ++i)
+      size += classes[i]->getReservedSize();
+    return size;
+  }
+
+  size_t getUsedSize() const {
+#ifdef KLEE_ATOMIC_REFCOUNT
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    size_t size = 0;
+    for (unsigned i = 0; i != NumSizeClasses; ++i)
+      size += classes[i]->getUsedSize();
+    return size;
+  }
+
+  size_t releaseEmptySlabs() {
+#ifdef KLEE_ATOMIC_REFCOUNT
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    size_t size = 0;
+    for (unsigned i = 0; i != NumSizeClasses; ++i)
+      size += classes[i]->releaseEmptySlabs();
+    return size;
+  }
+
+  uint64_t getNumAllocations() const {
+#ifdef KLEE_ATOMIC_REFCOUNT
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    return numAllocations;
+  }
+  uint64_t getNumFrees() const {
+#ifdef KLEE_ATOMIC_REFCOUNT
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    return numFrees;
+  }
+  uint64_t getNumMallocs() const {
+#ifdef KLEE_ATOMIC_REFCOUNT
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    return numMallocs;
+  }
+};
+}
+
+static NodePool &getNodePool() {
+  // Never freed, expressions may outlive any static pool.
+  static NodePool *pool = new NodePool();
+  return *pool;
+}
+
+void *Expr::operator new(size_t size) {
+  return getNodePool().allocate(size);
+}
+
+void Expr::operator delete(void *p, size_t size) {
+  if (p)
+    getNodePool().deallocate(p, size);
+}
+
+size_t Expr::getPoolReservedSize() {
+  return getNodePool().getReservedSize();
+}
+
+size_t Expr::getPoolUsedSize() {
+  return getNodePool().getUsedSize();
+}
+
+size_t Expr::releasePoolMemory() {
+  return getNodePool().releaseEmptySlabs();
+}
+
+uint64_t Expr::getPoolAllocations() {
+  return getNodePool().getNumAllocations();
+}
+
+uint64_t Expr::getPoolFrees() {
+  return getNodePool().getNumFrees();
+}
+
+uint64_t Expr::getPoolMallocs() {
+  return getNodePool().getNumMallocs();
+}
+
+void *UpdateNode::operator new(size_t size) {
+  return getNodePool().allocate(size);
+}
+
+void UpdateNode::operator delete(void *p, size_t size) {
+  if (p)
+    getNodePool().deallocate(p, size);
+}
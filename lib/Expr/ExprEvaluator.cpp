@@ -11,22 +11,59 @@
 
 using namespace klee;
 
-ExprVisitor::Action ExprEvaluator::evalRead(const UpdateList &ul,
-                                            unsigned index) {
+// Reads of shorter update lists just walk them.
+static const unsigned MinIndexedUpdates = 16;
+
+const ExprEvaluator::UpdateIndex &
+ExprEvaluator::getUpdateIndex(const UpdateList &ul) {
+  std::map<const UpdateNode*, UpdateIndex>::iterator it =
+    updateIndices.find(ul.head);
+  if (it != updateIndices.end())
+    return it->second;
+
+  UpdateIndex &ui =
+    updateIndices.insert(std::make_pair(ul.head, UpdateIndex(ul))).first->second;
   for (const UpdateNode *un=ul.head; un; un=un->next) {
-    ref<Expr> ui = visit(un->index);
-    
-    if (ConstantExpr *CE = dyn_cast<ConstantExpr>(ui)) {
-      if (CE->getZExtValue() == index)
-        return Action::changeTo(visit(un->value));
+    ref<Expr> idx = visit(un->index);
+    if (ConstantExpr *CE = dyn_cast<ConstantExpr>(idx)) {
+      // Only the newest update of an index is visible.
+      ui.nodes.insert(std::make_pair(CE->getZExtValue(), un));
     } else {
-      // update index is unknown, so may or may not be index, we
-      // cannot guarantee value. we can rewrite to read at this
-      // version though (mostly for debugging).
-      
-      return Action::changeTo(ReadExpr::create(UpdateList(ul.root, un), 
-                                               ConstantExpr::alloc(index, 
+      ui.barrier = un;
+      break;
+    }
+  }
+  return ui;
+}
+
+ExprVisitor::Action ExprEvaluator::evalRead(const UpdateList &ul,
+                                            unsigned index) {
+  if (ul.getSize() >= MinIndexedUpdates) {
+    const UpdateIndex &ui = getUpdateIndex(ul);
+    std::map<uint64_t, const UpdateNode*>::const_iterator it =
+      ui.nodes.find(index);
+    if (it != ui.nodes.end())
+      return Action::changeTo(visit(it->second->value));
+    if (ui.barrier)
+      return Action::changeTo(ReadExpr::create(UpdateList(ul.root, ui.barrier),
+                                               ConstantExpr::alloc(index,
                                                                    ul.root->getDomain())));
+  } else {
+    for (const UpdateNode *un=ul.head; un; un=un->next) {
+      ref<Expr> ui = visit(un->index);
+
+      if (ConstantExpr *CE = dyn_cast<ConstantExpr>(ui)) {
+        if (CE->getZExtValue() == index)
+          return Action::changeTo(visit(un->value));
+      } else {
+        // update index is unknown, so may or may not be index, we
+        // cannot guarantee value. we can rewrite to read at this
+        // version though (mostly for debugging).
+
+        return Action::changeTo(ReadExpr::create(UpdateList(ul.root, un),
+                                                 ConstantExpr::alloc(index,
+                                                                     ul.root->getDomain())));
+      }
     }
   }
   
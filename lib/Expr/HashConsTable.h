@@ -0,0 +1,121 @@
+//===-- HashConsTable.h -----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_HASHCONSTABLE_H
+#define KLEE_HASHCONSTABLE_H
+
+#include <cassert>
+#include <vector>
+#ifdef KLEE_ATOMIC_REFCOUNT
+#include <mutex>
+#endif
+
+namespace klee {
+
+/// HashConsTable - An open addressing set of canonical nodes, used to
+/// hash-cons Expr and UpdateNode objects. The table does not own the
+/// nodes; a node must be erased before it is deleted.
+///
+/// With KLEE_ATOMIC_REFCOUNT the table is guarded by a mutex, and a node
+/// whose count already dropped to zero is never returned, since another
+/// thread is about to erase and delete it.
+template <class T> class HashConsTable {
+#ifdef KLEE_ATOMIC_REFCOUNT
+  std::mutex lock;
+#endif
+  std::vector<T *> slots;
+  /// Number of live nodes.
+  unsigned numEntries;
+  /// Number of live nodes plus tombstones.
+  unsigned numUsed;
+
+  static T *tombstone() { return reinterpret_cast<T *>(1); }
+
+  unsigned firstSlot(unsigned hash) const {
+    // The node hashes are xor-combined and not well distributed in the
+    // low bits.
+    return (hash * 2654435761U) & (slots.size() - 1);
+  }
+
+  void grow() {
+    std::vector<T *> old;
+    old.swap(slots);
+    unsigned size = old.empty() ? 1024 : old.size();
+    while (numEntries * 2 >= size)
+      size *= 2;
+    slots.assign(size, (T *)0);
+    numUsed = numEntries;
+    for (typename std::vector<T *>::iterator it = old.begin(), ie = old.end();
+         it != ie; ++it) {
+      if (*it && *it != tombstone()) {
+        unsigned i = firstSlot((*it)->hash());
+        while (slots[i])
+          i = (i + 1) & (slots.size() - 1);
+        slots[i] = *it;
+      }
+    }
+  }
+
+public:
+  HashConsTable() : numEntries(0), numUsed(0) {}
+
+  unsigned size() const { return numEntries; }
+
+  /// Return a node in the table that is equal to \a node according to
+  /// \a equal, or insert and return \a node if there is none. A reference
+  /// to an existing node is taken on behalf of the caller.
+  template <class Equal> T *findOrInsert(T *node, Equal equal) {
+#ifdef KLEE_ATOMIC_REFCOUNT
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    if ((numUsed + 1) * 4 >= slots.size() * 3)
+      grow();
+
+    unsigned hash = node->hash();
+    unsigned i = firstSlot(hash), insertAt = ~0U;
+    for (; slots[i]; i = (i + 1) & (slots.size() - 1)) {
+      T *other = slots[i];
+      if (other == tombstone()) {
+        if (insertAt == ~0U)
+          insertAt = i;
+      } else if (other->hash() == hash && equal(other, node) &&
+                 other->refCount.tryRetain()) {
+        return other;
+      }
+    }
+
+    if (insertAt == ~0U) {
+      insertAt = i;
+      ++numUsed;
+    }
+    slots[insertAt] = node;
+    ++numEntries;
+    return node;
+  }
+
+  /// Remove \a node from the table, if it is present.
+  void erase(const T *node) {
+#ifdef KLEE_ATOMIC_REFCOUNT
+    std::lock_guard<std::mutex> guard(lock);
+#endif
+    if (slots.empty())
+      return;
+    for (unsigned i = firstSlot(node->hash()); slots[i];
+         i = (i + 1) & (slots.size() - 1)) {
+      if (slots[i] == node) {
+        slots[i] = tombstone();
+        --numEntries;
+        return;
+      }
+    }
+  }
+};
+}
+
+#endif
@@ -9,17 +9,34 @@
 
 #include "klee/Expr.h"
 
+#include "HashConsTable.h"
+
 #include <cassert>
 
 using namespace klee;
 
 ///
 
+static HashConsTable<UpdateNode> &getUpdateNodeTable() {
+  // Never freed, update lists may outlive any static table.
+  static HashConsTable<UpdateNode> *table = new HashConsTable<UpdateNode>();
+  return *table;
+}
+
+namespace {
+  struct UpdateNodeEqual {
+    // The index and value expressions are canonical when hash-consing.
+    bool operator()(const UpdateNode *a, const UpdateNode *b) const {
+      return a->next == b->next && a->index.get() == b->index.get() &&
+             a->value.get() == b->value.get();
+    }
+  };
+}
+
 UpdateNode::UpdateNode(const UpdateNode *_next, 
                        const ref<Expr> &_index, 
                        const ref<Expr> &_value) 
-  : refCount(0),    
-    next(_next),
+  : next(_next),
     index(_index),
     value(_value) {
   // FIXME: What we need to check here instead is that _value is of the same width 
@@ -44,6 +61,8 @@ extern "C" void vc_DeleteExpr(void*);
 // non-recursively.
 UpdateNode::~UpdateNode() {
     assert(refCount == 0 && "Deleted UpdateNode when a reference is still held");
+    if (Expr::isHashConsing())
+      getUpdateNodeTable().erase(this);
 }
 
 int UpdateNode::compare(const UpdateNode &b) const {
@@ -53,9 +72,12 @@ int UpdateNode::compare(const UpdateNode &b) const {
 }
 
 unsigned UpdateNode::computeHash() {
-  hashValue = index->hash() ^ value->hash();
+  // Order sensitive, so that swapping the index and value or the order of
+  // two writes changes the hash.
+  unsigned res = index->hash() * Expr::MAGIC_HASH_CONSTANT + value->hash();
   if (next)
-    hashValue ^= next->hash();
+    res = res * Expr::MAGIC_HASH_CONSTANT + next->hash();
+  hashValue = res;
   return hashValue;
 }
 
@@ -151,8 +173,25 @@ void UpdateList::extend(const ref<Expr> &index, const ref<Expr> &value) {
     assert(root->getRange() == value->getWidth());
   }
 
+  const UpdateNode *n = new UpdateNode(head, index, value);
+  if (Expr::isHashConsing()) {
+    UpdateNode *canonical = getUpdateNodeTable().findOrInsert(
+        const_cast<UpdateNode *>(n), UpdateNodeEqual());
+    if (canonical != n) {
+      // The shared node holds its own reference to the current head and
+      // the table took a reference to the shared node for us.
+      if (head) --head->refCount;
+      delete n;
+      if (head) --head->refCount;
+      head = canonical;
+      return;
+    }
+  }
+
+  // The new node holds a reference to the current head, so dropping
+  // ours never frees it.
   if (head) --head->refCount;
-  head = new UpdateNode(head, index, value);
+  head = n;
   ++head->refCount;
 }
 
@@ -24,6 +24,8 @@
 
 #include "llvm/Support/CommandLine.h"
 
+#include <list>
+
 using namespace klee;
 using namespace llvm;
 
@@ -44,6 +46,11 @@ namespace {
   cl::opt<bool>
   CexCacheExperimental("cex-cache-exp", cl::init(false));
 
+  cl::opt<unsigned>
+  CexCacheMaxEntries("cex-cache-max-entries",
+                     cl::desc("Maximum number of entries of the counterexample cache, the least recently used ones are evicted first, 0 for no limit (default=262144)"),
+                     cl::init(262144));
+
 }
 
 ///
@@ -51,21 +58,51 @@ namespace {
 typedef std::set< ref<Expr> > KeyType;
 
 struct AssignmentLessThan {
-  bool operator()(const Assignment *a, const Assignment *b) {
+  bool operator()(const Assignment *a, const Assignment *b) const {
     return a->bindings < b->bindings;
   }
 };
 
+/// ExprSignature - One of 64 bits for an expression, used to prune
+/// superset searches of the cache.
+struct ExprSignature {
+  uint64_t operator()(const ref<Expr> &e) const {
+    return 1ULL << (e->hash() % 64);
+  }
+};
+
+struct CacheEntry {
+  KeyType key;
+  Assignment *binding;
+
+  CacheEntry(const KeyType &_key, Assignment *_binding)
+    : key(_key), binding(_binding) {}
+};
+
+typedef std::list<CacheEntry> entries_ty;
 
 class CexCachingSolver : public SolverImpl {
-  typedef std::set<Assignment*, AssignmentLessThan> assignmentsTable_ty;
+  /// The memoized assignments and the number of cache entries which refer
+  /// to them.
+  typedef std::map<Assignment*, unsigned, AssignmentLessThan>
+    assignmentsTable_ty;
 
   Solver *solver;
   
-  MapOfSets<ref<Expr>, Assignment*> cache;
+  MapOfSets<ref<Expr>, entries_ty::iterator, ExprSignature> cache;
+  /// The cache entries, most recently used first.
+  entries_ty entries;
   // memo table
   assignmentsTable_ty assignmentsTable;
 
+  Assignment *useEntry(entries_ty::iterator it) {
+    entries.splice(entries.begin(), entries, it);
+    return it->binding;
+  }
+
+  void insertEntry(const KeyType &key, Assignment *binding);
+  void evictEntry();
+
   bool searchForAssignment(KeyType &key, 
                            Assignment *&result);
   
@@ -97,11 +134,11 @@ public:
 ///
 
 struct NullAssignment {
-  bool operator()(Assignment *a) const { return !a; }
+  bool operator()(entries_ty::iterator e) const { return !e->binding; }
 };
 
 struct NonNullAssignment {
-  bool operator()(Assignment *a) const { return a!=0; }
+  bool operator()(entries_ty::iterator e) const { return e->binding!=0; }
 };
 
 struct NullOrSatisfyingAssignment {
@@ -109,11 +146,57 @@ struct NullOrSatisfyingAssignment {
   
   NullOrSatisfyingAssignment(KeyType &_key) : key(_key) {}
 
-  bool operator()(Assignment *a) const { 
+  bool operator()(entries_ty::iterator e) const { 
+    Assignment *a = e->binding;
     return !a || a->satisfies(key.begin(), key.end()); 
   }
 };
 
+/// Estimate the memory used for an assignment.
+static uint64_t getAssignmentSize(const Assignment *a) {
+  uint64_t size = sizeof(Assignment);
+  for (Assignment::bindings_ty::const_iterator it = a->bindings.begin(),
+         ie = a->bindings.end(); it != ie; ++it)
+    size += 64 + it->second.size();
+  return size;
+}
+
+/// Estimate the memory used for a cache entry, not counting its assignment
+/// or the nodes of the cache which it shares with other entries.
+static uint64_t getEntrySize(const KeyType &key) {
+  return sizeof(CacheEntry) + 2 * 48 * key.size();
+}
+
+void CexCachingSolver::insertEntry(const KeyType &key, Assignment *binding) {
+  assert(!cache.lookup(key) && "cache entry already exists");
+  entries.push_front(CacheEntry(key, binding));
+  cache.insert(key, entries.begin());
+  ++stats::queryCexCacheEntries;
+  stats::queryCexCacheBytes += getEntrySize(key);
+
+  while (CexCacheMaxEntries && entries.size() > CexCacheMaxEntries)
+    evictEntry();
+}
+
+/// evictEntry - Remove the least recently used entry, its assignment is
+/// freed when no other entry refers to it.
+void CexCachingSolver::evictEntry() {
+  CacheEntry &e = entries.back();
+  cache.remove(e.key);
+  if (e.binding) {
+    assignmentsTable_ty::iterator it = assignmentsTable.find(e.binding);
+    assert(it != assignmentsTable.end() && "unknown assignment");
+    if (--it->second == 0) {
+      stats::queryCexCacheFreedBytes += getAssignmentSize(e.binding);
+      assignmentsTable.erase(it);
+      delete e.binding;
+    }
+  }
+  ++stats::queryCexCacheEvictions;
+  stats::queryCexCacheFreedBytes += getEntrySize(e.key);
+  entries.pop_back();
+}
+
 /// searchForAssignment - Look for a cached solution for a query.
 ///
 /// \param key - The query to look up.
@@ -122,16 +205,16 @@ struct NullOrSatisfyingAssignment {
 /// unsatisfiable query).
 /// \return - True if a cached result was found.
 bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
-  Assignment * const *lookup = cache.lookup(key);
+  entries_ty::iterator *lookup = cache.lookup(key);
   if (lookup) {
-    result = *lookup;
+    result = useEntry(*lookup);
     return true;
   }
 
   if (CexCacheTryAll) {
     // Look for a satisfying assignment for a superset, which is trivially an
     // assignment for any subset.
-    Assignment **lookup = 0;
+    entries_ty::iterator *lookup = 0;
     if (CexCacheSuperSet)
       lookup = cache.findSuperset(key, NonNullAssignment());
 
@@ -141,7 +224,7 @@ bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
 
     // If either lookup succeeded, then we have a cached solution.
     if (lookup) {
-      result = *lookup;
+      result = useEntry(*lookup);
       return true;
     }
 
@@ -149,7 +232,7 @@ bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
     // of them satisfies the query.
     for (assignmentsTable_ty::iterator it = assignmentsTable.begin(), 
            ie = assignmentsTable.end(); it != ie; ++it) {
-      Assignment *a = *it;
+      Assignment *a = it->first;
       if (a->satisfies(key.begin(), key.end())) {
         result = a;
         return true;
@@ -160,7 +243,7 @@ bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
 
     // Look for a satisfying assignment for a superset, which is trivially an
     // assignment for any subset.
-    Assignment **lookup = 0;
+    entries_ty::iterator *lookup = 0;
     if (CexCacheSuperSet)
       lookup = cache.findSuperset(key, NonNullAssignment());
 
@@ -174,7 +257,7 @@ bool CexCachingSolver::searchForAssignment(KeyType &key, Assignment *&result) {
 
     // If either lookup succeeded, then we have a cached solution.
     if (lookup) {
-      result = *lookup;
+      result = useEntry(*lookup);
       return true;
     }
   }
@@ -233,11 +316,14 @@ bool CexCachingSolver::getAssignment(const Query& query, Assignment *&result) {
 
     // Memoize the result.
     std::pair<assignmentsTable_ty::iterator, bool>
-      res = assignmentsTable.insert(binding);
-    if (!res.second) {
+      res = assignmentsTable.insert(std::make_pair(binding, 0u));
+    if (res.second) {
+      stats::queryCexCacheBytes += getAssignmentSize(binding);
+    } else {
       delete binding;
-      binding = *res.first;
+      binding = res.first->first;
     }
+    ++res.first->second;
     
     if (DebugCexCacheCheckBinding)
       if (!binding->satisfies(key.begin(), key.end())) {
@@ -250,7 +336,7 @@ bool CexCachingSolver::getAssignment(const Query& query, Assignment *&result) {
   }
   
   result = binding;
-  cache.insert(key, binding);
+  insertEntry(key, binding);
 
   return true;
 }
@@ -262,7 +348,7 @@ CexCachingSolver::~CexCachingSolver() {
   delete solver;
   for (assignmentsTable_ty::iterator it = assignmentsTable.begin(), 
          ie = assignmentsTable.end(); it != ie; ++it)
-    delete *it;
+    delete it->first;
 }
 
 bool CexCachingSolver::computeValidity(const Query& query,
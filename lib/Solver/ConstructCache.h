@@ -0,0 +1,91 @@
+//===-- ConstructCache.h ----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// The cache of translated expressions shared by the solver builders.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_CONSTRUCTCACHE_H
+#define KLEE_CONSTRUCTCACHE_H
+
+#include "klee/SolverStats.h"
+#include "klee/util/ExprHashMap.h"
+
+#include <list>
+
+namespace klee {
+
+/// ConstructCache - A map from expressions to their translation by a
+/// solver builder. The cache survives across queries and holds at most
+/// a given number of entries, evicting the least recently used ones.
+template <class Handle> class ConstructCache {
+  typedef std::list<ref<Expr> > LRUList;
+
+  struct Entry {
+    Handle handle;
+    int width;
+    LRUList::iterator position;
+  };
+
+  ExprHashMap<Entry> entries;
+  /// The cached expressions, most recently used first.
+  LRUList lru;
+  /// The maximum number of entries, 0 if the cache only lives as long as
+  /// the caller does not clear it.
+  unsigned capacity;
+
+public:
+  explicit ConstructCache(unsigned _capacity) : capacity(_capacity) {}
+  ~ConstructCache() { clear(); }
+
+  /// Whether entries are kept after the construction of a query.
+  bool isPersistent() const { return capacity != 0; }
+  unsigned size() const { return entries.size(); }
+
+  /// Find the translation of \a e, returns false if it is not cached.
+  bool lookup(const ref<Expr> &e, Handle &handle, int *width_out) {
+    typename ExprHashMap<Entry>::iterator it = entries.find(e);
+    if (it == entries.end()) {
+      ++stats::queryConstructCacheMisses;
+      return false;
+    }
+    ++stats::queryConstructCacheHits;
+    lru.splice(lru.begin(), lru, it->second.position);
+    handle = it->second.handle;
+    if (width_out)
+      *width_out = it->second.width;
+    return true;
+  }
+
+  void insert(const ref<Expr> &e, const Handle &handle, int width) {
+    lru.push_front(e);
+    Entry entry = { handle, width, lru.begin() };
+    if (!entries.insert(std::make_pair(e, entry)).second) {
+      lru.pop_front();
+      return;
+    }
+    ++stats::queryConstructCacheEntries;
+    if (capacity && entries.size() > capacity) {
+      entries.erase(lru.back());
+      lru.pop_back();
+      ++stats::queryConstructCacheEvictions;
+      stats::queryConstructCacheEntries += (uint64_t) -1;
+    }
+  }
+
+  void clear() {
+    stats::queryConstructCacheEntries += -(uint64_t) entries.size();
+    entries.clear();
+    lru.clear();
+  }
+};
+
+}
+
+#endif
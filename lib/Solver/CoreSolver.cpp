@@ -42,11 +42,55 @@ Solver *createCoreSolver(CoreSolverType cst) {
   case Z3_SOLVER:
 #ifdef ENABLE_Z3
     klee_message("Using Z3 solver backend");
+    // Forking Z3 is opt-in, a process per query loses the translations
+    // cached across queries, and the incremental solvers their state.
+    if (UseForkedZ3Solver && !Z3Solver::isIncremental())
+      return createForkedSolver(new Z3Solver());
     return new Z3Solver();
 #else
     klee_message("Not compiled with Z3 support");
     return NULL;
 #endif
+  case PORTFOLIO_SOLVER: {
+    std::vector<CoreSolverType> types(PortfolioSolvers.begin(),
+                                      PortfolioSolvers.end());
+    if (types.empty()) {
+#ifdef ENABLE_STP
+      types.push_back(STP_SOLVER);
+#endif
+#ifdef ENABLE_Z3
+      types.push_back(Z3_SOLVER);
+#endif
+#ifdef ENABLE_METASMT
+      types.push_back(METASMT_SOLVER);
+#endif
+    }
+    std::vector<std::pair<CoreSolverType, Solver *> > backends;
+    for (unsigned i = 0; i < types.size(); ++i) {
+      Solver *s;
+#ifdef ENABLE_STP
+      // Every query already runs in its own process.
+      if (types[i] == STP_SOLVER)
+        s = new STPSolver(/*useForkedSTP=*/false, CoreSolverOptimizeDivides);
+      else
+#endif
+#ifdef ENABLE_Z3
+      if (types[i] == Z3_SOLVER)
+        s = new Z3Solver();
+      else
+#endif
+        s = createCoreSolver(types[i]);
+      if (s)
+        backends.push_back(std::make_pair(types[i], s));
+    }
+    if (backends.empty()) {
+      klee_message("No solver backends for the portfolio solver");
+      return NULL;
+    }
+    klee_message("Using portfolio solver with %u backends",
+                 (unsigned)backends.size());
+    return createPortfolioSolver(backends);
+  }
   case NO_SOLVER:
     klee_message("Invalid solver");
     return NULL;
@@ -0,0 +1,54 @@
+//===-- ForkUtil.h ----------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Helpers for passing answers from forked solver processes over pipes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_FORKUTIL_H
+#define KLEE_FORKUTIL_H
+
+#include <errno.h>
+#include <unistd.h>
+
+namespace klee {
+
+/// Write all of \a size bytes, giving up if the reader went away.
+inline bool writeAll(int fd, const void *buf, size_t size) {
+  const char *p = (const char*) buf;
+  while (size) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+/// Read all of \a size bytes, giving up if the writer went away.
+inline bool readAll(int fd, void *buf, size_t size) {
+  char *p = (char*) buf;
+  while (size) {
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+}
+
+#endif
@@ -0,0 +1,241 @@
+//===-- ForkedSolver.cpp --------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A solver which runs every query of another solver in a forked process,
+// like the forked STP solver does, but for any backend. A backend which
+// crashes only takes the child with it. The solver timeout is enforced by
+// killing the child, the backend itself runs without one, so that a query
+// is stopped at the same time whether or not the backend honours
+// timeouts.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Solver.h"
+
+#include "ForkUtil.h"
+
+#include "klee/Constraints.h"
+#include "klee/SolverImpl.h"
+#include "klee/SolverStats.h"
+#include "klee/TimerStatIncrementer.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+#include "klee/Internal/System/Time.h"
+#include "klee/util/Assignment.h"
+#include "klee/util/ExprUtil.h"
+
+#include "llvm/Support/Errno.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+class ForkedSolverImpl : public SolverImpl {
+  Solver *solver;
+  double timeout;
+  SolverRunStatus runStatusCode;
+
+  /// Answer written by the forked process.
+  struct Answer {
+    int32_t status;
+    uint8_t success;
+    uint8_t hasSolution;
+  };
+
+  void runChild(int fd, const Query &query,
+                const std::vector<const Array*> *objects);
+  bool run(const Query &, const std::vector<const Array*> *objects,
+           std::vector< std::vector<unsigned char> > *values,
+           bool &hasSolution);
+
+public:
+  ForkedSolverImpl(Solver *_solver)
+    : solver(_solver), timeout(0.0),
+      runStatusCode(SOLVER_RUN_STATUS_FAILURE) {}
+  ~ForkedSolverImpl() { delete solver; }
+
+  bool computeTruth(const Query&, bool &isValid);
+  bool computeValue(const Query&, ref<Expr> &result);
+  bool computeInitialValues(const Query&,
+                            const std::vector<const Array*> &objects,
+                            std::vector< std::vector<unsigned char> > &values,
+                            bool &hasSolution);
+  SolverRunStatus getOperationStatusCode() { return runStatusCode; }
+  char *getConstraintLog(const Query &query) {
+    return solver->impl->getConstraintLog(query);
+  }
+  void setCoreSolverTimeout(double _timeout) { timeout = _timeout; }
+};
+
+}
+
+void ForkedSolverImpl::runChild(int fd, const Query &query,
+                                const std::vector<const Array*> *objects) {
+  std::vector< std::vector<unsigned char> > values;
+  Answer answer;
+  bool hasSolution = false;
+  if (objects) {
+    answer.success = solver->impl->computeInitialValues(query, *objects,
+                                                        values, hasSolution);
+  } else {
+    bool isValid = false;
+    answer.success = solver->impl->computeTruth(query, isValid);
+    hasSolution = !isValid;
+  }
+  answer.status = solver->impl->getOperationStatusCode();
+  answer.hasSolution = hasSolution;
+
+  bool ok = writeAll(fd, &answer, sizeof(answer));
+  if (ok && answer.success && hasSolution)
+    for (unsigned i = 0; ok && i < values.size(); ++i)
+      if (!values[i].empty())
+        ok = writeAll(fd, &values[i][0], values[i].size());
+  _exit(ok ? 0 : 1);
+}
+
+bool ForkedSolverImpl::run(const Query &query,
+                           const std::vector<const Array*> *objects,
+                           std::vector< std::vector<unsigned char> > *values,
+                           bool &hasSolution) {
+  // The statistics of the child are lost with it, so they are counted
+  // here.
+  TimerStatIncrementer t(stats::queryTime);
+  ++stats::queries;
+  if (objects)
+    ++stats::queryCounterexamples;
+
+  int p[2];
+  if (pipe(p) < 0) {
+    klee_warning("forked solver: pipe failed - %s",
+                 llvm::sys::StrError(errno).c_str());
+    runStatusCode = SOLVER_RUN_STATUS_FORK_FAILED;
+    return false;
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(p[0]);
+    runChild(p[1], query, objects);
+  }
+  close(p[1]);
+  if (pid < 0) {
+    klee_warning("forked solver: fork failed - %s",
+                 llvm::sys::StrError(errno).c_str());
+    close(p[0]);
+    runStatusCode = SOLVER_RUN_STATUS_FORK_FAILED;
+    return false;
+  }
+
+  double deadline = timeout ? util::getWallTime() + timeout : 0;
+  struct pollfd pfd = { p[0], POLLIN, 0 };
+  bool ready = false, timedOut = false;
+  while (!ready) {
+    int waitMs = -1;
+    if (deadline) {
+      double left = deadline - util::getWallTime();
+      if (left <= 0) {
+        timedOut = true;
+        break;
+      }
+      waitMs = (int) (left * 1000) + 1;
+    }
+    int res = poll(&pfd, 1, waitMs);
+    if (res < 0 && errno != EINTR)
+      break;
+    ready = res > 0;
+  }
+
+  Answer answer;
+  bool ok = ready && readAll(p[0], &answer, sizeof(answer));
+  if (ok && answer.success && answer.hasSolution && objects) {
+    values->clear();
+    for (unsigned i = 0; ok && i < objects->size(); ++i) {
+      values->push_back(std::vector<unsigned char>((*objects)[i]->size));
+      if (!values->back().empty())
+        ok = readAll(p[0], &values->back()[0], values->back().size());
+    }
+  }
+  close(p[0]);
+
+  if (!ok)
+    kill(pid, SIGKILL);
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+    ;
+
+  if (!ok) {
+    if (timedOut) {
+      klee_warning("forked solver: query timed out, killed the solver");
+      runStatusCode = SOLVER_RUN_STATUS_TIMEOUT;
+    } else if (WIFSIGNALED(status) && WTERMSIG(status) != SIGKILL) {
+      klee_warning("forked solver: solver died with signal %d",
+                   WTERMSIG(status));
+      runStatusCode = SOLVER_RUN_STATUS_INTERRUPTED;
+    } else {
+      klee_warning("forked solver: solver exited without an answer");
+      runStatusCode = SOLVER_RUN_STATUS_UNEXPECTED_EXIT_CODE;
+    }
+    return false;
+  }
+
+  runStatusCode = (SolverRunStatus) answer.status;
+  if (!answer.success)
+    return false;
+
+  hasSolution = answer.hasSolution;
+  if (hasSolution)
+    ++stats::queriesInvalid;
+  else
+    ++stats::queriesValid;
+  return true;
+}
+
+bool ForkedSolverImpl::computeTruth(const Query &query, bool &isValid) {
+  bool hasSolution;
+  if (!run(query, 0, 0, hasSolution))
+    return false;
+  isValid = !hasSolution;
+  return true;
+}
+
+bool ForkedSolverImpl::computeValue(const Query &query, ref<Expr> &result) {
+  std::vector<const Array*> objects;
+  std::vector< std::vector<unsigned char> > values;
+  bool hasSolution;
+
+  // Find the object used in the expression, and compute an assignment
+  // for them.
+  findSymbolicObjects(query.expr, objects);
+  if (!computeInitialValues(query.withFalse(), objects, values, hasSolution))
+    return false;
+  assert(hasSolution && "state has invalid constraint set");
+
+  // Evaluate the expression with the computed assignment.
+  Assignment a(objects, values);
+  result = a.evaluate(query.expr);
+
+  return true;
+}
+
+bool ForkedSolverImpl::computeInitialValues(
+    const Query &query, const std::vector<const Array*> &objects,
+    std::vector< std::vector<unsigned char> > &values, bool &hasSolution) {
+  return run(query, &objects, &values, hasSolution);
+}
+
+Solver *klee::createForkedSolver(Solver *s) {
+  return new Solver(new ForkedSolverImpl(s));
+}
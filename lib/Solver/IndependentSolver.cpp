@@ -10,23 +10,37 @@
 #define DEBUG_TYPE "independent-solver"
 #include "klee/Solver.h"
 
+#include "ForkUtil.h"
+
 #include "klee/Expr.h"
 #include "klee/Constraints.h"
 #include "klee/SolverImpl.h"
 #include "klee/Internal/Support/Debug.h"
+#include "klee/Internal/Support/ErrorHandling.h"
 
 #include "klee/util/ExprUtil.h"
 #include "klee/util/Assignment.h"
 
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Errno.h"
 #include "llvm/Support/raw_ostream.h"
 #include <map>
 #include <vector>
 #include <ostream>
 #include <list>
 
+#include <sys/wait.h>
+
 using namespace klee;
 using namespace llvm;
 
+namespace {
+  cl::opt<unsigned>
+  IndependentSolverJobs("independent-solver-jobs",
+                        cl::desc("Solve the independent factors of a query for a counterexample in up to this many forked processes at once (default=1, i.e. in order in this process)"),
+                        cl::init(1));
+}
+
 template<class T>
 class DenseSet {
   typedef std::set<T> set_ty;
@@ -267,7 +281,36 @@ getAllIndependentConstraintsSets(const Query &query) {
   if (CE) {
     assert(CE && CE->isFalse() && "the expr should always be false and "
                                   "therefore not included in factors");
-  } else {
+  }
+
+  // Constraint sets built up by the executor maintain their independent
+  // clusters already, only the negated query can join some of them.
+  std::vector< std::vector< ref<Expr> > > clusters;
+  if (query.constraints.getIndependentClusters(clusters)) {
+    for (std::vector< std::vector< ref<Expr> > >::iterator
+           it = clusters.begin(), ie = clusters.end(); it != ie; ++it) {
+      IndependentElementSet current(it->front());
+      for (unsigned i = 1; i < it->size(); ++i)
+        current.add(IndependentElementSet((*it)[i]));
+      factors->push_back(current);
+    }
+    if (!CE) {
+      IndependentElementSet current(Expr::createIsZero(query.expr));
+      for (std::list<IndependentElementSet>::iterator it = factors->begin();
+           it != factors->end();) {
+        if (it->intersects(current)) {
+          current.add(*it);
+          it = factors->erase(it);
+        } else {
+          ++it;
+        }
+      }
+      factors->push_front(current);
+    }
+    return factors;
+  }
+
+  if (!CE) {
     ref<Expr> neg = Expr::createIsZero(query.expr);
     factors->push_back(IndependentElementSet(neg));
   }
@@ -320,9 +363,13 @@ getAllIndependentConstraintsSets(const Query &query) {
   return factors;
 }
 
-static 
-IndependentElementSet getIndependentConstraints(const Query& query,
-                                                std::vector< ref<Expr> > &result) {
+static void getIndependentConstraints(const Query& query,
+                                      std::vector< ref<Expr> > &result) {
+  // Constraint sets built up by the executor maintain their partition into
+  // independent clusters, only the clusters of the query are needed.
+  if (query.constraints.getIndependentConstraints(query.expr, result))
+    return;
+
   IndependentElementSet eltsClosure(query.expr);
   std::vector< std::pair<ref<Expr>, IndependentElementSet> > worklist;
 
@@ -364,9 +411,6 @@ IndependentElementSet getIndependentConstraints(const Query& query,
     }
     errs() << "elts closure: " << eltsClosure << "\n";
  );
-
-
-  return eltsClosure;
 }
 
 
@@ -390,10 +434,27 @@ void calculateArrayReferences(const IndependentElementSet & ie,
   }
 }
 
+/// The answer of the underlying solver for one independent factor.
+struct FactorSolution {
+  bool success;
+  bool hasSolution;
+  std::vector< std::vector<unsigned char> > values;
+
+  FactorSolution() : success(false), hasSolution(false) {}
+};
+
 class IndependentSolver : public SolverImpl {
 private:
   Solver *solver;
 
+  void solveFactor(const IndependentElementSet &factor,
+                   const std::vector<const Array*> &arrays,
+                   FactorSolution &solution);
+  void solveFactorsForked(
+      const std::vector<IndependentElementSet*> &factors,
+      const std::vector< std::vector<const Array*> > &arrays,
+      std::vector<FactorSolution> &solutions);
+
 public:
   IndependentSolver(Solver *_solver) 
     : solver(_solver) {}
@@ -414,8 +475,7 @@ public:
 bool IndependentSolver::computeValidity(const Query& query,
                                         Solver::Validity &result) {
   std::vector< ref<Expr> > required;
-  IndependentElementSet eltsClosure =
-    getIndependentConstraints(query, required);
+  getIndependentConstraints(query, required);
   ConstraintManager tmp(required);
   return solver->impl->computeValidity(Query(tmp, query.expr), 
                                        result);
@@ -423,8 +483,7 @@ bool IndependentSolver::computeValidity(const Query& query,
 
 bool IndependentSolver::computeTruth(const Query& query, bool &isValid) {
   std::vector< ref<Expr> > required;
-  IndependentElementSet eltsClosure = 
-    getIndependentConstraints(query, required);
+  getIndependentConstraints(query, required);
   ConstraintManager tmp(required);
   return solver->impl->computeTruth(Query(tmp, query.expr), 
                                     isValid);
@@ -432,8 +491,7 @@ bool IndependentSolver::computeTruth(const Query& query, bool &isValid) {
 
 bool IndependentSolver::computeValue(const Query& query, ref<Expr> &result) {
   std::vector< ref<Expr> > required;
-  IndependentElementSet eltsClosure = 
-    getIndependentConstraints(query, required);
+  getIndependentConstraints(query, required);
   ConstraintManager tmp(required);
   return solver->impl->computeValue(Query(tmp, query.expr), result);
 }
@@ -472,6 +530,108 @@ bool assertCreatedPointEvaluatesToTrue(const Query &query,
   return cast<ConstantExpr>(q)->isTrue();
 }
 
+void IndependentSolver::solveFactor(const IndependentElementSet &factor,
+                                    const std::vector<const Array*> &arrays,
+                                    FactorSolution &solution) {
+  ConstraintManager tmp(factor.exprs);
+  solution.success =
+    solver->impl->computeInitialValues(Query(tmp, ConstantExpr::alloc(0, Expr::Bool)),
+                                       arrays, solution.values,
+                                       solution.hasSolution);
+}
+
+// The underlying solvers are not thread safe (and neither are expressions),
+// so the factors are solved in forked processes. Process j solves factors
+// j, j + jobs, ... and writes the answers to its pipe in that order, which
+// is the order they are read in. A process stops at the first factor
+// without a solution, as does the reader. The solver caches and statistics
+// of the processes are lost.
+void IndependentSolver::solveFactorsForked(
+    const std::vector<IndependentElementSet*> &factors,
+    const std::vector< std::vector<const Array*> > &arrays,
+    std::vector<FactorSolution> &solutions) {
+  unsigned jobs = std::min((unsigned) factors.size(),
+                           (unsigned) IndependentSolverJobs);
+  std::vector<pid_t> pids;
+  std::vector<int> fds;
+
+  fflush(stdout);
+  fflush(stderr);
+  for (unsigned j = 0; j < jobs; ++j) {
+    int p[2];
+    if (pipe(p) < 0) {
+      klee_warning("independent solver: pipe failed - %s",
+                   llvm::sys::StrError(errno).c_str());
+      break;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(p[0]);
+      for (unsigned k = 0; k < fds.size(); ++k)
+        close(fds[k]);
+      bool ok = true;
+      for (unsigned i = j; ok && i < factors.size(); i += jobs) {
+        FactorSolution solution;
+        solveFactor(*factors[i], arrays[i], solution);
+        uint8_t answer[2] = { solution.success, solution.hasSolution };
+        ok = writeAll(p[1], answer, sizeof(answer));
+        if (!solution.success || !solution.hasSolution)
+          break;
+        for (unsigned k = 0; ok && k < solution.values.size(); ++k)
+          if (!solution.values[k].empty())
+            ok = writeAll(p[1], &solution.values[k][0],
+                          solution.values[k].size());
+      }
+      _exit(ok ? 0 : 1);
+    }
+    close(p[1]);
+    if (pid < 0) {
+      klee_warning("independent solver: fork failed - %s",
+                   llvm::sys::StrError(errno).c_str());
+      close(p[0]);
+      break;
+    }
+    pids.push_back(pid);
+    fds.push_back(p[0]);
+  }
+
+  for (unsigned i = 0; i < factors.size(); ++i) {
+    FactorSolution &solution = solutions[i];
+    unsigned j = i % jobs;
+    if (j >= fds.size()) {
+      // This job could not be started.
+      solveFactor(*factors[i], arrays[i], solution);
+    } else {
+      uint8_t answer[2];
+      if (readAll(fds[j], answer, sizeof(answer))) {
+        solution.success = answer[0];
+        solution.hasSolution = answer[1];
+      }
+      if (solution.success && solution.hasSolution) {
+        for (unsigned k = 0; solution.success && k < arrays[i].size(); ++k) {
+          solution.values.push_back(
+              std::vector<unsigned char>(arrays[i][k]->size));
+          if (!solution.values.back().empty())
+            solution.success = readAll(fds[j], &solution.values.back()[0],
+                                       solution.values.back().size());
+        }
+      }
+    }
+    if (!solution.success || !solution.hasSolution)
+      break;
+  }
+
+  // Processes still solving stop at their next answer, killing them could
+  // leave a forked core solver behind.
+  for (unsigned j = 0; j < fds.size(); ++j)
+    close(fds[j]);
+  for (unsigned j = 0; j < pids.size(); ++j) {
+    int status;
+    while (waitpid(pids[j], &status, 0) < 0 && errno == EINTR)
+      ;
+  }
+}
+
 bool IndependentSolver::computeInitialValues(const Query& query,
                                              const std::vector<const Array*> &objects,
                                              std::vector< std::vector<unsigned char> > &values,
@@ -484,8 +644,8 @@ bool IndependentSolver::computeInitialValues(const Query& query,
   // to remember to manually call delete
   std::list<IndependentElementSet> *factors = getAllIndependentConstraintsSets(query);
 
-  //Used to rearrange all of the answers into the correct order
-  std::map<const Array*, std::vector<unsigned char> > retMap;
+  std::vector<IndependentElementSet*> solved;
+  std::vector< std::vector<const Array*> > arrays;
   for (std::list<IndependentElementSet>::iterator it = factors->begin();
        it != factors->end(); ++it) {
     std::vector<const Array*> arraysInFactor;
@@ -495,14 +655,32 @@ bool IndependentSolver::computeInitialValues(const Query& query,
     if (arraysInFactor.size() == 0){
       continue;
     }
-    ConstraintManager tmp(it->exprs);
-    std::vector<std::vector<unsigned char> > tempValues;
-    if (!solver->impl->computeInitialValues(Query(tmp, ConstantExpr::alloc(0, Expr::Bool)),
-                                            arraysInFactor, tempValues, hasSolution)){
+    solved.push_back(&*it);
+    arrays.push_back(arraysInFactor);
+  }
+
+  std::vector<FactorSolution> solutions(solved.size());
+  if (IndependentSolverJobs > 1 && solved.size() > 1) {
+    solveFactorsForked(solved, arrays, solutions);
+  } else {
+    for (unsigned i = 0; i < solved.size(); ++i) {
+      solveFactor(*solved[i], arrays[i], solutions[i]);
+      if (!solutions[i].success || !solutions[i].hasSolution)
+        break;
+    }
+  }
+
+  //Used to rearrange all of the answers into the correct order
+  std::map<const Array*, std::vector<unsigned char> > retMap;
+  for (unsigned f = 0; f < solved.size(); ++f) {
+    const std::vector<const Array*> &arraysInFactor = arrays[f];
+    std::vector<std::vector<unsigned char> > &tempValues = solutions[f].values;
+    if (!solutions[f].success){
       values.clear();
       delete factors;
       return false;
-    } else if (!hasSolution){
+    } else if (!solutions[f].hasSolution){
+      hasSolution = false;
       values.clear();
       delete factors;
       return true;
@@ -517,7 +695,7 @@ bool IndependentSolver::computeInitialValues(const Query& query,
           std::vector<unsigned char> * tempPtr = &retMap[arraysInFactor[i]];
           assert(tempPtr->size() == tempValues[i].size() &&
                  "we're talking about the same array here");
-          ::DenseSet<unsigned> * ds = &(it->elements[arraysInFactor[i]]);
+          ::DenseSet<unsigned> * ds = &(solved[f]->elements[arraysInFactor[i]]);
           for (std::set<unsigned>::iterator it2 = ds->begin(); it2 != ds->end(); it2++){
             unsigned index = * it2;
             (* tempPtr)[index] = tempValues[i][index];
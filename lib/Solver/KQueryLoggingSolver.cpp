@@ -50,8 +50,9 @@ private :
     }
 
 public:
-    KQueryLoggingSolver(Solver *_solver, std::string path, int queryTimeToLog)
-    : QueryLoggingSolver(_solver, path, "#", queryTimeToLog),
+    KQueryLoggingSolver(Solver *_solver, std::string path, int queryTimeToLog,
+                        unsigned slowestToKeep = 0)
+    : QueryLoggingSolver(_solver, path, "#", queryTimeToLog, slowestToKeep),
     printer(ExprPPrinter::create(logBuffer)) {
     }
 
@@ -67,3 +68,9 @@ Solver *klee::createKQueryLoggingSolver(Solver *_solver, std::string path,
   return new Solver(new KQueryLoggingSolver(_solver, path, minQueryTimeToLog));
 }
 
+Solver *klee::createSlowestKQueryLoggingSolver(Solver *_solver,
+                                               std::string path,
+                                               unsigned count) {
+  return new Solver(new KQueryLoggingSolver(_solver, path, 0, count));
+}
+
@@ -0,0 +1,74 @@
+//===-- LatencyHistogramSolver.cpp ----------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+#include "klee/Solver.h"
+#include "klee/SolverImpl.h"
+#include "klee/SolverStats.h"
+#include "klee/Internal/System/Time.h"
+
+using namespace klee;
+
+namespace {
+
+class LatencyHistogramSolver : public SolverImpl {
+  Solver *solver;
+  QueryLatencyHistogram &histogram;
+
+  /// Record the time from the construction to the destruction.
+  class Recorder {
+    QueryLatencyHistogram &histogram;
+    double start;
+
+  public:
+    Recorder(QueryLatencyHistogram &_histogram)
+        : histogram(_histogram), start(util::getWallTime()) {}
+    ~Recorder() { histogram.record(util::getWallTime() - start); }
+  };
+
+public:
+  LatencyHistogramSolver(Solver *_solver, QueryLatencyHistogram &_histogram)
+      : solver(_solver), histogram(_histogram) {}
+  ~LatencyHistogramSolver() { delete solver; }
+
+  bool computeValidity(const Query &query, Solver::Validity &result) {
+    Recorder r(histogram);
+    return solver->impl->computeValidity(query, result);
+  }
+  bool computeTruth(const Query &query, bool &isValid) {
+    Recorder r(histogram);
+    return solver->impl->computeTruth(query, isValid);
+  }
+  bool computeValue(const Query &query, ref<Expr> &result) {
+    Recorder r(histogram);
+    return solver->impl->computeValue(query, result);
+  }
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    Recorder r(histogram);
+    return solver->impl->computeInitialValues(query, objects, values,
+                                              hasSolution);
+  }
+  SolverRunStatus getOperationStatusCode() {
+    return solver->impl->getOperationStatusCode();
+  }
+  char *getConstraintLog(const Query &query) {
+    return solver->impl->getConstraintLog(query);
+  }
+  void setCoreSolverTimeout(double timeout) {
+    solver->impl->setCoreSolverTimeout(timeout);
+  }
+};
+
+}
+
+Solver *klee::createLatencyHistogramSolver(Solver *s,
+                                           QueryLatencyHistogram &histogram) {
+  return new Solver(new LatencyHistogramSolver(s, histogram));
+}
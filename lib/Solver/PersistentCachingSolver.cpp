@@ -0,0 +1,581 @@
+//===-- PersistentCachingSolver.cpp - On-disk query cache -----------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A query cache which is kept in a file and shared between KLEE runs and
+// between KLEE processes running at the same time.
+//
+// Queries are stored in a canonical serialization. Arrays are numbered in
+// the order in which they are first reached and shared expressions are
+// written once, so the serialization does not depend on array names or on
+// the addresses of expressions and is stable across runs. Records are
+// indexed by a 128 bit hash of the serialization, and a hit is only used
+// if the serialization stored with the record matches the query, so a hash
+// collision costs a solver call and not a wrong answer. The file is an
+// append-only sequence of checksummed records which is memory mapped for
+// reading. Appending takes an exclusive lock on the file and scanning for
+// records written by other processes a shared one, looking up records that
+// have already been scanned needs no locking at all.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Solver.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/SolverImpl.h"
+#include "klee/SolverStats.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+
+#include "llvm/Support/Errno.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+struct QueryKey {
+  uint64_t hi, lo;
+
+  QueryKey() : hi(0x9e3779b97f4a7c15ULL), lo(0xcbf29ce484222325ULL) {}
+
+  void add(uint64_t v) {
+    hi = (hi ^ v) * 0x100000001b3ULL;
+    hi ^= hi >> 29;
+    lo = (lo + v) * 0xc6a4a7935bd1e995ULL;
+    lo ^= lo >> 47;
+  }
+
+  void add(const QueryKey &k) {
+    add(k.hi);
+    add(k.lo);
+  }
+
+  bool operator<(const QueryKey &b) const {
+    return hi < b.hi || (hi == b.hi && lo < b.lo);
+  }
+};
+
+/// QuerySerializer - Write a name independent serialization of the
+/// expressions of a query. A serializer must be used for a single query
+/// only, as the arrays are numbered in the order in which they are reached.
+class QuerySerializer {
+  enum Tag { NewTag, RefTag };
+
+  std::string out;
+  std::map<const Expr*, uint64_t> exprIds;
+  std::map<const UpdateNode*, uint64_t> updateIds;
+  std::map<const Array*, uint64_t> arrayIds;
+
+  void write(uint64_t v) {
+    for (; v >= 0x80; v >>= 7)
+      out += (char) (0x80 | (v & 0x7f));
+    out += (char) v;
+  }
+
+  /// Write a reference to an object that has already been written, or
+  /// return false if it has not.
+  template <class T>
+  bool writeRef(std::map<const T*, uint64_t> &ids, const T *p) {
+    typename std::map<const T*, uint64_t>::iterator it = ids.find(p);
+    if (it == ids.end())
+      return false;
+    write(RefTag);
+    write(it->second);
+    return true;
+  }
+
+public:
+  const std::string &str() const { return out; }
+
+  void add(uint64_t v) { write(v); }
+
+  void add(const Array *array) {
+    if (writeRef(arrayIds, array))
+      return;
+    write(NewTag);
+    write(array->size);
+    write(array->domain);
+    write(array->range);
+    write(array->constantValues.size());
+    for (unsigned i = 0; i < array->constantValues.size(); ++i)
+      add(array->constantValues[i]);
+    uint64_t id = arrayIds.size();
+    arrayIds[array] = id;
+  }
+
+  /// Update lists can be very long, so they are walked iteratively: the
+  /// nodes that have not been written yet are written oldest first, after
+  /// a reference to the newest node that has been.
+  void add(const UpdateNode *head) {
+    std::vector<const UpdateNode*> fresh;
+    const UpdateNode *un = head;
+    for (; un && !updateIds.count(un); un = un->next)
+      fresh.push_back(un);
+    write(fresh.size());
+    if (!un)
+      write(NewTag);
+    else
+      writeRef(updateIds, un);
+    for (std::vector<const UpdateNode*>::reverse_iterator
+           it = fresh.rbegin(), ie = fresh.rend(); it != ie; ++it) {
+      add((*it)->index);
+      add((*it)->value);
+      uint64_t id = updateIds.size();
+      updateIds[*it] = id;
+    }
+  }
+
+  void add(const ref<Expr> &e) {
+    if (writeRef(exprIds, e.get()))
+      return;
+    write(NewTag);
+    write(e->getKind());
+    write(e->getWidth());
+    if (const ConstantExpr *ce = dyn_cast<ConstantExpr>(e)) {
+      const llvm::APInt &value = ce->getAPValue();
+      for (unsigned i = 0; i < value.getNumWords(); ++i)
+        write(value.getRawData()[i]);
+    } else if (const ReadExpr *re = dyn_cast<ReadExpr>(e)) {
+      add(re->updates.root);
+      add(re->updates.head);
+      add(re->index);
+    } else {
+      if (const ExtractExpr *ee = dyn_cast<ExtractExpr>(e))
+        write(ee->offset);
+      for (unsigned i = 0; i < e->getNumKids(); ++i)
+        add(e->getKid(i));
+    }
+    uint64_t id = exprIds.size();
+    exprIds[e.get()] = id;
+  }
+};
+
+enum RecordKind { ValidityRecord = 1, TruthRecord, InitialValuesRecord };
+
+const char fileMagic[8] = { 'K', 'L', 'E', 'E', 'Q', 'C', '0', '2' };
+const uint32_t recordMagic = 0x4b514352;
+
+struct RecordHeader {
+  uint32_t magic;
+  uint32_t payloadSize;
+  QueryKey key;
+  uint64_t checksum;
+};
+
+uint64_t computeChecksum(const QueryKey &key, const char *payload,
+                         uint32_t size) {
+  QueryKey k;
+  k.add(key);
+  k.add(size);
+  for (uint32_t i = 0; i < size; ++i)
+    k.add((unsigned char) payload[i]);
+  return k.hi ^ k.lo;
+}
+
+/// QueryCacheFile - The file holding the cached results. Records with the
+/// same key may appear several times when processes race to insert the
+/// same query, the last one wins.
+class QueryCacheFile {
+  int fd;
+  const char *mapping;
+  uint64_t mappedSize;
+  /// End of the last valid record that was scanned.
+  uint64_t scannedEnd;
+  std::map<QueryKey, uint64_t> index;
+
+  bool remap(uint64_t size);
+  void scan(uint64_t size);
+  void refresh();
+
+public:
+  QueryCacheFile() : fd(-1), mapping(0), mappedSize(0), scannedEnd(0) {}
+  ~QueryCacheFile();
+
+  bool open(const std::string &path);
+  bool lookup(const QueryKey &key, std::string &payload);
+  void insert(const QueryKey &key, const std::string &payload);
+};
+
+QueryCacheFile::~QueryCacheFile() {
+  if (mapping)
+    munmap((void*) mapping, mappedSize);
+  if (fd >= 0)
+    close(fd);
+}
+
+bool QueryCacheFile::open(const std::string &path) {
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    klee_warning("unable to open query cache \"%s\": %s", path.c_str(),
+                 llvm::sys::StrError(errno).c_str());
+    return false;
+  }
+
+  flock(fd, LOCK_EX);
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0;
+  if (ok && st.st_size == 0) {
+    ok = write(fd, fileMagic, sizeof(fileMagic)) == sizeof(fileMagic);
+  } else if (ok) {
+    char magic[sizeof(fileMagic)];
+    ok = pread(fd, magic, sizeof(magic), 0) == sizeof(magic) &&
+         memcmp(magic, fileMagic, sizeof(magic)) == 0;
+  }
+  flock(fd, LOCK_UN);
+
+  if (!ok) {
+    klee_warning("\"%s\" is not a query cache, not using it", path.c_str());
+    close(fd);
+    fd = -1;
+    return false;
+  }
+  scannedEnd = sizeof(fileMagic);
+  refresh();
+  return true;
+}
+
+bool QueryCacheFile::remap(uint64_t size) {
+  if (size <= mappedSize)
+    return true;
+  void *m = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (m == MAP_FAILED)
+    return false;
+  if (mapping)
+    munmap((void*) mapping, mappedSize);
+  mapping = (const char*) m;
+  mappedSize = size;
+  return true;
+}
+
+/// Index the records between scannedEnd and size. Must be called with a
+/// lock held, so that the file is not truncated while it is read.
+void QueryCacheFile::scan(uint64_t size) {
+  if (size <= scannedEnd || !remap(size))
+    return;
+
+  while (scannedEnd + sizeof(RecordHeader) <= size) {
+    RecordHeader header;
+    memcpy(&header, mapping + scannedEnd, sizeof(header));
+    uint64_t end = scannedEnd + sizeof(header) + header.payloadSize;
+    // Stop at a record that is still being written or was torn by a
+    // crashing process.
+    if (header.magic != recordMagic || end > size ||
+        header.checksum != computeChecksum(header.key,
+                                           mapping + scannedEnd +
+                                           sizeof(header),
+                                           header.payloadSize))
+      break;
+    index[header.key] = scannedEnd;
+    scannedEnd = end;
+  }
+}
+
+void QueryCacheFile::refresh() {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (uint64_t) st.st_size <= scannedEnd)
+    return;
+  flock(fd, LOCK_SH);
+  if (fstat(fd, &st) == 0)
+    scan(st.st_size);
+  flock(fd, LOCK_UN);
+}
+
+bool QueryCacheFile::lookup(const QueryKey &key, std::string &payload) {
+  if (fd < 0)
+    return false;
+  std::map<QueryKey, uint64_t>::iterator it = index.find(key);
+  if (it == index.end()) {
+    // Maybe another process has solved it in the meantime.
+    refresh();
+    it = index.find(key);
+    if (it == index.end())
+      return false;
+  }
+
+  RecordHeader header;
+  memcpy(&header, mapping + it->second, sizeof(header));
+  payload.assign(mapping + it->second + sizeof(header), header.payloadSize);
+  return true;
+}
+
+void QueryCacheFile::insert(const QueryKey &key, const std::string &payload) {
+  if (fd < 0)
+    return;
+  RecordHeader header;
+  header.magic = recordMagic;
+  header.payloadSize = payload.size();
+  header.key = key;
+  header.checksum = computeChecksum(key, payload.data(), payload.size());
+  std::string record((const char*) &header, sizeof(header));
+  record += payload;
+
+  flock(fd, LOCK_EX);
+  struct stat st;
+  if (fstat(fd, &st) == 0) {
+    scan(st.st_size);
+    // Everything after the last valid record was left behind by a process
+    // that died while appending, as no one else can be appending now.
+    if ((uint64_t) st.st_size > scannedEnd &&
+        ftruncate(fd, scannedEnd) != 0) {
+      flock(fd, LOCK_UN);
+      return;
+    }
+    if (pwrite(fd, record.data(), record.size(), scannedEnd) ==
+        (ssize_t) record.size()) {
+      if (remap(scannedEnd + record.size())) {
+        index[key] = scannedEnd;
+        scannedEnd += record.size();
+      }
+    } else if (ftruncate(fd, scannedEnd) != 0) {
+      klee_warning_once(0, "unable to write to the query cache: %s",
+                        llvm::sys::StrError(errno).c_str());
+    }
+  }
+  flock(fd, LOCK_UN);
+}
+
+class PersistentCachingSolver : public SolverImpl {
+private:
+  Solver *solver;
+  QueryCacheFile file;
+  /// True if the last query was answered from the cache.
+  bool lastQueryHit;
+  /// The status of the last query if it was answered from the cache.
+  SolverRunStatus hitStatus;
+
+  static std::string serialize(const Query &query,
+                               const std::vector<const Array*> *objects = 0);
+  static QueryKey getKey(RecordKind kind, const std::string &serialized);
+  bool lookup(RecordKind kind, const std::string &serialized,
+              std::string &result);
+  void insert(RecordKind kind, const std::string &serialized,
+              const std::string &result);
+  void setHit(SolverRunStatus status) {
+    ++stats::queryPersistentCacheHits;
+    lastQueryHit = true;
+    hitStatus = status;
+  }
+  void setMiss() {
+    ++stats::queryPersistentCacheMisses;
+    lastQueryHit = false;
+  }
+
+public:
+  PersistentCachingSolver(Solver *s, const std::string &path)
+    : solver(s), lastQueryHit(false),
+      hitStatus(SOLVER_RUN_STATUS_FAILURE) {
+    if (file.open(path))
+      klee_message("Using query cache \"%s\"", path.c_str());
+  }
+  ~PersistentCachingSolver() { delete solver; }
+
+  bool computeValidity(const Query&, Solver::Validity &result);
+  bool computeTruth(const Query&, bool &isValid);
+  bool computeValue(const Query& query, ref<Expr> &result) {
+    lastQueryHit = false;
+    return solver->impl->computeValue(query, result);
+  }
+  bool computeInitialValues(const Query& query,
+                            const std::vector<const Array*> &objects,
+                            std::vector< std::vector<unsigned char> > &values,
+                            bool &hasSolution);
+  SolverRunStatus getOperationStatusCode();
+  char *getConstraintLog(const Query&);
+  void setCoreSolverTimeout(double timeout);
+};
+
+}
+
+std::string
+PersistentCachingSolver::serialize(const Query &query,
+                                   const std::vector<const Array*> *objects) {
+  QuerySerializer serializer;
+  serializer.add(query.constraints.size());
+  for (ConstraintManager::const_iterator it = query.constraints.begin(),
+         ie = query.constraints.end(); it != ie; ++it)
+    serializer.add(*it);
+  serializer.add(query.expr);
+  if (objects) {
+    serializer.add(objects->size());
+    for (unsigned i = 0; i < objects->size(); ++i)
+      serializer.add((*objects)[i]);
+  }
+  return serializer.str();
+}
+
+QueryKey PersistentCachingSolver::getKey(RecordKind kind,
+                                         const std::string &serialized) {
+  QueryKey key;
+  key.add(kind);
+  key.add(serialized.size());
+  for (size_t i = 0; i < serialized.size(); i += sizeof(uint64_t)) {
+    uint64_t word = 0;
+    memcpy(&word, serialized.data() + i,
+           std::min(sizeof(word), serialized.size() - i));
+    key.add(word);
+  }
+  return key;
+}
+
+// Payload: the record kind, the size of the serialized query, the
+// serialized query and then the result.
+bool PersistentCachingSolver::lookup(RecordKind kind,
+                                     const std::string &serialized,
+                                     std::string &result) {
+  std::string payload;
+  uint32_t size;
+  size_t start = 1 + sizeof(size);
+  if (!file.lookup(getKey(kind, serialized), payload) ||
+      payload.size() < start || payload[0] != (char) kind)
+    return false;
+  memcpy(&size, payload.data() + 1, sizeof(size));
+  if (size != serialized.size() || payload.size() < start + size ||
+      payload.compare(start, size, serialized) != 0)
+    return false;
+  result.assign(payload, start + size, std::string::npos);
+  return true;
+}
+
+void PersistentCachingSolver::insert(RecordKind kind,
+                                     const std::string &serialized,
+                                     const std::string &result) {
+  uint32_t size = serialized.size();
+  std::string payload(1, (char) kind);
+  payload.append((const char*) &size, sizeof(size));
+  payload += serialized;
+  payload += result;
+  file.insert(getKey(kind, serialized), payload);
+}
+
+static SolverImpl::SolverRunStatus getValidityStatus(Solver::Validity v) {
+  // The same as the last truth query of SolverImpl::computeValidity.
+  return v == Solver::Unknown ? SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE
+                              : SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE;
+}
+
+static SolverImpl::SolverRunStatus getTruthStatus(bool isValid) {
+  return isValid ? SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE
+                 : SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE;
+}
+
+bool PersistentCachingSolver::computeValidity(const Query &query,
+                                              Solver::Validity &result) {
+  std::string serialized = serialize(query), cached;
+  if (lookup(ValidityRecord, serialized, cached) && cached.size() == 1) {
+    result = (Solver::Validity) (signed char) cached[0];
+    setHit(getValidityStatus(result));
+    return true;
+  }
+
+  setMiss();
+  if (!solver->impl->computeValidity(query, result))
+    return false;
+  insert(ValidityRecord, serialized, std::string(1, (char) result));
+  return true;
+}
+
+bool PersistentCachingSolver::computeTruth(const Query &query,
+                                           bool &isValid) {
+  std::string serialized = serialize(query), cached;
+  if (lookup(ValidityRecord, serialized, cached) && cached.size() == 1) {
+    isValid = (Solver::Validity) (signed char) cached[0] == Solver::True;
+  } else if (lookup(TruthRecord, serialized, cached) && cached.size() == 1) {
+    isValid = cached[0];
+  } else {
+    setMiss();
+    if (!solver->impl->computeTruth(query, isValid))
+      return false;
+    insert(TruthRecord, serialized, std::string(1, (char) isValid));
+    return true;
+  }
+
+  setHit(getTruthStatus(isValid));
+  return true;
+}
+
+bool PersistentCachingSolver::computeInitialValues(
+    const Query &query, const std::vector<const Array*> &objects,
+    std::vector< std::vector<unsigned char> > &values, bool &hasSolution) {
+  std::string serialized = serialize(query, &objects), cached;
+  if (lookup(InitialValuesRecord, serialized, cached) && !cached.empty()) {
+    // Result: hasSolution, then the size and the bytes of every object.
+    std::vector< std::vector<unsigned char> > cachedValues;
+    bool valid = true;
+    size_t pos = 1;
+    for (unsigned i = 0; valid && cached[0] && i < objects.size(); ++i) {
+      uint32_t size;
+      valid = pos + sizeof(size) <= cached.size();
+      if (!valid)
+        break;
+      memcpy(&size, cached.data() + pos, sizeof(size));
+      pos += sizeof(size);
+      valid = size == objects[i]->size && pos + size <= cached.size();
+      if (valid)
+        cachedValues.push_back(std::vector<unsigned char>(
+            cached.begin() + pos, cached.begin() + pos + size));
+      pos += size;
+    }
+    if (valid) {
+      hasSolution = cached[0];
+      if (hasSolution)
+        values.swap(cachedValues);
+      setHit(hasSolution ? SOLVER_RUN_STATUS_SUCCESS_SOLVABLE
+                         : SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE);
+      return true;
+    }
+  }
+
+  setMiss();
+  if (!solver->impl->computeInitialValues(query, objects, values,
+                                          hasSolution))
+    return false;
+
+  std::string result(1, (char) hasSolution);
+  if (hasSolution) {
+    for (unsigned i = 0; i < values.size(); ++i) {
+      uint32_t size = values[i].size();
+      result.append((const char*) &size, sizeof(size));
+      result.append(values[i].begin(), values[i].end());
+    }
+  }
+  insert(InitialValuesRecord, serialized, result);
+  return true;
+}
+
+SolverImpl::SolverRunStatus PersistentCachingSolver::getOperationStatusCode() {
+  if (lastQueryHit)
+    return hitStatus;
+  return solver->impl->getOperationStatusCode();
+}
+
+char *PersistentCachingSolver::getConstraintLog(const Query &query) {
+  return solver->impl->getConstraintLog(query);
+}
+
+void PersistentCachingSolver::setCoreSolverTimeout(double timeout) {
+  solver->impl->setCoreSolverTimeout(timeout);
+}
+
+///
+
+Solver *klee::createPersistentCachingSolver(Solver *s,
+                                            const std::string &path) {
+  return new Solver(new PersistentCachingSolver(s, path));
+}
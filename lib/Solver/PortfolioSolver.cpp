@@ -0,0 +1,299 @@
+//===-- PortfolioSolver.cpp -----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A core solver which races several backends against each other. Every
+// query is solved by all backends at the same time, each in its own forked
+// process, and the first answer wins. The backends are not thread safe
+// (and neither are expressions), so like the forked STP solver this uses
+// processes rather than threads; losing processes are simply killed.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Solver.h"
+
+#include "ForkUtil.h"
+
+#include "klee/Constraints.h"
+#include "klee/SolverImpl.h"
+#include "klee/SolverStats.h"
+#include "klee/Statistic.h"
+#include "klee/TimerStatIncrementer.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+#include "klee/Internal/System/Time.h"
+#include "klee/util/Assignment.h"
+#include "klee/util/ExprUtil.h"
+
+#include "llvm/Support/Errno.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+class PortfolioSolverImpl : public SolverImpl {
+  struct Backend {
+    Solver *solver;
+    Statistic *wins;
+  };
+  std::vector<Backend> backends;
+  double timeout;
+  SolverRunStatus runStatusCode;
+
+  /// Answer written by a backend process.
+  struct Answer {
+    int32_t status;
+    uint8_t success;
+    uint8_t hasSolution;
+  };
+
+  void runBackend(Backend &b, int fd, const Query &query,
+                  const std::vector<const Array*> *objects);
+  bool race(const Query &, const std::vector<const Array*> *objects,
+            std::vector< std::vector<unsigned char> > *values,
+            bool &hasSolution);
+
+public:
+  PortfolioSolverImpl(const std::vector<std::pair<CoreSolverType,
+                                                  Solver*> > &solvers);
+  ~PortfolioSolverImpl();
+
+  bool computeTruth(const Query&, bool &isValid);
+  bool computeValue(const Query&, ref<Expr> &result);
+  bool computeInitialValues(const Query&,
+                            const std::vector<const Array*> &objects,
+                            std::vector< std::vector<unsigned char> > &values,
+                            bool &hasSolution);
+  SolverRunStatus getOperationStatusCode() { return runStatusCode; }
+  char *getConstraintLog(const Query &query) {
+    return backends[0].solver->impl->getConstraintLog(query);
+  }
+  void setCoreSolverTimeout(double _timeout) {
+    timeout = _timeout;
+    for (unsigned i = 0; i < backends.size(); ++i)
+      backends[i].solver->impl->setCoreSolverTimeout(timeout);
+  }
+};
+
+}
+
+PortfolioSolverImpl::PortfolioSolverImpl(
+    const std::vector<std::pair<CoreSolverType, Solver*> > &solvers)
+  : timeout(0.0), runStatusCode(SOLVER_RUN_STATUS_FAILURE) {
+  for (unsigned i = 0; i < solvers.size(); ++i) {
+    Backend b;
+    b.solver = solvers[i].second;
+    switch (solvers[i].first) {
+    case STP_SOLVER:
+      b.wins = &stats::portfolioWinsSTP;
+      break;
+    case METASMT_SOLVER:
+      b.wins = &stats::portfolioWinsMetaSMT;
+      break;
+    case Z3_SOLVER:
+      b.wins = &stats::portfolioWinsZ3;
+      break;
+    default:
+      assert(0 && "invalid portfolio backend");
+    }
+    backends.push_back(b);
+  }
+  assert(!backends.empty() && "portfolio without backends");
+}
+
+PortfolioSolverImpl::~PortfolioSolverImpl() {
+  for (unsigned i = 0; i < backends.size(); ++i)
+    delete backends[i].solver;
+}
+
+void PortfolioSolverImpl::runBackend(Backend &b, int fd, const Query &query,
+                                     const std::vector<const Array*> *objects) {
+  std::vector< std::vector<unsigned char> > values;
+  Answer answer;
+  bool hasSolution = false;
+  if (objects) {
+    answer.success = b.solver->impl->computeInitialValues(query, *objects,
+                                                          values,
+                                                          hasSolution);
+  } else {
+    bool isValid = false;
+    answer.success = b.solver->impl->computeTruth(query, isValid);
+    hasSolution = !isValid;
+  }
+  answer.status = b.solver->impl->getOperationStatusCode();
+  answer.hasSolution = hasSolution;
+
+  bool ok = writeAll(fd, &answer, sizeof(answer));
+  if (ok && answer.success && hasSolution)
+    for (unsigned i = 0; ok && i < values.size(); ++i)
+      ok = writeAll(fd, &values[i][0], values[i].size());
+  _exit(ok ? 0 : 1);
+}
+
+bool PortfolioSolverImpl::race(const Query &query,
+                               const std::vector<const Array*> *objects,
+                               std::vector< std::vector<unsigned char> > *values,
+                               bool &hasSolution) {
+  TimerStatIncrementer t(stats::queryTime);
+  ++stats::queries;
+  if (objects)
+    ++stats::queryCounterexamples;
+
+  std::vector<pid_t> pids(backends.size(), -1);
+  std::vector<struct pollfd> fds;
+  std::vector<unsigned> fdBackend;
+
+  fflush(stdout);
+  fflush(stderr);
+  for (unsigned i = 0; i < backends.size(); ++i) {
+    int p[2];
+    if (pipe(p) < 0) {
+      klee_warning("portfolio solver: pipe failed - %s",
+                   llvm::sys::StrError(errno).c_str());
+      continue;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(p[0]);
+      for (unsigned j = 0; j < fds.size(); ++j)
+        close(fds[j].fd);
+      runBackend(backends[i], p[1], query, objects);
+    }
+    close(p[1]);
+    if (pid < 0) {
+      klee_warning("portfolio solver: fork failed - %s",
+                   llvm::sys::StrError(errno).c_str());
+      close(p[0]);
+      continue;
+    }
+    pids[i] = pid;
+    struct pollfd pfd = { p[0], POLLIN, 0 };
+    fds.push_back(pfd);
+    fdBackend.push_back(i);
+  }
+
+  runStatusCode = fds.empty() ? SOLVER_RUN_STATUS_FORK_FAILED
+                              : SOLVER_RUN_STATUS_FAILURE;
+  double deadline = timeout ? util::getWallTime() + timeout : 0;
+  int winner = -1;
+  unsigned pending = fds.size();
+  while (winner < 0 && pending) {
+    int waitMs = -1;
+    if (deadline) {
+      double left = deadline - util::getWallTime();
+      if (left <= 0) {
+        runStatusCode = SOLVER_RUN_STATUS_TIMEOUT;
+        break;
+      }
+      waitMs = (int) (left * 1000) + 1;
+    }
+    int res = poll(&fds[0], fds.size(), waitMs);
+    if (res < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+
+    for (unsigned i = 0; i < fds.size() && winner < 0; ++i) {
+      if (fds[i].fd < 0 || !fds[i].revents)
+        continue;
+      Answer answer;
+      bool ok = readAll(fds[i].fd, &answer, sizeof(answer));
+      if (ok && answer.success) {
+        hasSolution = answer.hasSolution;
+        if (objects && hasSolution) {
+          values->clear();
+          for (unsigned j = 0; ok && j < objects->size(); ++j) {
+            values->push_back(std::vector<unsigned char>((*objects)[j]->size));
+            if (!values->back().empty())
+              ok = readAll(fds[i].fd, &values->back()[0],
+                           values->back().size());
+          }
+        }
+        if (ok) {
+          winner = fdBackend[i];
+          runStatusCode = (SolverRunStatus) answer.status;
+        }
+      } else if (ok) {
+        // This backend failed, the others may still succeed.
+        runStatusCode = (SolverRunStatus) answer.status;
+      }
+      close(fds[i].fd);
+      fds[i].fd = -1;
+      --pending;
+    }
+  }
+
+  for (unsigned i = 0; i < fds.size(); ++i) {
+    if (fds[i].fd >= 0) {
+      kill(pids[fdBackend[i]], SIGKILL);
+      close(fds[i].fd);
+    }
+  }
+  for (unsigned i = 0; i < pids.size(); ++i) {
+    if (pids[i] < 0)
+      continue;
+    int status;
+    while (waitpid(pids[i], &status, 0) < 0 && errno == EINTR)
+      ;
+  }
+
+  if (winner < 0)
+    return false;
+
+  ++*backends[winner].wins;
+  if (hasSolution)
+    ++stats::queriesInvalid;
+  else
+    ++stats::queriesValid;
+  return true;
+}
+
+bool PortfolioSolverImpl::computeTruth(const Query &query, bool &isValid) {
+  bool hasSolution;
+  if (!race(query, 0, 0, hasSolution))
+    return false;
+  isValid = !hasSolution;
+  return true;
+}
+
+bool PortfolioSolverImpl::computeValue(const Query &query,
+                                       ref<Expr> &result) {
+  std::vector<const Array*> objects;
+  std::vector< std::vector<unsigned char> > values;
+  bool hasSolution;
+
+  // Find the object used in the expression, and compute an assignment
+  // for them.
+  findSymbolicObjects(query.expr, objects);
+  if (!computeInitialValues(query.withFalse(), objects, values, hasSolution))
+    return false;
+  assert(hasSolution && "state has invalid constraint set");
+
+  // Evaluate the expression with the computed assignment.
+  Assignment a(objects, values);
+  result = a.evaluate(query.expr);
+
+  return true;
+}
+
+bool PortfolioSolverImpl::computeInitialValues(
+    const Query &query, const std::vector<const Array*> &objects,
+    std::vector< std::vector<unsigned char> > &values, bool &hasSolution) {
+  return race(query, &objects, &values, hasSolution);
+}
+
+Solver *klee::createPortfolioSolver(
+    const std::vector<std::pair<CoreSolverType, Solver*> > &backends) {
+  return new Solver(new PortfolioSolverImpl(backends));
+}
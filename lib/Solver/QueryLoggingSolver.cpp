@@ -10,6 +10,9 @@
 #include "klee/Config/config.h"
 #include "klee/Internal/System/Time.h"
 #include "klee/Statistics.h"
+
+#include <algorithm>
+#include <functional>
 #ifdef HAVE_ZLIB_H
 #include "klee/Internal/Support/CompressionStream.h"
 #include "klee/Internal/Support/ErrorHandling.h"
@@ -35,10 +38,12 @@ llvm::cl::opt<bool> CreateCompressedQueryLog(
 
 QueryLoggingSolver::QueryLoggingSolver(Solver *_solver, std::string path,
                                        const std::string &commentSign,
-                                       int queryTimeToLog)
+                                       int queryTimeToLog,
+                                       unsigned _slowestToKeep)
     : solver(_solver), os(0), BufferString(""), logBuffer(BufferString),
       queryCount(0), minQueryTimeToLog(queryTimeToLog), startTime(0.0f),
-      lastQueryTime(0.0f), queryCommentSign(commentSign) {
+      lastQueryTime(0.0f), queryCommentSign(commentSign),
+      slowestToKeep(_slowestToKeep) {
 #ifdef HAVE_ZLIB_H
   if (!CreateCompressedQueryLog) {
 #endif
@@ -66,6 +71,13 @@ QueryLoggingSolver::QueryLoggingSolver(Solver *_solver, std::string path,
 }
 
 QueryLoggingSolver::~QueryLoggingSolver() {
+  if (slowestToKeep) {
+    std::sort_heap(slowestQueries.begin(), slowestQueries.end(),
+                   std::greater<std::pair<double, std::string> >());
+    for (unsigned i = 0; i != slowestQueries.size(); ++i)
+      *os << slowestQueries[i].second;
+    os->flush();
+  }
   delete solver;
   delete os;
 }
@@ -92,7 +104,7 @@ void QueryLoggingSolver::startQuery(const Query &query, const char *typeName,
 
   printQuery(query, falseQuery, objects);
 
-  if (DumpPartialQueryiesEarly) {
+  if (DumpPartialQueryiesEarly && !slowestToKeep) {
     flushBufferConditionally(true);
   }
   startTime = getWallTime();
@@ -111,6 +123,24 @@ void QueryLoggingSolver::finishQuery(bool success) {
 }
 
 void QueryLoggingSolver::flushBuffer() {
+  if (slowestToKeep) {
+    std::greater<std::pair<double, std::string> > fastestOnTop;
+    if (slowestQueries.size() < slowestToKeep ||
+        lastQueryTime > slowestQueries.front().first) {
+      logBuffer.flush();
+      slowestQueries.push_back(std::make_pair(lastQueryTime, BufferString));
+      std::push_heap(slowestQueries.begin(), slowestQueries.end(),
+                     fastestOnTop);
+      if (slowestQueries.size() > slowestToKeep) {
+        std::pop_heap(slowestQueries.begin(), slowestQueries.end(),
+                      fastestOnTop);
+        slowestQueries.pop_back();
+      }
+    }
+    flushBufferConditionally(false);
+    return;
+  }
+
   bool writeToFile = false;
 
   if ((0 == minQueryTimeToLog) ||
@@ -15,6 +15,10 @@
 #include "klee/SolverImpl.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <string>
+#include <utility>
+#include <vector>
+
 using namespace klee;
 
 /// This abstract class represents a solver that is capable of logging
@@ -42,6 +46,13 @@ protected:
   const std::string queryCommentSign; // sign representing commented lines
                                       // in given a query format
 
+  /// The number of slowest queries to keep, 0 to write every query as
+  /// it completes.
+  unsigned slowestToKeep;
+  /// The logs of the slowest queries so far with their time, as a heap
+  /// with the fastest of them on top.
+  std::vector<std::pair<double, std::string> > slowestQueries;
+
   virtual void startQuery(const Query &query, const char *typeName,
                           const Query *falseQuery = 0,
                           const std::vector<const Array *> *objects = 0);
@@ -58,8 +69,12 @@ protected:
   void flushBufferConditionally(bool writeToFile);
 
 public:
+  /// \param slowestToKeep - If non-zero, only the logs of this many
+  /// slowest queries are written, slowest first, once the solver is
+  /// destroyed.
   QueryLoggingSolver(Solver *_solver, std::string path,
-                     const std::string &commentSign, int queryTimeToLog);
+                     const std::string &commentSign, int queryTimeToLog,
+                     unsigned slowestToKeep = 0);
 
   virtual ~QueryLoggingSolver();
 
@@ -10,6 +10,7 @@
 #ifdef ENABLE_STP
 #include "STPBuilder.h"
 
+#include "klee/CommandLine.h"
 #include "klee/Expr.h"
 #include "klee/Solver.h"
 #include "klee/util/Bits.h"
@@ -75,7 +76,8 @@ STPArrayExprHash::~STPArrayExprHash() {
 /***/
 
 STPBuilder::STPBuilder(::VC _vc, bool _optimizeDivides)
-  : vc(_vc), optimizeDivides(_optimizeDivides) {
+  : vc(_vc), constructed(ConstructCacheSize),
+    optimizeDivides(_optimizeDivides) {
 
 }
 
@@ -497,19 +499,14 @@ ExprHandle STPBuilder::construct(ref<Expr> e, int *width_out) {
   if (!UseConstructHash || isa<ConstantExpr>(e)) {
     return constructActual(e, width_out);
   } else {
-    ExprHashMap< std::pair<ExprHandle, unsigned> >::iterator it = 
-      constructed.find(e);
-    if (it!=constructed.end()) {
-      if (width_out)
-        *width_out = it->second.second;
-      return it->second.first;
-    } else {
-      int width;
-      if (!width_out) width_out = &width;
-      ExprHandle res = constructActual(e, width_out);
-      constructed.insert(std::make_pair(e, std::make_pair(res, *width_out)));
+    ExprHandle res;
+    if (constructed.lookup(e, res, width_out))
       return res;
-    }
+    int width;
+    if (!width_out) width_out = &width;
+    res = constructActual(e, width_out);
+    constructed.insert(e, res, *width_out);
+    return res;
   }
 }
 
@@ -10,7 +10,7 @@
 #ifndef __UTIL_STPBUILDER_H__
 #define __UTIL_STPBUILDER_H__
 
-#include "klee/util/ExprHashMap.h"
+#include "ConstructCache.h"
 #include "klee/util/ArrayExprHash.h"
 #include "klee/Config/config.h"
 
@@ -64,7 +64,7 @@ namespace klee {
 
 class STPBuilder {
   ::VC vc;
-  ExprHashMap< std::pair<ExprHandle, unsigned> > constructed;
+  ConstructCache<ExprHandle> constructed;
 
   /// optimizeDivides - Rewrite division and reminders by constants
   /// into multiplies and shifts. STP should probably handle this for
@@ -121,7 +121,8 @@ public:
 
   ExprHandle construct(ref<Expr> e) { 
     ExprHandle res = construct(e, 0);
-    constructed.clear();
+    if (!constructed.isPersistent())
+      constructed.clear();
     return res;
   }
 };
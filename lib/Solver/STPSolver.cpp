@@ -43,6 +43,10 @@ llvm::cl::opt<bool> IgnoreSolverFailures(
 
 static unsigned char *shared_memory_ptr;
 static int shared_memory_id = 0;
+// The process which attached the shared memory. Processes forked from it
+// (exploration workers, parallel factor solving) must not share the
+// region, they attach their own on their first query.
+static pid_t shared_memory_owner = 0;
 // Darwin by default has a very small limit on the maximum amount of shared
 // memory, which will quickly be exhausted by KLEE running its tests in
 // parallel. For now, we work around this by just requesting a smaller size --
@@ -54,6 +58,18 @@ static const unsigned shared_memory_size = 1 << 16;
 static const unsigned shared_memory_size = 1 << 20;
 #endif
 
+static void attach_shared_memory() {
+  shared_memory_id =
+      shmget(IPC_PRIVATE, shared_memory_size, IPC_CREAT | 0700);
+  if (shared_memory_id < 0)
+    llvm::report_fatal_error("unable to allocate shared memory region");
+  shared_memory_ptr = (unsigned char *)shmat(shared_memory_id, NULL, 0);
+  if (shared_memory_ptr == (void *)-1)
+    llvm::report_fatal_error("unable to attach shared memory region");
+  shmctl(shared_memory_id, IPC_RMID, NULL);
+  shared_memory_owner = getpid();
+}
+
 static void stp_error_handler(const char *err_msg) {
   fprintf(stderr, "error: STP Error: %s\n", err_msg);
   abort();
@@ -106,14 +122,7 @@ STPSolverImpl::STPSolverImpl(bool _useForkedSTP, bool _optimizeDivides)
 
   if (useForkedSTP) {
     assert(shared_memory_id == 0 && "shared memory id already allocated");
-    shared_memory_id =
-        shmget(IPC_PRIVATE, shared_memory_size, IPC_CREAT | 0700);
-    if (shared_memory_id < 0)
-      llvm::report_fatal_error("unable to allocate shared memory region");
-    shared_memory_ptr = (unsigned char *)shmat(shared_memory_id, NULL, 0);
-    if (shared_memory_ptr == (void *)-1)
-      llvm::report_fatal_error("unable to attach shared memory region");
-    shmctl(shared_memory_id, IPC_RMID, NULL);
+    attach_shared_memory();
   }
 }
 
@@ -220,6 +229,10 @@ runAndGetCexForked(::VC vc, STPBuilder *builder, ::VCExpr q,
                    const std::vector<const Array *> &objects,
                    std::vector<std::vector<unsigned char> > &values,
                    bool &hasSolution, double timeout) {
+  if (shared_memory_owner != getpid()) {
+    shmdt(shared_memory_ptr);
+    attach_shared_memory();
+  }
   unsigned char *pos = shared_memory_ptr;
   unsigned sum = 0;
   for (std::vector<const Array *>::const_iterator it = objects.begin(),
@@ -12,18 +12,60 @@
 using namespace klee;
 
 Statistic stats::cexCacheTime("CexCacheTime", "CCtime");
+Statistic stats::portfolioWinsMetaSMT("PortfolioWinsMetaSMT", "PWmetasmt");
+Statistic stats::portfolioWinsSTP("PortfolioWinsSTP", "PWstp");
+Statistic stats::portfolioWinsZ3("PortfolioWinsZ3", "PWz3");
 Statistic stats::queries("Queries", "Q");
 Statistic stats::queriesInvalid("QueriesInvalid", "Qiv");
 Statistic stats::queriesValid("QueriesValid", "Qv");
 Statistic stats::queryCacheHits("QueryCacheHits", "QChits") ;
 Statistic stats::queryCacheMisses("QueryCacheMisses", "QCmisses");
+Statistic stats::queryCexCacheBytes("QueryCexCacheBytes", "QCexBytes");
+Statistic stats::queryCexCacheEntries("QueryCexCacheEntries", "QCexEntries");
+Statistic stats::queryCexCacheEvictions("QueryCexCacheEvictions", "QCexEvicts");
+Statistic stats::queryCexCacheFreedBytes("QueryCexCacheFreedBytes", "QCexFreed");
 Statistic stats::queryCexCacheHits("QueryCexCacheHits", "QCexHits") ;
 Statistic stats::queryCexCacheMisses("QueryCexCacheMisses", "QCexMisses");
+Statistic stats::queryConstructCacheEntries("QueryConstructCacheEntries", "QBCentries");
+Statistic stats::queryConstructCacheEvictions("QueryConstructCacheEvictions", "QBCevicts");
+Statistic stats::queryConstructCacheHits("QueryConstructCacheHits", "QBChits");
+Statistic stats::queryConstructCacheMisses("QueryConstructCacheMisses", "QBCmisses");
 Statistic stats::queryConstructTime("QueryConstructTime", "QBtime") ;
 Statistic stats::queryConstructs("QueriesConstructs", "QB");
+Statistic stats::queryIncrementalHits("QueryIncrementalHits", "QIhits");
+Statistic stats::queryIncrementalMisses("QueryIncrementalMisses", "QImisses");
+Statistic stats::queryIncrementalReused("QueryIncrementalReused", "QIreused");
+Statistic stats::queryPersistentCacheHits("QueryPersistentCacheHits", "QPChits");
+Statistic stats::queryPersistentCacheMisses("QueryPersistentCacheMisses", "QPCmisses");
 Statistic stats::queryCounterexamples("QueriesCEX", "Qcex");
 Statistic stats::queryTime("QueryTime", "Qtime");
 
 #ifdef DEBUG
 Statistic stats::arrayHashTime("ArrayHashTime", "AHtime");
 #endif
+
+QueryLatencyHistogram stats::cacheQueryLatency("CacheQueryLatency");
+QueryLatencyHistogram stats::cexCacheQueryLatency("CexCacheQueryLatency");
+QueryLatencyHistogram stats::coreQueryLatency("CoreQueryLatency");
+QueryLatencyHistogram stats::independentQueryLatency("IndependentQueryLatency");
+
+/* *** */
+
+QueryLatencyHistogram::QueryLatencyHistogram(const char *_name) : name(_name) {
+  for (unsigned i = 0; i != NumBuckets; ++i)
+    counts[i] = 0;
+}
+
+const char *QueryLatencyHistogram::getBucketName(unsigned bucket) {
+  static const char *names[NumBuckets] = { "10us", "100us", "1ms", "10ms",
+                                           "100ms", "1s", "10s", "inf" };
+  return names[bucket];
+}
+
+void QueryLatencyHistogram::record(double seconds) {
+  unsigned bucket = 0;
+  for (double bound = 1e-5; bucket != NumBuckets - 1 && seconds >= bound;
+       bound *= 10)
+    ++bucket;
+  ++counts[bucket];
+}
@@ -10,6 +10,7 @@
 #ifdef ENABLE_Z3
 #include "Z3Builder.h"
 
+#include "klee/CommandLine.h"
 #include "klee/Expr.h"
 #include "klee/Internal/Support/ErrorHandling.h"
 #include "klee/Solver.h"
@@ -74,7 +75,8 @@ void Z3ArrayExprHash::clear() {
 }
 
 Z3Builder::Z3Builder(bool autoClearConstructCache, const char* z3LogInteractionFileArg)
-    : autoClearConstructCache(autoClearConstructCache), z3LogInteractionFile("") {
+    : constructed(ConstructCacheSize),
+      autoClearConstructCache(autoClearConstructCache), z3LogInteractionFile("") {
   if (z3LogInteractionFileArg)
     this->z3LogInteractionFile = std::string(z3LogInteractionFileArg);
   if (z3LogInteractionFile.length() > 0) {
@@ -450,20 +452,15 @@ Z3ASTHandle Z3Builder::construct(ref<Expr> e, int *width_out) {
   if (!UseConstructHashZ3 || isa<ConstantExpr>(e)) {
     return constructActual(e, width_out);
   } else {
-    ExprHashMap<std::pair<Z3ASTHandle, unsigned> >::iterator it =
-        constructed.find(e);
-    if (it != constructed.end()) {
-      if (width_out)
-        *width_out = it->second.second;
-      return it->second.first;
-    } else {
-      int width;
-      if (!width_out)
-        width_out = &width;
-      Z3ASTHandle res = constructActual(e, width_out);
-      constructed.insert(std::make_pair(e, std::make_pair(res, *width_out)));
+    Z3ASTHandle res;
+    if (constructed.lookup(e, res, width_out))
       return res;
-    }
+    int width;
+    if (!width_out)
+      width_out = &width;
+    res = constructActual(e, width_out);
+    constructed.insert(e, res, *width_out);
+    return res;
   }
 }
 
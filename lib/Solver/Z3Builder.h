@@ -10,7 +10,7 @@
 #ifndef __UTIL_Z3BUILDER_H__
 #define __UTIL_Z3BUILDER_H__
 
-#include "klee/util/ExprHashMap.h"
+#include "ConstructCache.h"
 #include "klee/util/ArrayExprHash.h"
 #include "klee/Config/config.h"
 #include <z3.h>
@@ -100,7 +100,7 @@ public:
 };
 
 class Z3Builder {
-  ExprHashMap<std::pair<Z3ASTHandle, unsigned> > constructed;
+  ConstructCache<Z3ASTHandle> constructed;
   Z3ArrayExprHash _arr_hash;
 
 private:
@@ -178,12 +178,17 @@ public:
 
   Z3ASTHandle construct(ref<Expr> e) {
     Z3ASTHandle res = construct(e, 0);
-    if (autoClearConstructCache)
+    if (autoClearConstructCache && !constructed.isPersistent())
       clearConstructCache();
     return res;
   }
 
   void clearConstructCache() { constructed.clear(); }
+  /// Whether the construct cache is kept across queries, in which case
+  /// it bounds its own size and need not be cleared.
+  bool hasPersistentConstructCache() const {
+    return constructed.isPersistent();
+  }
 };
 }
 
@@ -15,6 +15,7 @@
 #include "klee/Constraints.h"
 #include "klee/Solver.h"
 #include "klee/SolverImpl.h"
+#include "klee/SolverStats.h"
 #include "klee/util/Assignment.h"
 #include "klee/util/ExprUtil.h"
 #include "llvm/Support/CommandLine.h"
@@ -38,6 +39,17 @@ llvm::cl::opt<bool> Z3ValidateModels(
 llvm::cl::opt<unsigned>
     Z3VerbosityLevel("debug-z3-verbosity", llvm::cl::init(0),
                      llvm::cl::desc("Z3 verbosity level (default=0)"));
+
+llvm::cl::opt<bool> Z3Incremental(
+    "z3-incremental", llvm::cl::init(false),
+    llvm::cl::desc("Keep Z3 solvers around between queries and only assert "
+                   "the constraints that differ from the previous query "
+                   "using push/pop (default=off)"));
+
+llvm::cl::opt<unsigned> Z3IncrementalSolvers(
+    "z3-incremental-solvers", llvm::cl::init(4),
+    llvm::cl::desc("Number of incremental Z3 solvers to keep, each one "
+                   "holding a different constraint set (default=4)"));
 }
 
 #include "llvm/Support/ErrorHandling.h"
@@ -54,6 +66,20 @@ private:
   // Parameter symbols
   ::Z3_symbol timeoutParamStrSymbol;
 
+  /// A solver which is kept between queries in incremental mode. Every
+  /// constraint is asserted in its own scope so that the solver can be
+  /// popped back to any prefix of its constraints.
+  struct IncrementalSolver {
+    ::Z3_solver solver;
+    std::vector<ref<Expr> > constraints;
+    unsigned lastUsed;
+  };
+  std::vector<IncrementalSolver> incrementalSolvers;
+  unsigned incrementalTick;
+
+  IncrementalSolver &getIncrementalSolver(const ConstraintManager &);
+  void releaseIncrementalSolver(IncrementalSolver &);
+
   bool internalRunSolver(const Query &,
                          const std::vector<const Array *> *objects,
                          std::vector<std::vector<unsigned char> > *values,
@@ -97,7 +123,7 @@ Z3SolverImpl::Z3SolverImpl()
               ? Z3LogInteractionFile.c_str()
               : NULL)),
       timeout(0.0), runStatusCode(SOLVER_RUN_STATUS_FAILURE),
-      dumpedQueriesFile(0) {
+      dumpedQueriesFile(0), incrementalTick(0) {
   assert(builder && "unable to create Z3Builder");
   solverParameters = Z3_mk_params(builder->ctx);
   Z3_params_inc_ref(builder->ctx, solverParameters);
@@ -125,6 +151,8 @@ Z3SolverImpl::Z3SolverImpl()
 }
 
 Z3SolverImpl::~Z3SolverImpl() {
+  while (!incrementalSolvers.empty())
+    releaseIncrementalSolver(incrementalSolvers.back());
   Z3_params_dec_ref(builder->ctx, solverParameters);
   delete builder;
 
@@ -136,6 +164,8 @@ Z3SolverImpl::~Z3SolverImpl() {
 
 Z3Solver::Z3Solver() : Solver(new Z3SolverImpl()) {}
 
+bool Z3Solver::isIncremental() { return Z3Incremental; }
+
 char *Z3Solver::getConstraintLog(const Query &query) {
   return impl->getConstraintLog(query);
 }
@@ -232,27 +262,105 @@ bool Z3SolverImpl::computeInitialValues(
   return internalRunSolver(query, &objects, &values, hasSolution);
 }
 
+Z3SolverImpl::IncrementalSolver &
+Z3SolverImpl::getIncrementalSolver(const ConstraintManager &constraints) {
+  // Pick the solver that shares the longest constraint prefix with the
+  // query, queries of the same state (and of its children) will usually
+  // only differ in the last few constraints.
+  IncrementalSolver *best = 0, *lru = 0;
+  unsigned bestPrefix = 0;
+  for (std::vector<IncrementalSolver>::iterator it = incrementalSolvers.begin(),
+                                                ie = incrementalSolvers.end();
+       it != ie; ++it) {
+    unsigned prefix = 0;
+    ConstraintManager::const_iterator ci = constraints.begin(),
+                                      ce = constraints.end();
+    for (; ci != ce && prefix < it->constraints.size() &&
+               *ci == it->constraints[prefix];
+         ++ci, ++prefix)
+      ;
+    if (prefix > bestPrefix) {
+      best = &*it;
+      bestPrefix = prefix;
+    }
+    if (!lru || it->lastUsed < lru->lastUsed)
+      lru = &*it;
+  }
+
+  if (best) {
+    ++stats::queryIncrementalHits;
+    stats::queryIncrementalReused += bestPrefix;
+  } else {
+    ++stats::queryIncrementalMisses;
+    if (incrementalSolvers.size() < std::max(1U, (unsigned)Z3IncrementalSolvers)) {
+      IncrementalSolver is;
+      is.solver = Z3_mk_solver(builder->ctx);
+      Z3_solver_inc_ref(builder->ctx, is.solver);
+      incrementalSolvers.push_back(is);
+      best = &incrementalSolvers.back();
+    } else {
+      best = lru;
+    }
+  }
+
+  // Backtrack to the common prefix and assert the rest.
+  unsigned numPops = best->constraints.size() - bestPrefix;
+  if (numPops) {
+    Z3_solver_pop(builder->ctx, best->solver, numPops);
+    best->constraints.resize(bestPrefix);
+  }
+  ConstraintManager::const_iterator it = constraints.begin(),
+                                    ie = constraints.end();
+  std::advance(it, bestPrefix);
+  for (; it != ie; ++it) {
+    Z3_solver_push(builder->ctx, best->solver);
+    Z3_solver_assert(builder->ctx, best->solver, builder->construct(*it));
+    best->constraints.push_back(*it);
+  }
+
+  best->lastUsed = ++incrementalTick;
+  return *best;
+}
+
+void Z3SolverImpl::releaseIncrementalSolver(IncrementalSolver &is) {
+  Z3_solver_dec_ref(builder->ctx, is.solver);
+  is = incrementalSolvers.back();
+  incrementalSolvers.pop_back();
+}
+
 bool Z3SolverImpl::internalRunSolver(
     const Query &query, const std::vector<const Array *> *objects,
     std::vector<std::vector<unsigned char> > *values, bool &hasSolution) {
 
   TimerStatIncrementer t(stats::queryTime);
   // NOTE: Z3 will switch to using a slower solver internally if push/pop are
-  // used so for now it is likely that creating a new solver each time is the
-  // right way to go until Z3 changes its behaviour.
+  // used so by default we create a new solver each time. When the queries
+  // share long constraint prefixes not having to re-encode and re-assert
+  // them outweighs this, so --z3-incremental keeps solvers around.
   //
   // TODO: Investigate using a custom tactic as described in
   // https://github.com/klee/klee/issues/653
-  Z3_solver theSolver = Z3_mk_solver(builder->ctx);
-  Z3_solver_inc_ref(builder->ctx, theSolver);
-  Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
-
+  IncrementalSolver *incremental = 0;
+  Z3_solver theSolver;
   runStatusCode = SOLVER_RUN_STATUS_FAILURE;
 
-  for (ConstraintManager::const_iterator it = query.constraints.begin(),
-                                         ie = query.constraints.end();
-       it != ie; ++it) {
-    Z3_solver_assert(builder->ctx, theSolver, builder->construct(*it));
+  if (Z3Incremental) {
+    incremental = &getIncrementalSolver(query.constraints);
+    theSolver = incremental->solver;
+    // The query expression is only asserted for this query.
+    Z3_solver_push(builder->ctx, theSolver);
+    // The timeout may have changed since the solver was last used.
+    Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
+  } else {
+    theSolver = Z3_mk_solver(builder->ctx);
+    Z3_solver_inc_ref(builder->ctx, theSolver);
+    Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
+
+    for (ConstraintManager::const_iterator it = query.constraints.begin(),
+                                           ie = query.constraints.end();
+         it != ie; ++it) {
+      Z3_solver_assert(builder->ctx, theSolver, builder->construct(*it));
+    }
   }
   ++stats::queries;
   if (objects)
@@ -283,13 +391,22 @@ bool Z3SolverImpl::internalRunSolver(
   runStatusCode = handleSolverResponse(theSolver, satisfiable, objects, values,
                                        hasSolution);
 
-  Z3_solver_dec_ref(builder->ctx, theSolver);
+  if (incremental) {
+    Z3_solver_pop(builder->ctx, theSolver, 1);
+    // Do not reuse a solver that was interrupted.
+    if (runStatusCode != SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE &&
+        runStatusCode != SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE)
+      releaseIncrementalSolver(*incremental);
+  } else {
+    Z3_solver_dec_ref(builder->ctx, theSolver);
+  }
   // Clear the builder's cache to prevent memory usage exploding.
   // By using ``autoClearConstructCache=false`` and clearning now
   // we allow Z3_ast expressions to be shared from an entire
   // ``Query`` rather than only sharing within a single call to
-  // ``builder->construct()``.
-  builder->clearConstructCache();
+  // ``builder->construct()``. A persistent cache bounds its own size.
+  if (!builder->hasPersistentConstructCache())
+    builder->clearConstructCache();
 
   if (runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE ||
       runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE) {
@@ -20,6 +20,10 @@ public:
   /// Z3Solver - Construct a new Z3Solver.
   Z3Solver();
 
+  /// Whether the solvers are kept between queries (--z3-incremental), which
+  /// does not work in a forked process.
+  static bool isIncremental();
+
   /// Get the query in SMT-LIBv2 format.
   /// \return A C-style string. The caller is responsible for freeing this.
   virtual char *getConstraintLog(const Query &);
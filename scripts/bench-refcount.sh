@@ -0,0 +1,56 @@
+#!/usr/bin/env bash
+
+# ===-- bench-refcount.sh -------------------------------------------------===##
+# 
+#                      The KLEE Symbolic Virtual Machine
+# 
+#  This file is distributed under the University of Illinois Open Source
+#  License. See LICENSE.TXT for details.
+# 
+# ===----------------------------------------------------------------------===##
+#
+# Measure the cost of atomic reference counting: builds KLEE with and
+# without -DENABLE_ATOMIC_REFCOUNT=ON and times the Expr unit tests and
+# kleaver on the given queries in both builds.
+#
+# Usage: bench-refcount.sh <work-dir> <runs> <kquery-file>... [-- <cmake-args>]
+
+if [ $# -lt 3 ] ; then
+	echo "usage: $0 <work-dir> <runs> <kquery-file>... [-- <cmake-args>]"
+	exit 1
+fi
+
+SRC_DIR=$(cd "$(dirname "$0")/.." && pwd)
+WORK_DIR=$1
+RUNS=$2
+shift 2
+
+QUERIES=()
+while [ $# -gt 0 ] && [ "$1" != "--" ] ; do
+	QUERIES+=("$(cd "$(dirname "$1")" && pwd)/$(basename "$1")")
+	shift
+done
+[ "$1" == "--" ] && shift
+
+# Run a command RUNS times and print the total user+sys seconds.
+time_runs() {
+	local t
+	TIMEFORMAT=%3U+%3S
+	t=$( { time (for i in $(seq 1 "$RUNS"); do "$@" > /dev/null 2>&1; done) ; } 2>&1 )
+	echo "$t" | awk -F+ '{printf "%.3f", $1 + $2}'
+}
+
+for mode in OFF ON ; do
+	BUILD_DIR="$WORK_DIR/build-atomic-$mode"
+	mkdir -p "$BUILD_DIR"
+	(cd "$BUILD_DIR" && \
+		cmake -DCMAKE_BUILD_TYPE=Release -DENABLE_ATOMIC_REFCOUNT=$mode \
+			"$@" "$SRC_DIR" > /dev/null && \
+		make -j"$(nproc)" ExprTest kleaver > /dev/null) || exit 1
+
+	echo "ENABLE_ATOMIC_REFCOUNT=$mode"
+	echo "  ExprTest: $(time_runs "$BUILD_DIR/unittests/ExprTest")s"
+	for q in "${QUERIES[@]}" ; do
+		echo "  kleaver $(basename "$q"): $(time_runs "$BUILD_DIR/bin/kleaver" "$q")s"
+	done
+done
@@ -0,0 +1,36 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out %t.sync.klee-out %t.dfs.klee-out
+// RUN: %klee --output-dir=%t.sync.klee-out %t.bc 2>&1 | FileCheck %s
+// RUN: %klee --output-dir=%t.klee-out --async-branch-queries=2 %t.bc 2>&1 | FileCheck %s
+// RUN: ls %t.klee-out | grep -c ktest | FileCheck -check-prefix=TESTS %s
+// RUN: %klee --output-dir=%t.dfs.klee-out --async-branch-queries=2 --search=dfs %t.bc 2>&1 | FileCheck %s
+// RUN: grep -h "async branch queries\|total instructions" %t.sync.klee-out/info %t.klee-out/info %t.dfs.klee-out/info > %t.info
+// RUN: FileCheck -check-prefix=INFO -input-file=%t.info %s
+
+#include "klee/klee.h"
+
+int main() {
+  unsigned char buf[4];
+  int count = 0;
+  klee_make_symbolic(buf, sizeof(buf), "buf");
+
+  // The same paths as when every branch is solved in the executor.
+  for (int i = 0; i < 4; ++i)
+    if (buf[i] > 100 + i)
+      ++count;
+
+  if (count == 3 && buf[0] == buf[3])
+    return 1;
+  return 0;
+}
+
+// CHECK: KLEE: done: completed paths = 19
+// TESTS: 19
+
+// Branches executed again with their answer are counted once, with the
+// default searcher as well as with DFS.
+// INFO: total instructions = [[INSTRS:[0-9]+]]
+// INFO-NEXT: async branch queries = {{[1-9][0-9]*}}
+// INFO-NEXT: total instructions = [[INSTRS]]
+// INFO-NEXT: async branch queries = {{[1-9][0-9]*}}
+// INFO-NEXT: total instructions = [[INSTRS]]
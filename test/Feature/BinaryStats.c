@@ -0,0 +1,20 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --binary-stats %t.bc 2> %t.log
+// RUN: head -c 8 %t.klee-out/run.stats | grep -q KLEESTAT
+// RUN: grep -a -q WallTime %t.klee-out/run.stats
+// RUN: grep "total instructions" %t.klee-out/info > %t.stats
+// RUN: %klee-stats --table-format=plain %t.klee-out >> %t.stats
+// RUN: FileCheck --check-prefix=CHECK-STATS -input-file=%t.stats %s
+
+int main() {
+  int sum = 0;
+  for (int i = 0; i < 100; ++i)
+    sum += i;
+  return sum != 4950;
+}
+
+// klee-stats decodes the last record.
+// CHECK-STATS: total instructions = [[INSTRS:[0-9]+]]
+// CHECK-STATS: Path{{ +}}Instrs
+// CHECK-STATS: klee-out{{ +}}[[INSTRS]]{{ }}
@@ -0,0 +1,28 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out %t.klee-out-resumed
+// RUN: %klee --output-dir=%t.klee-out --checkpoint-interval=3600 --stop-after-n-instructions=60 --dump-states-on-halt=false %t1.bc 2>&1 | FileCheck --check-prefix=CHECK-HALT %s
+// RUN: test -f %t.klee-out/checkpoint.bin
+// RUN: %klee --output-dir=%t.klee-out-resumed --resume-from=%t.klee-out/checkpoint.bin %t1.bc 2>&1 | FileCheck --check-prefix=CHECK-RESUME %s
+
+#include "klee/klee.h"
+
+int main() {
+  int a;
+  klee_make_symbolic(&a, sizeof(a), "a");
+
+  int n = 0;
+  if (a & 1)
+    n++;
+  if (a & 2)
+    n++;
+  if (a & 4)
+    n++;
+  return n;
+}
+
+// CHECK-HALT: wrote checkpoint of {{[0-9]+}} states
+// CHECK-RESUME: resuming {{[0-9]+}} states
+// CHECK-RESUME: WARNING: resuming re-executes every path
+// CHECK-RESUME-NOT: diverged
+// CHECK-RESUME: KLEE: done: completed paths = 8
+// CHECK-RESUME: KLEE: done: generated tests = 8
@@ -0,0 +1,31 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --compact-update-lists=8 %t1.bc 2>&1 | FileCheck %s
+// RUN: FileCheck --check-prefix=CHECK-INFO -input-file=%t.klee-out/info %s
+
+#include "klee/klee.h"
+#include <assert.h>
+#include <stdio.h>
+
+int main() {
+  unsigned char buf[8] = {0};
+  unsigned i = klee_range(0, 8, "i");
+
+  // Every round flushes the concrete bytes over the symbolic write of the
+  // previous one, so most of the updates become dead.
+  for (unsigned round = 1; round <= 32; ++round) {
+    for (unsigned j = 0; j < 8; ++j)
+      buf[j] = round;
+    buf[i] = round + 100;
+  }
+
+  assert(buf[i] == 132);
+  if (buf[(i + 1) % 8] == 32)
+    printf("ok\n");
+  // CHECK-NOT: ASSERTION FAIL
+  // CHECK: ok
+  // CHECK-NOT: ASSERTION FAIL
+  return 0;
+}
+
+// CHECK-INFO: KLEE: done: compacted updates = {{[1-9][0-9]*}}
@@ -0,0 +1,28 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out %t.klee-out-small
+// RUN: %klee --output-dir=%t.klee-out %t.bc
+// RUN: FileCheck --check-prefix=CHECK-DEFAULT -input-file=%t.klee-out/info %s
+// RUN: %klee --output-dir=%t.klee-out-small --construct-cache-size=4 %t.bc
+// RUN: FileCheck --check-prefix=CHECK-SMALL -input-file=%t.klee-out-small/info %s
+
+#include "klee/klee.h"
+
+int main() {
+  unsigned char buf[8];
+  int count = 0;
+  klee_make_symbolic(buf, sizeof(buf), "buf");
+
+  // Every query repeats the constraints of the branches before it, whose
+  // translations are kept across queries.
+  for (int i = 0; i < 8; ++i)
+    if (buf[i] * 3 + i > 200)
+      ++count;
+  return count;
+}
+
+// CHECK-DEFAULT: KLEE: done: construct cache hits = {{[1-9][0-9]*}}
+// CHECK-DEFAULT: KLEE: done: construct cache evictions = 0{{$}}
+
+// A cache of four entries can not hold the translations of one path.
+// CHECK-SMALL: KLEE: done: construct cache hits = {{[0-9]+}}
+// CHECK-SMALL: KLEE: done: construct cache evictions = {{[1-9][0-9]*}}
@@ -0,0 +1,22 @@
+// REQUIRES: z3
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 --use-forked-z3 %t.bc 2>&1 | FileCheck %s
+
+#include "klee/klee.h"
+
+int main() {
+  unsigned char buf[4];
+  int count = 0;
+  klee_make_symbolic(buf, sizeof(buf), "buf");
+
+  for (int i = 0; i < 4; ++i)
+    if (buf[i] > 100 + i)
+      ++count;
+
+  if (count == 3 && buf[0] == buf[3])
+    return 1;
+  return 0;
+}
+
+// CHECK: KLEE: done: completed paths = 19
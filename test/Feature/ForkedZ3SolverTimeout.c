@@ -0,0 +1,25 @@
+// REQUIRES: z3
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 --use-forked-z3 --max-solver-time=1 %t.bc 2>&1 | FileCheck %s
+
+#include "klee/klee.h"
+
+#include <stdio.h>
+
+int main() {
+  long long int x, y = 102*75678 + 78, i = 101;
+
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  // Too hard to solve in a second, the query runs in a forked process
+  // which is killed at the timeout.
+  if (x*x*x*x*x*x*x*x*x*x*x*x*x*x*x*x + (x*x % (x+12)) == y*y*y*y*y*y*y*y*y*y*y*y*y*y*y*y % i)
+    printf("Yes\n");
+  else
+    printf("No\n");
+
+  return 0;
+}
+
+// CHECK: KLEE: WARNING: forked solver: query timed out, killed the solver
@@ -0,0 +1,20 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --istats-delta --istats-write-after-instructions=100 %t.bc 2> %t.log
+// RUN: head -n 1 %t.klee-out/run.istats.delta | grep -q "klee-istats-delta: 1"
+// The last snapshot is taken together with run.istats, rebuilding it from
+// the deltas gives the same file.
+// RUN: %klee-istats %t.klee-out -o %t.istats
+// RUN: FileCheck -input-file=%t.klee-out/run.istats %s
+// RUN: FileCheck -input-file=%t.istats %s
+// RUN: diff %t.istats %t.klee-out/run.istats
+
+// CHECK: events:
+// CHECK: fn=main
+int main() {
+  int sum = 0;
+  for (int i = 0; i < 1000; ++i)
+    sum += i;
+    // CHECK: {{^[0-9]+}} [[@LINE-1]]{{.* 1000 }}
+  return sum != 499500;
+}
@@ -0,0 +1,28 @@
+// Check that the independent factors of a query can be solved in forked
+// processes, and that their answers are merged correctly.
+//
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --independent-solver-jobs=2 %t1.bc 2>&1 | FileCheck --check-prefix=CHECK-KLEE %s
+// RUN: /bin/sh -c "ktest-tool --write-int %t.klee-out/*.ktest" | sort > %t.data-values
+// RUN: FileCheck < %t.data-values %s
+
+// CHECK-KLEE: KLEE: done: generated tests = 1
+
+// CHECK: object 0: data: 17
+// CHECK: object 1: data: 1001
+// CHECK: object 2: data: 42
+
+#include "klee/klee.h"
+
+int main() {
+  int a, b, c;
+  klee_make_symbolic(&a, sizeof(a), "a");
+  klee_make_symbolic(&b, sizeof(b), "b");
+  klee_make_symbolic(&c, sizeof(c), "c");
+
+  klee_assume(a - 7 == 10);
+  klee_assume(b > 1000 & b < 1002);
+  klee_assume(c + c == 84 & c > 0);
+  return 0;
+}
@@ -0,0 +1,25 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out %t.bc 2> %t.log
+// RUN: grep "total" %t.klee-out/info > %t.stats
+// RUN: %klee-stats --print-all --table-format=plain %t.klee-out >> %t.stats
+// RUN: FileCheck -input-file=%t.stats %s
+
+#include "klee/klee.h"
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  if (x > 10)
+    return 1;
+  if (x < -10)
+    return 2;
+  return 0;
+}
+
+// klee-stats reads the leading run.stats columns by position, columns
+// added to run.stats must not shift them.
+// CHECK: total queries = [[QUERIES:[0-9]+]]
+// CHECK: total instructions = [[INSTRS:[0-9]+]]
+// CHECK: Path{{ +}}Instrs
+// CHECK: klee-out{{ +}}[[INSTRS]]{{( +[0-9.]+){11} +}}[[QUERIES]]{{ }}
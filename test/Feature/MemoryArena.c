@@ -0,0 +1,24 @@
+// RUN: %llvmgcc %s -g -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --use-memory-arena %t1.bc 2>&1 | FileCheck %s
+// RUN: test -f %t.klee-out/test000001.ptr.err
+
+#include <stdlib.h>
+
+int main() {
+  // Objects of the same size class come from the same arena, the slot
+  // after an object must still not belong to another one.
+  int *objs[64];
+  for (int i = 0; i < 64; ++i) {
+    objs[i] = malloc(sizeof(int));
+    *objs[i] = i;
+  }
+  for (int i = 0; i < 64; i += 2)
+    free(objs[i]);
+  for (int i = 0; i < 64; i += 2)
+    objs[i] = malloc(sizeof(int));
+
+  // CHECK: MemoryArena.c:[[@LINE+1]]: memory error: out of bound pointer
+  objs[31][1] = 1;
+  return 0;
+}
@@ -0,0 +1,31 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --parallel-workers=2 %t.bc 2>&1 | FileCheck %s
+// RUN: ls %t.klee-out | grep -c ktest | FileCheck -check-prefix=TESTS %s
+
+#include "klee/klee.h"
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  // Eight paths, split across the two workers after the first branch.
+  if (x & 1) {
+    if (x & 2) {
+      if (x & 4) return 0; else return 1;
+    } else {
+      if (x & 4) return 2; else return 3;
+    }
+  } else {
+    if (x & 2) {
+      if (x & 4) return 4; else return 5;
+    } else {
+      if (x & 4) return 6; else return 7;
+    }
+  }
+}
+
+// CHECK: KLEE: splitting 2 states across 2 workers
+// CHECK: KLEE: done: completed paths = 8
+// CHECK: KLEE: done: generated tests = 8
+// TESTS: 8
@@ -0,0 +1,27 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out %t.klee-out2 %t.qcache
+// RUN: %klee --output-dir=%t.klee-out --persistent-query-cache=%t.qcache --use-query-log=solver:smt2 %t.bc 2>&1 | FileCheck %s
+// RUN: grep "^; Query" %t.klee-out/solver-queries.smt2 | wc -l | grep -qv "^0$"
+// The second run must not need the core solver at all.
+// RUN: %klee --output-dir=%t.klee-out2 --persistent-query-cache=%t.qcache --use-query-log=solver:smt2 %t.bc 2>&1 | FileCheck %s
+// RUN: grep "^; Query" %t.klee-out2/solver-queries.smt2 | wc -l | grep -q "^0$"
+
+#include "klee/klee.h"
+
+int main() {
+  int x, y;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  klee_make_symbolic(&y, sizeof(y), "y");
+
+  if (x * 3 == y + 7) {
+    if (y > 100)
+      return 1;
+    return 2;
+  }
+  if (x < y)
+    return 3;
+  return 0;
+}
+
+// CHECK: KLEE: Using query cache
+// CHECK: KLEE: done: completed paths = 4
@@ -0,0 +1,23 @@
+// REQUIRES: stp
+// REQUIRES: z3
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=portfolio --portfolio-solvers=stp,z3 %t.bc 2>&1 | FileCheck %s
+
+#include "klee/klee.h"
+
+int main() {
+  unsigned x, y;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  klee_make_symbolic(&y, sizeof(y), "y");
+
+  if (x * y == 391) {
+    if (x > 1 && y > 1 && x < y)
+      return 1;
+    return 2;
+  }
+  return 0;
+}
+
+// CHECK: KLEE: Using portfolio solver with 2 backends
+// CHECK: KLEE: done: completed paths = 5
@@ -0,0 +1,24 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --resolve-bisect %t1.bc 2>&1 | FileCheck %s
+// Bisecting visits the objects found and the runs around them only.
+// RUN: grep -E "total queries = ([0-9]|[1-9][0-9]|1[0-9][0-9])$" %t.klee-out/info
+
+#include "klee/klee.h"
+#include <stdlib.h>
+
+#define N 16
+
+int main() {
+  char *objects[N];
+  for (unsigned i = 0; i < N; ++i)
+    objects[i] = malloc(4);
+
+  unsigned i = klee_range(0, N, "i");
+  // Every object, but not the gaps between them.
+  objects[i][2] = 1;
+  return 0;
+}
+
+// CHECK-NOT: memory error
+// CHECK: KLEE: done: completed paths = 16
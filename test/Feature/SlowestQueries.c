@@ -0,0 +1,25 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --use-cex-cache=false --log-slowest-queries=2 --query-latency-histograms %t1.bc 2> %t2.log
+// RUN: grep -c "^# Query" %t.klee-out/slowest-queries.kquery | FileCheck --check-prefix=CHECK-QUERIES %s
+// RUN: %kleaver -print-ast %t.klee-out/slowest-queries.kquery > %t3.log
+// RUN: head -n 1 %t.klee-out/run.stats | grep -q "'CoreQueryLatency_10us'"
+
+#include "klee/klee.h"
+
+int main() {
+  int x, y;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  klee_make_symbolic(&y, sizeof(y), "y");
+
+  if (x * y == 12) {
+    if (x + y == 7)
+      return 1;
+    if (x > y)
+      return 2;
+  }
+  return 0;
+}
+
+// Only the two slowest queries are kept.
+// CHECK-QUERIES: {{^}}2{{$}}
@@ -0,0 +1,25 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --max-memory=1 --spill-states %t1.bc 2>&1 | FileCheck %s
+
+#include "klee/klee.h"
+
+int main() {
+  unsigned char buf[6];
+  klee_make_symbolic(buf, sizeof(buf), "buf");
+
+  // Every path runs long enough for the memory cap to be checked, states
+  // over the cap are spilled and recreated rather than terminated.
+  unsigned count = 0;
+  for (int i = 0; i < 6; i++) {
+    if (buf[i] > 100)
+      count++;
+    for (volatile int j = 0; j < 1000; j++)
+      ;
+  }
+  return count;
+}
+
+// CHECK: spilled {{[0-9]+}} states (over memory cap)
+// CHECK-NOT: killing
+// CHECK: KLEE: done: completed paths = 64
@@ -0,0 +1,29 @@
+// RUN: %llvmgcc %s -emit-llvm -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --max-memory=1 --spill-states --stop-after-n-instructions=300000 %t1.bc 2>&1 | FileCheck %s
+
+#include "klee/klee.h"
+
+int main() {
+  unsigned char buf[6];
+  klee_make_symbolic(buf, sizeof(buf), "buf");
+
+  // The memory cap is checked every 65536 instructions, the halt comes
+  // after some states were spilled and before all paths are done.
+  unsigned count = 0;
+  for (int i = 0; i < 6; i++) {
+    if (buf[i] > 100)
+      count++;
+    for (volatile int j = 0; j < 1000; j++)
+      ;
+  }
+  return count;
+}
+
+// CHECK: spilled {{[0-9]+}} states (over memory cap)
+// CHECK: halting execution, dumping remaining states
+// CHECK: recreating {{[1-9][0-9]*}} spilled states
+// CHECK-NOT: unable to restore a spilled state
+// CHECK-NOT: diverged
+// CHECK: KLEE: done: generated tests
+
@@ -0,0 +1,28 @@
+// REQUIRES: z3
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 --z3-incremental --z3-incremental-solvers=2 %t.bc 2>&1 | FileCheck %s
+// RUN: FileCheck --check-prefix=CHECK-INFO -input-file=%t.klee-out/info %s
+
+#include "klee/klee.h"
+
+int main() {
+  unsigned char buf[4];
+  int count = 0;
+  klee_make_symbolic(buf, sizeof(buf), "buf");
+
+  // Every branch extends the constraints of the previous query by one.
+  for (int i = 0; i < 4; ++i)
+    if (buf[i] > 100 + i)
+      ++count;
+
+  if (count == 3 && buf[0] == buf[3])
+    return 1;
+  return 0;
+}
+
+// CHECK: KLEE: done: completed paths = 19
+
+// Later queries reuse the constraints already asserted in a solver.
+// CHECK-INFO: KLEE: done: incremental solver hits = {{[1-9][0-9]*}}
+// CHECK-INFO: KLEE: done: reused constraints = {{[1-9][0-9]*}}
@@ -179,6 +179,12 @@ namespace {
                  cl::desc("Specify a path file to replay"),
                  cl::value_desc("path file"));
 
+  cl::opt<std::string>
+  ResumeFrom("resume-from",
+             cl::desc("Continue the exploration of an earlier run from a "
+                      "checkpoint it wrote (see --checkpoint-interval)"),
+             cl::value_desc("checkpoint file"));
+
   cl::list<std::string>
   SeedOutFile("seed-out");
 
@@ -224,6 +230,10 @@ private:
   unsigned m_numGeneratedTests; // Number of tests successfully generated
   unsigned m_pathsExplored; // number of paths explored so far
 
+  // test ids are interleaved between exploration workers
+  unsigned m_workerIndex, m_numWorkers;
+  unsigned m_testIdBase; // Number of tests generated before the split
+
   // used for writing .ktest files
   int m_argc;
   char **m_argv;
@@ -238,6 +248,10 @@ public:
   unsigned getNumPathsExplored() { return m_pathsExplored; }
   void incPathsExplored() { m_pathsExplored++; }
 
+  void setWorker(unsigned index, unsigned numWorkers);
+  void addWorkerResults(unsigned pathsExplored, unsigned numTestCases);
+  void setResumedResults(unsigned pathsExplored, unsigned numTestCases);
+
   void setInterpreter(Interpreter *i);
 
   void processTestCase(const ExecutionState  &state,
@@ -262,7 +276,8 @@ public:
 KleeHandler::KleeHandler(int argc, char **argv)
     : m_interpreter(0), m_pathWriter(0), m_symPathWriter(0), m_infoFile(0),
       m_outputDirectory(), m_numTotalTests(0), m_numGeneratedTests(0),
-      m_pathsExplored(0), m_argc(argc), m_argv(argv) {
+      m_pathsExplored(0), m_workerIndex(0), m_numWorkers(1), m_testIdBase(0),
+      m_argc(argc), m_argv(argv) {
 
   // create output directory (OutputDir or "klee-out-<i>")
   bool dir_given = OutputDir != "";
@@ -356,6 +371,28 @@ void KleeHandler::setInterpreter(Interpreter *i) {
   }
 }
 
+void KleeHandler::setWorker(unsigned index, unsigned numWorkers) {
+  m_workerIndex = index;
+  m_numWorkers = numWorkers;
+  m_testIdBase = m_numTotalTests;
+}
+
+void KleeHandler::addWorkerResults(unsigned pathsExplored,
+                                   unsigned numTestCases) {
+  m_pathsExplored += pathsExplored;
+  m_numGeneratedTests += numTestCases;
+  m_numTotalTests += numTestCases;
+
+  if (StopAfterNTests && m_numGeneratedTests >= StopAfterNTests)
+    m_interpreter->setHaltExecution(true);
+}
+
+void KleeHandler::setResumedResults(unsigned pathsExplored,
+                                    unsigned numTestCases) {
+  m_pathsExplored = pathsExplored;
+  m_numGeneratedTests = m_numTotalTests = numTestCases;
+}
+
 std::string KleeHandler::getOutputFilename(const std::string &filename) {
   SmallString<128> path = m_outputDirectory;
   sys::path::append(path,filename);
@@ -408,6 +445,11 @@ void KleeHandler::processTestCase(const ExecutionState &state,
     double start_time = util::getWallTime();
 
     unsigned id = ++m_numTotalTests;
+    // Workers share the output directory, so give each of them every
+    // m_numWorkers-th test id after the split.
+    if (m_numWorkers > 1)
+      id = m_testIdBase + (id - m_testIdBase - 1) * m_numWorkers +
+           m_workerIndex + 1;
 
     if (success) {
       KTest b;
@@ -509,7 +551,8 @@ void KleeHandler::processTestCase(const ExecutionState &state,
       delete f;
     }
 
-    if (m_numGeneratedTests == StopAfterNTests)
+    // Worker results are added in bulk and may step over the limit.
+    if (StopAfterNTests && m_numGeneratedTests >= StopAfterNTests)
       m_interpreter->setHaltExecution(true);
 
     if (WriteTestInfo) {
@@ -1321,6 +1364,15 @@ int main(int argc, char **argv, char **envp) {
     interpreter->setReplayPath(&replayPath);
   }
 
+  if (ResumeFrom != "") {
+    if (ReplayPathFile != "" || !ReplayKTestDir.empty() ||
+        !ReplayKTestFile.empty() || !SeedOutFile.empty() ||
+        !SeedOutDir.empty())
+      klee_error("--resume-from cannot be combined with replaying or "
+                 "seeding");
+    interpreter->setResumeCheckpoint(ResumeFrom);
+  }
+
   char buf[256];
   time_t t[2];
   t[0] = time(NULL);
@@ -1453,6 +1505,20 @@ int main(int argc, char **argv, char **envp) {
     *theStatisticManager->getStatisticByName("Instructions");
   uint64_t forks =
     *theStatisticManager->getStatisticByName("Forks");
+  uint64_t asyncBranchQueries =
+    *theStatisticManager->getStatisticByName("AsyncBranchQueries");
+  uint64_t constructCacheHits =
+    *theStatisticManager->getStatisticByName("QueryConstructCacheHits");
+  uint64_t constructCacheEvictions =
+    *theStatisticManager->getStatisticByName("QueryConstructCacheEvictions");
+  uint64_t compactedUpdates =
+    *theStatisticManager->getStatisticByName("CompactedUpdates");
+  uint64_t incrementalHits =
+    *theStatisticManager->getStatisticByName("QueryIncrementalHits");
+  uint64_t incrementalMisses =
+    *theStatisticManager->getStatisticByName("QueryIncrementalMisses");
+  uint64_t incrementalReused =
+    *theStatisticManager->getStatisticByName("QueryIncrementalReused");
 
   handler->getInfoStream()
     << "KLEE: done: explored paths = " << 1 + forks << "\n";
@@ -1468,6 +1534,22 @@ int main(int argc, char **argv, char **envp) {
     << "KLEE: done: valid queries = " << queriesValid << "\n"
     << "KLEE: done: invalid queries = " << queriesInvalid << "\n"
     << "KLEE: done: query cex = " << queryCounterexamples << "\n";
+  if (asyncBranchQueries)
+    handler->getInfoStream()
+      << "KLEE: done: async branch queries = " << asyncBranchQueries << "\n";
+  if (constructCacheHits || constructCacheEvictions)
+    handler->getInfoStream()
+      << "KLEE: done: construct cache hits = " << constructCacheHits << "\n"
+      << "KLEE: done: construct cache evictions = " << constructCacheEvictions
+      << "\n";
+  if (compactedUpdates)
+    handler->getInfoStream()
+      << "KLEE: done: compacted updates = " << compactedUpdates << "\n";
+  if (incrementalHits || incrementalMisses)
+    handler->getInfoStream()
+      << "KLEE: done: incremental solver hits = " << incrementalHits << "\n"
+      << "KLEE: done: incremental solver misses = " << incrementalMisses << "\n"
+      << "KLEE: done: reused constraints = " << incrementalReused << "\n";
 
   std::stringstream stats;
   stats << "\n";
@@ -0,0 +1,224 @@
+//===-- BTreeMapTest.cpp --------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Internal/ADT/BTreeMap.h"
+#include "klee/Internal/ADT/ImmutableMap.h"
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+typedef BTreeMap<unsigned, unsigned> Map;
+typedef std::map<unsigned, unsigned> RefMap;
+
+void checkEqual(const Map &m, const RefMap &ref) {
+  ASSERT_EQ(ref.size(), m.size());
+  Map::iterator it = m.begin();
+  for (RefMap::const_iterator ri = ref.begin(); ri != ref.end(); ++ri, ++it) {
+    ASSERT_TRUE(it != m.end());
+    EXPECT_EQ(ri->first, it->first);
+    EXPECT_EQ(ri->second, it->second);
+  }
+  EXPECT_TRUE(it == m.end());
+
+  // And backwards.
+  it = m.end();
+  for (RefMap::const_reverse_iterator ri = ref.rbegin(); ri != ref.rend();
+       ++ri) {
+    --it;
+    EXPECT_EQ(ri->first, it->first);
+  }
+  EXPECT_TRUE(it == m.begin());
+}
+
+void checkLookups(const Map &m, const RefMap &ref, unsigned key) {
+  RefMap::const_iterator ri = ref.upper_bound(key);
+  const Map::value_type *prev = m.lookup_previous(key);
+  if (ri == ref.begin()) {
+    EXPECT_TRUE(prev == 0);
+  } else {
+    ASSERT_TRUE(prev != 0);
+    EXPECT_EQ((--ri)->first, prev->first);
+  }
+
+  EXPECT_EQ(ref.count(key), m.count(key));
+
+  ri = ref.lower_bound(key);
+  Map::iterator it = m.lower_bound(key);
+  if (ri == ref.end())
+    EXPECT_TRUE(it == m.end());
+  else
+    EXPECT_EQ(ri->first, it->first);
+
+  ri = ref.upper_bound(key);
+  it = m.upper_bound(key);
+  if (ri == ref.end())
+    EXPECT_TRUE(it == m.end());
+  else
+    EXPECT_EQ(ri->first, it->first);
+}
+
+TEST(BTreeMapTest, RandomOperations) {
+  srand(1);
+  Map m;
+  RefMap ref;
+  for (unsigned i = 0; i < 20000; ++i) {
+    unsigned key = rand() % 2000;
+    if (rand() % 3) {
+      m.replace(std::make_pair(key, i));
+      ref[key] = i;
+    } else {
+      m.remove(key);
+      ref.erase(key);
+    }
+    if (i % 1000 == 0)
+      checkEqual(m, ref);
+    checkLookups(m, ref, rand() % 2100);
+  }
+  checkEqual(m, ref);
+
+  for (RefMap::iterator it = ref.begin(); it != ref.end(); ++it)
+    m.remove(it->first);
+  EXPECT_TRUE(m.empty());
+  EXPECT_TRUE(m.begin() == m.end());
+}
+
+TEST(BTreeMapTest, Shrink) {
+  // Sparse nodes are merged, which must not affect a copy sharing them.
+  Map m;
+  RefMap ref;
+  for (unsigned i = 0; i < 20000; ++i) {
+    m.replace(std::make_pair(i, i));
+    ref[i] = i;
+  }
+  Map copy(m);
+  RefMap refCopy(ref);
+  for (unsigned i = 0; i < 20000; ++i) {
+    if (i % 100 == 0)
+      continue;
+    m.remove(i);
+    ref.erase(i);
+    if (i % 1000 == 999)
+      checkLookups(m, ref, i - 50);
+  }
+  checkEqual(m, ref);
+  checkEqual(copy, refCopy);
+
+  for (unsigned i = 0; i < 20000; i += 7) {
+    m.replace(std::make_pair(i, 1));
+    ref[i] = 1;
+  }
+  checkEqual(m, ref);
+}
+
+TEST(BTreeMapTest, Insert) {
+  Map m;
+  m.insert(std::make_pair(1u, 1u));
+  m.insert(std::make_pair(1u, 2u));
+  EXPECT_EQ(1u, m.lookup(1)->second);
+  m.replace(std::make_pair(1u, 2u));
+  EXPECT_EQ(2u, m.lookup(1)->second);
+  EXPECT_EQ(1u, m.size());
+}
+
+TEST(BTreeMapTest, CopiesAreIndependent) {
+  srand(2);
+  Map m;
+  RefMap ref;
+  for (unsigned i = 0; i < 1000; ++i) {
+    m.replace(std::make_pair(i * 2, i));
+    ref[i * 2] = i;
+  }
+
+  std::vector<Map> copies;
+  std::vector<RefMap> refCopies;
+  for (unsigned c = 0; c < 8; ++c) {
+    copies.push_back(m);
+    refCopies.push_back(ref);
+    for (unsigned i = 0; i < 200; ++i) {
+      unsigned key = rand() % 2500;
+      if (rand() % 2) {
+        copies.back().replace(std::make_pair(key, c));
+        refCopies.back()[key] = c;
+      } else {
+        copies.back().remove(key);
+        refCopies.back().erase(key);
+      }
+    }
+  }
+
+  checkEqual(m, ref);
+  for (unsigned c = 0; c < copies.size(); ++c)
+    checkEqual(copies[c], refCopies[c]);
+}
+
+// Compares the address lookups and the cost of forking and then updating
+// a map against ImmutableMap, with maps of the size of a typical address
+// space. Run with --gtest_also_run_disabled_tests.
+TEST(BTreeMapTest, DISABLED_Benchmark) {
+  typedef ImmutableMap<unsigned, unsigned> OldMap;
+  const unsigned numObjects = 20000, numLookups = 2000000, numForks = 200000;
+
+  std::vector<unsigned> keys;
+  for (unsigned i = 0; i < numObjects; ++i)
+    keys.push_back(i * 64);
+  std::vector<unsigned> probes;
+  srand(3);
+  for (unsigned i = 0; i < numLookups; ++i)
+    probes.push_back(rand() % (numObjects * 64));
+
+  OldMap old;
+  Map m;
+  for (unsigned i = 0; i < numObjects; ++i) {
+    old = old.replace(std::make_pair(keys[i], i));
+    m.replace(std::make_pair(keys[i], i));
+  }
+
+  unsigned sum = 0;
+  clock_t start = clock();
+  for (unsigned i = 0; i < numLookups; ++i)
+    sum += old.lookup_previous(probes[i])->second;
+  double oldLookup = double(clock() - start) / CLOCKS_PER_SEC;
+  start = clock();
+  for (unsigned i = 0; i < numLookups; ++i)
+    sum -= m.lookup_previous(probes[i])->second;
+  double newLookup = double(clock() - start) / CLOCKS_PER_SEC;
+  EXPECT_EQ(0u, sum);
+
+  // Forking a state copies its map, both states then write to an object.
+  start = clock();
+  for (unsigned i = 0; i < numForks; ++i) {
+    OldMap copy(old);
+    copy = copy.replace(std::make_pair(probes[i] & ~63u, i));
+    old = old.replace(std::make_pair(probes[i + 1] & ~63u, i));
+  }
+  double oldFork = double(clock() - start) / CLOCKS_PER_SEC;
+  start = clock();
+  for (unsigned i = 0; i < numForks; ++i) {
+    Map copy(m);
+    copy.replace(std::make_pair(probes[i] & ~63u, i));
+    m.replace(std::make_pair(probes[i + 1] & ~63u, i));
+  }
+  double newFork = double(clock() - start) / CLOCKS_PER_SEC;
+
+  std::cout << "lookup_previous: ImmutableMap " << oldLookup << "s, BTreeMap "
+            << newLookup << "s\n";
+  std::cout << "fork and update: ImmutableMap " << oldFork << "s, BTreeMap "
+            << newFork << "s\n";
+}
+
+}
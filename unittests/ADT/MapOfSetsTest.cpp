@@ -0,0 +1,92 @@
+//===-- MapOfSetsTest.cpp -------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Internal/ADT/MapOfSets.h"
+
+#include <set>
+
+using namespace klee;
+
+namespace {
+
+struct BitSignature {
+  uint64_t operator()(const unsigned &k) const { return 1ULL << (k % 64); }
+};
+
+struct Any {
+  bool operator()(int) const { return true; }
+};
+
+struct Equals {
+  int value;
+  Equals(int _value) : value(_value) {}
+  bool operator()(int v) const { return v == value; }
+};
+
+std::set<unsigned> makeSet(unsigned a, unsigned b = ~0u, unsigned c = ~0u) {
+  std::set<unsigned> s;
+  s.insert(a);
+  if (b != ~0u)
+    s.insert(b);
+  if (c != ~0u)
+    s.insert(c);
+  return s;
+}
+
+typedef MapOfSets<unsigned, int, BitSignature> Map;
+
+TEST(MapOfSetsTest, InsertRemove) {
+  Map m;
+  m.insert(makeSet(1, 2, 3), 123);
+  m.insert(makeSet(1, 2), 12);
+
+  ASSERT_TRUE(m.lookup(makeSet(1, 2, 3)));
+  EXPECT_EQ(123, *m.lookup(makeSet(1, 2, 3)));
+  EXPECT_FALSE(m.remove(makeSet(1)));
+  EXPECT_TRUE(m.remove(makeSet(1, 2, 3)));
+  EXPECT_FALSE(m.remove(makeSet(1, 2, 3)));
+  EXPECT_FALSE(m.lookup(makeSet(1, 2, 3)));
+  ASSERT_TRUE(m.lookup(makeSet(1, 2)));
+  EXPECT_EQ(12, *m.lookup(makeSet(1, 2)));
+
+  EXPECT_TRUE(m.remove(makeSet(1, 2)));
+  EXPECT_TRUE(m.begin() == m.end());
+}
+
+TEST(MapOfSetsTest, Supersets) {
+  Map m;
+  m.insert(makeSet(1, 2, 3), 123);
+  m.insert(makeSet(2, 5), 25);
+  m.insert(makeSet(4), 4);
+
+  EXPECT_EQ(123, *m.findSuperset(makeSet(1, 3), Any()));
+  EXPECT_EQ(25, *m.findSuperset(makeSet(5), Any()));
+  EXPECT_EQ(25, *m.findSuperset(makeSet(2), Equals(25)));
+  EXPECT_FALSE(m.findSuperset(makeSet(3, 4), Any()));
+
+  // Removing the only superset must also make the search skip its
+  // elements.
+  m.remove(makeSet(1, 2, 3));
+  EXPECT_FALSE(m.findSuperset(makeSet(1, 3), Any()));
+  EXPECT_EQ(25, *m.findSuperset(makeSet(2), Any()));
+}
+
+TEST(MapOfSetsTest, Subsets) {
+  Map m;
+  m.insert(makeSet(1, 2), 12);
+  m.insert(makeSet(3), 3);
+
+  EXPECT_EQ(12, *m.findSubset(makeSet(1, 2, 4), Any()));
+  EXPECT_EQ(3, *m.findSubset(makeSet(2, 3), Any()));
+  EXPECT_FALSE(m.findSubset(makeSet(1, 4), Any()));
+}
+
+}
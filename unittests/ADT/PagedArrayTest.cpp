@@ -0,0 +1,141 @@
+//===-- PagedArrayTest.cpp ------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Internal/ADT/PagedArray.h"
+
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+// Pages of 4 elements, 10 elements leave a partial last page of 2.
+typedef PagedArray<int, 4> Array;
+
+TEST(PagedArrayTest, Get) {
+  Array a(10, 7);
+  EXPECT_EQ(10U, a.getSize());
+  for (unsigned i = 0; i != 10; ++i)
+    EXPECT_EQ(7, a.get(i));
+  a.set(9, 3);
+  EXPECT_EQ(3, a.get(9));
+  EXPECT_EQ(7, a.get(8));
+}
+
+TEST(PagedArrayTest, FillSharesFullPages) {
+  Array a(10, 1);
+  // The two full pages are one page, the partial last page is separate.
+  EXPECT_EQ(&a.get(0), &a.get(4));
+  EXPECT_NE(&a.get(0), &a.get(8));
+
+  a.set(5, 2);
+  EXPECT_NE(&a.get(0), &a.get(4));
+  EXPECT_EQ(1, a.get(1));
+  EXPECT_EQ(2, a.get(5));
+
+  a.fill(3);
+  EXPECT_EQ(&a.get(0), &a.get(4));
+  for (unsigned i = 0; i != 10; ++i)
+    EXPECT_EQ(3, a.get(i));
+}
+
+TEST(PagedArrayTest, CopiesShare) {
+  Array a(10, 0);
+  for (unsigned i = 0; i != 10; ++i)
+    a.set(i, i);
+  Array b(a);
+  for (unsigned i = 0; i < 10; i += 4)
+    EXPECT_EQ(&a.get(i), &b.get(i));
+}
+
+TEST(PagedArrayTest, WriteUnshares) {
+  Array a(10, 0);
+  for (unsigned i = 0; i != 10; ++i)
+    a.set(i, i);
+  Array b(a);
+
+  // Only the written page is copied.
+  b.set(5, 50);
+  EXPECT_EQ(5, a.get(5));
+  EXPECT_EQ(50, b.get(5));
+  EXPECT_NE(&a.get(4), &b.get(4));
+  EXPECT_EQ(&a.get(0), &b.get(0));
+  EXPECT_EQ(&a.get(8), &b.get(8));
+
+  // The partial last page as well.
+  a.set(9, 90);
+  EXPECT_EQ(90, a.get(9));
+  EXPECT_EQ(9, b.get(9));
+  EXPECT_NE(&a.get(8), &b.get(8));
+  EXPECT_EQ(8, a.get(8));
+}
+
+TEST(PagedArrayTest, CopyOutAndEquals) {
+  Array a(10, 0);
+  for (unsigned i = 0; i != 10; ++i)
+    a.set(i, 10 - i);
+
+  std::vector<int> out(10);
+  a.copyOut(&out[0]);
+  for (unsigned i = 0; i != 10; ++i)
+    EXPECT_EQ((int)(10 - i), out[i]);
+  EXPECT_TRUE(a.equals(&out[0]));
+
+  // A difference in the partial last page.
+  out[9] = 0;
+  EXPECT_FALSE(a.equals(&out[0]));
+  out[9] = 1;
+  out[0] = 0;
+  EXPECT_FALSE(a.equals(&out[0]));
+}
+
+TEST(PagedArrayTest, CopyInLeavesUnchangedPagesShared) {
+  Array a(10, 0);
+  Array b(a);
+  std::vector<int> in(10, 0);
+  in[6] = 6;
+  in[9] = 9;
+  b.copyIn(&in[0]);
+
+  EXPECT_TRUE(b.equals(&in[0]));
+  EXPECT_EQ(0, a.get(6));
+  EXPECT_EQ(0, a.get(9));
+  EXPECT_EQ(&a.get(0), &b.get(0));
+  EXPECT_NE(&a.get(4), &b.get(4));
+  EXPECT_NE(&a.get(8), &b.get(8));
+
+  // Copying in the current contents copies nothing.
+  Array c(b);
+  c.copyIn(&in[0]);
+  for (unsigned i = 0; i < 10; i += 4)
+    EXPECT_EQ(&b.get(i), &c.get(i));
+}
+
+TEST(PagedArrayTest, BitArray) {
+  // 128 words of 32 bits per page, 5000 bits span two pages.
+  PagedBitArray a(5000, true);
+  PagedBitArray b(a, 5000);
+  for (unsigned i = 0; i < 5000; i += 100)
+    EXPECT_TRUE(b.get(i));
+
+  b.unset(4999);
+  b.set(0, false);
+  EXPECT_FALSE(b.get(4999));
+  EXPECT_FALSE(b.get(0));
+  EXPECT_TRUE(b.get(1));
+  EXPECT_TRUE(a.get(4999));
+  EXPECT_TRUE(a.get(0));
+
+  b.set(4999);
+  EXPECT_TRUE(b.get(4999));
+}
+
+}
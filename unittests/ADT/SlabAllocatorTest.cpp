@@ -0,0 +1,80 @@
+//===-- SlabAllocatorTest.cpp ---------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Internal/ADT/SlabAllocator.h"
+
+#include <set>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+TEST(SlabAllocatorTest, ReusesFreedSlots) {
+  SlabAllocator slab(24, 1024);
+  EXPECT_EQ(32U, slab.getSlotSize());
+  void *a = slab.allocate();
+  void *b = slab.allocate();
+  EXPECT_NE(a, b);
+  slab.deallocate(a);
+  EXPECT_EQ(a, slab.allocate());
+  EXPECT_EQ(64U, slab.getUsedSize());
+}
+
+TEST(SlabAllocatorTest, ReleaseEmptySlabs) {
+  // 32 slots per slab.
+  SlabAllocator slab(32, 1024);
+  std::vector<void *> slots;
+  for (unsigned i = 0; i != 4 * 32; ++i)
+    slots.push_back(slab.allocate());
+  EXPECT_EQ(4U, slab.getNumSlabs());
+  EXPECT_EQ(0U, slab.releaseEmptySlabs());
+
+  // Free everything but one slot of the first slab and all of the last
+  // one, the two slabs in between become empty.
+  std::set<void *> kept;
+  for (unsigned i = 0; i != slots.size(); ++i) {
+    if (i == 0 || i >= 3 * 32)
+      kept.insert(slots[i]);
+    else
+      slab.deallocate(slots[i]);
+  }
+  EXPECT_EQ(2U * 32 * 32, slab.releaseEmptySlabs());
+  EXPECT_EQ(2U, slab.getNumSlabs());
+  EXPECT_EQ(2U * 32 * 32, slab.getReservedSize());
+  EXPECT_EQ(33U * 32, slab.getUsedSize());
+
+  // The remaining free slots are in the first slab and are handed out
+  // before a new slab is added.
+  for (unsigned i = 0; i != 31; ++i) {
+    void *p = slab.allocate();
+    EXPECT_EQ(0U, kept.count(p));
+    kept.insert(p);
+  }
+  EXPECT_EQ(2U, slab.getNumSlabs());
+  slab.allocate();
+  EXPECT_EQ(3U, slab.getNumSlabs());
+}
+
+TEST(SlabAllocatorTest, ReleaseAll) {
+  SlabAllocator slab(16, 1024);
+  std::vector<void *> slots;
+  for (unsigned i = 0; i != 100; ++i)
+    slots.push_back(slab.allocate());
+  for (unsigned i = 0; i != slots.size(); ++i)
+    slab.deallocate(slots[i]);
+  size_t reserved = slab.getReservedSize();
+  EXPECT_EQ(reserved, slab.releaseEmptySlabs());
+  EXPECT_EQ(0U, slab.getNumSlabs());
+  EXPECT_NE((void *)0, slab.allocate());
+}
+
+}
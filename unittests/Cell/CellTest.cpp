@@ -0,0 +1,145 @@
+//===-- CellTest.cpp ------------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr.h"
+#include "klee/Internal/Module/Cell.h"
+#include "klee/util/ArrayCache.h"
+
+#include <ctime>
+#include <iostream>
+
+using namespace klee;
+
+namespace {
+
+TEST(CellTest, Empty) {
+  Cell c;
+  EXPECT_FALSE(c.isConstant());
+  EXPECT_TRUE(c.getValue().isNull());
+}
+
+TEST(CellTest, SetConstant) {
+  Expr::Width widths[] = { Expr::Bool, Expr::Int8, Expr::Int16, Expr::Int32,
+                           Expr::Int64 };
+  for (unsigned i = 0; i != sizeof(widths) / sizeof(widths[0]); ++i) {
+    Cell c;
+    c.setConstant(0xFEDCBA9876543211ULL, widths[i]);
+    ASSERT_TRUE(c.isConstant());
+    EXPECT_EQ(widths[i], c.getConstantWidth());
+
+    // Bits above the width are dropped.
+    uint64_t expected = 0xFEDCBA9876543211ULL;
+    if (widths[i] != Expr::Int64)
+      expected &= (1ULL << widths[i]) - 1;
+    EXPECT_EQ(expected, c.getConstant());
+
+    // The expression is created on demand and matches the inline value.
+    ref<Expr> value = c.getValue();
+    ASSERT_TRUE(isa<ConstantExpr>(value));
+    EXPECT_EQ(widths[i], value->getWidth());
+    EXPECT_EQ(expected, cast<ConstantExpr>(value)->getZExtValue());
+    EXPECT_EQ(value.get(), c.getValue().get());
+  }
+}
+
+TEST(CellTest, BoolConstantsAreShared) {
+  Cell a, b;
+  a.setConstant(1, Expr::Bool);
+  b.setConstant(3, Expr::Bool);
+  EXPECT_EQ(a.getValue().get(), b.getValue().get());
+  EXPECT_TRUE(cast<ConstantExpr>(a.getValue())->isTrue());
+  b.setConstant(0, Expr::Bool);
+  EXPECT_TRUE(cast<ConstantExpr>(b.getValue())->isFalse());
+}
+
+TEST(CellTest, SetValue) {
+  // Constants of up to 64 bits are kept inline.
+  Cell c;
+  ref<Expr> constant = ConstantExpr::create(42, Expr::Int32);
+  c.setValue(constant);
+  ASSERT_TRUE(c.isConstant());
+  EXPECT_EQ(42U, c.getConstant());
+  EXPECT_EQ((Expr::Width) Expr::Int32, c.getConstantWidth());
+  EXPECT_EQ(constant.get(), c.getValue().get());
+
+  // Wider constants are not.
+  ref<Expr> wide = ConstantExpr::create(42, Expr::Fl80);
+  c.setValue(wide);
+  EXPECT_FALSE(c.isConstant());
+  EXPECT_EQ(wide.get(), c.getValue().get());
+
+  // Neither are symbolic values.
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 4);
+  ref<Expr> read = Expr::createTempRead(array, Expr::Int32);
+  c.setValue(read);
+  EXPECT_FALSE(c.isConstant());
+  EXPECT_EQ(read.get(), c.getValue().get());
+
+  // A constant replaces a symbolic value and the other way around.
+  c.setConstant(7, Expr::Int8);
+  ASSERT_TRUE(c.isConstant());
+  EXPECT_EQ(7U, cast<ConstantExpr>(c.getValue())->getZExtValue());
+  c.setValue(read);
+  EXPECT_FALSE(c.isConstant());
+  EXPECT_EQ(read.get(), c.getValue().get());
+
+  c.setValue(ref<Expr>());
+  EXPECT_FALSE(c.isConstant());
+  EXPECT_TRUE(c.getValue().isNull());
+}
+
+TEST(CellTest, Copy) {
+  Cell a;
+  a.setConstant(5, Expr::Int16);
+  Cell b(a);
+  ASSERT_TRUE(b.isConstant());
+  EXPECT_EQ(5U, b.getConstant());
+  // The copy creates its own expression, or shares one already created.
+  ref<Expr> value = a.getValue();
+  Cell c(a);
+  EXPECT_EQ(value.get(), c.getValue().get());
+  EXPECT_EQ(5U, cast<ConstantExpr>(b.getValue())->getZExtValue());
+}
+
+// Compares the register updates of a concrete counting loop, i = i + 1
+// and i < n, through expressions, as the interpreter did before constants
+// were kept inline, and on the inline constants. Run with
+// --gtest_also_run_disabled_tests.
+TEST(CellTest, DISABLED_Benchmark) {
+  const uint64_t n = 10000000;
+  Cell i, one, limit, cond;
+  one.setConstant(1, Expr::Int32);
+  limit.setConstant(n, Expr::Int32);
+
+  i.setConstant(0, Expr::Int32);
+  clock_t start = clock();
+  do {
+    i.setValue(AddExpr::create(i.getValue(), one.getValue()));
+    cond.setValue(UltExpr::create(i.getValue(), limit.getValue()));
+  } while (cast<ConstantExpr>(cond.getValue())->isTrue());
+  double exprTime = double(clock() - start) / CLOCKS_PER_SEC;
+  EXPECT_EQ(n, i.getConstant());
+
+  i.setConstant(0, Expr::Int32);
+  start = clock();
+  do {
+    i.setConstant(i.getConstant() + one.getConstant(), Expr::Int32);
+    cond.setConstant(i.getConstant() < limit.getConstant(), Expr::Bool);
+  } while (cond.getConstant());
+  double inlineTime = double(clock() - start) / CLOCKS_PER_SEC;
+  EXPECT_EQ(n, i.getConstant());
+
+  std::cout << "add and compare: expressions " << exprTime << "s, inline "
+            << inlineTime << "s\n";
+}
+
+}
@@ -0,0 +1,89 @@
+//===-- ConstraintsTest.cpp -----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/util/ArrayCache.h"
+
+using namespace klee;
+
+namespace {
+
+ref<Expr> read(const Array *array, ref<Expr> index) {
+  return ReadExpr::create(UpdateList(array, 0), index);
+}
+
+ref<Expr> read(const Array *array, unsigned index) {
+  return read(array, ConstantExpr::alloc(index, Expr::Int32));
+}
+
+ref<Expr> ult(ref<Expr> a, ref<Expr> b) {
+  return UltExpr::create(a, b);
+}
+
+std::vector< ref<Expr> > related(const ConstraintManager &cm, ref<Expr> e) {
+  std::vector< ref<Expr> > result;
+  EXPECT_TRUE(cm.getIndependentConstraints(e, result));
+  return result;
+}
+
+TEST(ConstraintsTest, IndependentConstraints) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 4);
+  const Array *b = ac.CreateArray("b", 4);
+
+  ConstraintManager cm;
+  ref<Expr> c0 = ult(read(a, 0), read(a, 1));
+  ref<Expr> c1 = ult(read(b, 0), read(b, 1));
+  ref<Expr> c2 = ult(read(a, 2), read(b, 2));
+  ref<Expr> c3 = ult(read(a, 1), read(a, 3));
+  cm.addConstraint(c0);
+  cm.addConstraint(c1);
+  cm.addConstraint(c2);
+  cm.addConstraint(c3);
+
+  std::vector< ref<Expr> > result = related(cm, read(a, 0));
+  ASSERT_EQ(2u, result.size());
+  EXPECT_EQ(c0, result[0]);
+  EXPECT_EQ(c3, result[1]);
+
+  EXPECT_EQ(1u, related(cm, read(b, 1)).size());
+  EXPECT_EQ(1u, related(cm, read(a, 2)).size());
+  EXPECT_EQ(0u, related(cm, read(b, 3)).size());
+
+  // The copy shares the partition until it is modified.
+  ConstraintManager copy(cm);
+  ref<Expr> c4 = ult(read(a, 3), read(b, 2));
+  copy.addConstraint(c4);
+  EXPECT_EQ(2u, related(cm, read(a, 0)).size());
+  EXPECT_EQ(4u, related(copy, read(a, 0)).size());
+
+  // A read at a symbolic index joins all elements of the array.
+  cm.addConstraint(ult(read(b, read(a, 2)), read(b, 3)));
+  result = related(cm, read(b, 3));
+  ASSERT_EQ(3u, result.size());
+  EXPECT_EQ(c1, result[0]);
+  EXPECT_EQ(c2, result[1]);
+
+  std::vector< std::vector< ref<Expr> > > clusters;
+  EXPECT_TRUE(cm.getIndependentClusters(clusters));
+  EXPECT_EQ(2u, clusters.size());
+}
+
+TEST(ConstraintsTest, NoPartition) {
+  std::vector< ref<Expr> > constraints;
+  ConstraintManager cm(constraints);
+  std::vector< ref<Expr> > result;
+  EXPECT_FALSE(cm.getIndependentConstraints(ConstantExpr::alloc(1, Expr::Bool),
+                                            result));
+}
+
+}
@@ -0,0 +1,72 @@
+//===-- ExprAllocatorTest.cpp ---------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr.h"
+#include "klee/util/ArrayCache.h"
+
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+TEST(ExprAllocatorTest, AllocateAndRelease) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 256);
+  uint64_t allocations = Expr::getPoolAllocations();
+  uint64_t frees = Expr::getPoolFrees();
+  uint64_t mallocs = Expr::getPoolMallocs();
+  size_t used = Expr::getPoolUsedSize();
+
+  {
+    // Nodes of several size classes: constants, binary and ternary
+    // expressions, reads and update nodes.
+    std::vector< ref<Expr> > exprs;
+    UpdateList ul(array, 0);
+    for (unsigned i = 0; i != 4096; ++i) {
+      ref<Expr> index = ConstantExpr::alloc(i % 256, Expr::Int32);
+      ref<Expr> read = ReadExpr::create(ul, index);
+      ref<Expr> sum = AddExpr::create(read, ConstantExpr::alloc(i, Expr::Int8));
+      exprs.push_back(SelectExpr::create(EqExpr::create(read, sum), read, sum));
+      ul.extend(index, sum);
+    }
+    exprs.push_back(ReadExpr::create(ul, ConstantExpr::alloc(0, Expr::Int32)));
+
+    EXPECT_GT(Expr::getPoolAllocations() - allocations, 5U * 4096);
+    EXPECT_GT(Expr::getPoolMallocs(), mallocs);
+    EXPECT_GT(Expr::getPoolUsedSize(), used);
+    EXPECT_GE(Expr::getPoolReservedSize(), Expr::getPoolUsedSize());
+    // Nothing can be released while the nodes are alive.
+    EXPECT_EQ(0U, Expr::releasePoolMemory());
+  }
+
+  // Every node was returned to the pool, and the slabs that held only
+  // these nodes can be given back.
+  EXPECT_EQ(Expr::getPoolAllocations() - allocations,
+            Expr::getPoolFrees() - frees);
+  EXPECT_EQ(used, Expr::getPoolUsedSize());
+  size_t reserved = Expr::getPoolReservedSize();
+  size_t released = Expr::releasePoolMemory();
+  EXPECT_GT(released, 0U);
+  EXPECT_EQ(reserved - released, Expr::getPoolReservedSize());
+  EXPECT_EQ(0U, Expr::releasePoolMemory());
+
+  // The released slabs are allocated again when needed.
+  mallocs = Expr::getPoolMallocs();
+  {
+    std::vector< ref<Expr> > exprs;
+    for (unsigned i = 0; i != 4096; ++i)
+      exprs.push_back(ConstantExpr::alloc(i, Expr::Int32));
+    EXPECT_GT(Expr::getPoolMallocs(), mallocs);
+  }
+}
+
+}
@@ -0,0 +1,130 @@
+//===-- ExprEvaluatorTest.cpp ---------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr.h"
+#include "klee/util/ArrayCache.h"
+#include "klee/util/ExprEvaluator.h"
+
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+/// Reads of \a indexArray evaluate to the current index, reads of \a
+/// unknownArray stay symbolic, all other bytes are 0xFF.
+class TestEvaluator : public ExprEvaluator {
+public:
+  const Array *indexArray, *unknownArray;
+  unsigned index;
+
+  TestEvaluator(const Array *_indexArray, const Array *_unknownArray)
+    : indexArray(_indexArray), unknownArray(_unknownArray), index(0) {}
+
+  ref<Expr> getInitialValue(const Array &array, unsigned i) {
+    if (&array == indexArray)
+      return ConstantExpr::alloc(index, Expr::Int8);
+    if (&array == unknownArray)
+      return ReadExpr::create(UpdateList(&array, 0),
+                              ConstantExpr::alloc(i, array.getDomain()));
+    return ConstantExpr::alloc(0xFF, Expr::Int8);
+  }
+};
+
+class ExprEvaluatorTest : public ::testing::Test {
+protected:
+  ArrayCache ac;
+  const Array *array, *indexArray, *unknownArray;
+
+  ExprEvaluatorTest() {
+    array = ac.CreateArray("arr", 64);
+    indexArray = ac.CreateArray("index", 1);
+    unknownArray = ac.CreateArray("unknown", 1);
+  }
+
+  /// A read of \a ul at the index given by the evaluator, so that the
+  /// read is not folded when it is created.
+  ref<Expr> read(const UpdateList &ul) {
+    ref<Expr> index = ReadExpr::create(UpdateList(indexArray, 0),
+                                       ConstantExpr::alloc(0, Expr::Int32));
+    return ReadExpr::create(ul, ZExtExpr::create(index, Expr::Int32));
+  }
+
+  ref<Expr> evaluate(const UpdateList &ul, unsigned index) {
+    TestEvaluator evaluator(indexArray, unknownArray);
+    evaluator.index = index;
+    return evaluator.visit(read(ul));
+  }
+
+  static ref<Expr> constant(uint64_t value, Expr::Width width = Expr::Int8) {
+    return ConstantExpr::alloc(value, width);
+  }
+};
+
+TEST_F(ExprEvaluatorTest, NewestUpdateWins) {
+  // Lists below and above the size at which the updates are indexed.
+  unsigned sizes[] = { 8, 15, 16, 100 };
+  for (unsigned s = 0; s != sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    UpdateList ul(array, 0);
+    std::vector<int> expected(64, 0xFF);
+    for (unsigned i = 0; i != sizes[s]; ++i) {
+      unsigned index = (i * 7) % 40;
+      ul.extend(constant(index, Expr::Int32), constant(i));
+      expected[index] = i;
+    }
+    for (unsigned i = 0; i != 64; ++i) {
+      ref<Expr> value = evaluate(ul, i);
+      ASSERT_TRUE(isa<ConstantExpr>(value));
+      EXPECT_EQ((uint64_t) expected[i],
+                cast<ConstantExpr>(value)->getZExtValue());
+    }
+  }
+}
+
+TEST_F(ExprEvaluatorTest, SymbolicIndexStopsIndex) {
+  UpdateList ul(array, 0);
+  ul.extend(constant(1, Expr::Int32), constant(1));
+  ref<Expr> unknown = ReadExpr::create(UpdateList(unknownArray, 0),
+                                       constant(0, Expr::Int32));
+  ul.extend(ZExtExpr::create(unknown, Expr::Int32), constant(2));
+  for (unsigned i = 0; i != 32; ++i)
+    ul.extend(constant(10 + i, Expr::Int32), constant(3));
+
+  // Updates above the symbolic index are known.
+  ref<Expr> value = evaluate(ul, 20);
+  ASSERT_TRUE(isa<ConstantExpr>(value));
+  EXPECT_EQ(3U, cast<ConstantExpr>(value)->getZExtValue());
+
+  // Reads below it are not, whether they were written or not.
+  EXPECT_FALSE(isa<ConstantExpr>(evaluate(ul, 1)));
+  EXPECT_FALSE(isa<ConstantExpr>(evaluate(ul, 5)));
+}
+
+TEST_F(ExprEvaluatorTest, IndexIsPerList) {
+  // One evaluator reading two versions of the same list.
+  UpdateList ul(array, 0);
+  for (unsigned i = 0; i != 32; ++i)
+    ul.extend(constant(i, Expr::Int32), constant(i));
+  UpdateList newer(ul);
+  for (unsigned i = 0; i != 32; ++i)
+    newer.extend(constant(i, Expr::Int32), constant(100 + i));
+
+  TestEvaluator evaluator(indexArray, unknownArray);
+  evaluator.index = 5;
+  ref<Expr> value = evaluator.visit(read(ul));
+  ref<Expr> newValue = evaluator.visit(read(newer));
+  ASSERT_TRUE(isa<ConstantExpr>(value));
+  ASSERT_TRUE(isa<ConstantExpr>(newValue));
+  EXPECT_EQ(5U, cast<ConstantExpr>(value)->getZExtValue());
+  EXPECT_EQ(105U, cast<ConstantExpr>(newValue)->getZExtValue());
+}
+
+}
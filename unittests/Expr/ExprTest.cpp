@@ -13,6 +13,8 @@
 #include "klee/Expr.h"
 #include "klee/util/ArrayCache.h"
 
+#include "llvm/Support/CommandLine.h"
+
 using namespace klee;
 
 namespace {
@@ -264,4 +266,70 @@ TEST(ExprTest, ReadExprFoldingSymbolicIndexUpdate) {
     EXPECT_EQ(Expr::Read, read.get()->getKind());
   }
 }
+
+TEST(ExprTest, UpdateNodeHashIsOrderSensitive) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 256);
+
+  // The same two writes in a different order.
+  UpdateList ul1(array, 0), ul2(array, 0);
+  ul1.extend(getConstant(1, Expr::Int32), getConstant(10, Expr::Int8));
+  ul1.extend(getConstant(2, Expr::Int32), getConstant(20, Expr::Int8));
+  ul2.extend(getConstant(2, Expr::Int32), getConstant(20, Expr::Int8));
+  ul2.extend(getConstant(1, Expr::Int32), getConstant(10, Expr::Int8));
+  EXPECT_NE(ul1.head->hash(), ul2.head->hash());
+  EXPECT_NE(ul1.hash(), ul2.hash());
+}
+
+TEST(ExprTest, HashConsing) {
+  // Hash-consing can not be turned off again, so this test must stay last.
+  const char *argv[] = { "ExprTest", "-hash-cons-exprs" };
+  llvm::cl::ParseCommandLineOptions(2, argv);
+  ASSERT_TRUE(Expr::isHashConsing());
+
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 256);
+  ref<Expr> index = Expr::createTempRead(array, Expr::Int32);
+
+  // Structurally equal expressions share a node.
+  ref<Expr> a = AddExpr::create(index, getConstant(5, Expr::Int32));
+  ref<Expr> b = AddExpr::create(index, getConstant(5, Expr::Int32));
+  EXPECT_EQ(a.get(), b.get());
+  ref<Expr> c = AddExpr::create(index, getConstant(6, Expr::Int32));
+  EXPECT_NE(a.get(), c.get());
+
+  // And so do structurally equal update nodes.
+  UpdateList ul1(array, 0), ul2(array, 0);
+  ul1.extend(a, getConstant(1, Expr::Int8));
+  ul2.extend(b, getConstant(1, Expr::Int8));
+  EXPECT_EQ(ul1.head, ul2.head);
+  ul2.extend(b, getConstant(2, Expr::Int8));
+  EXPECT_NE(ul1.head, ul2.head);
+  EXPECT_EQ(ul1.head, ul2.head->next);
+
+  ref<Expr> r1 = ReadExpr::create(ul1, index);
+  ref<Expr> r2 = ReadExpr::create(UpdateList(array, ul2.head->next), index);
+  EXPECT_EQ(r1.get(), r2.get());
+
+  // A freed node is removed from the table and can be created again.
+  c = 0;
+  ref<Expr> d = AddExpr::create(index, getConstant(6, Expr::Int32));
+  EXPECT_EQ(6U, cast<ConstantExpr>(d->getKid(0))->getZExtValue());
+}
+
+TEST(ExprTest, SharedConstantArrays) {
+  ArrayCache ac;
+  std::vector< ref<ConstantExpr> > contents(16, ConstantExpr::alloc(1, 8));
+  const Array *a = ac.CreateSharedConstantArray("a", 16, &contents[0],
+                                                &contents[0] + 16);
+  const Array *b = ac.CreateSharedConstantArray("b", 16, &contents[0],
+                                                &contents[0] + 16);
+  EXPECT_EQ(a, b);
+  contents[3] = ConstantExpr::alloc(2, 8);
+  const Array *c = ac.CreateSharedConstantArray("c", 16, &contents[0],
+                                                &contents[0] + 16);
+  EXPECT_NE(a, c);
+  EXPECT_EQ(2U, c->constantValues[3]->getZExtValue());
+}
+
 }
@@ -13,6 +13,12 @@
 #include "gtest/gtest.h"
 #include <iostream>
 #include "klee/util/Ref.h"
+#include "klee/util/RefCount.h"
+
+#ifdef KLEE_ATOMIC_REFCOUNT
+#include <thread>
+#include <vector>
+#endif
 using klee::ref;
 
 int finished = 0;
@@ -38,3 +44,42 @@ TEST(RefTest, SelfAssign)
   EXPECT_EQ(r_e->refCount, 1);
   finished = 1;
 }
+
+TEST(RefTest, RefCount)
+{
+  klee::RefCount c;
+  EXPECT_EQ(0u, (unsigned) c);
+  EXPECT_FALSE(c.tryRetain());
+  EXPECT_EQ(1u, ++c);
+  EXPECT_TRUE(c.tryRetain());
+  EXPECT_EQ(2u, (unsigned) c);
+  // A copy starts out unreferenced.
+  klee::RefCount d(c);
+  EXPECT_EQ(0u, (unsigned) d);
+  EXPECT_EQ(1u, --c);
+  EXPECT_EQ(0u, --c);
+}
+
+#ifdef KLEE_ATOMIC_REFCOUNT
+struct SharedNode
+{
+  klee::RefCount refCount;
+};
+
+TEST(RefTest, ConcurrentCopies)
+{
+  SharedNode *n = new SharedNode();
+  ref<SharedNode> r(n);
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i != 4; ++i)
+    threads.push_back(std::thread([&r]() {
+      for (unsigned j = 0; j != 100000; ++j) {
+        ref<SharedNode> copy(r);
+        ref<SharedNode> other = copy;
+      }
+    }));
+  for (unsigned i = 0; i != threads.size(); ++i)
+    threads[i].join();
+  EXPECT_EQ(1u, (unsigned) n->refCount);
+}
+#endif